@@ -0,0 +1,50 @@
+/*=====================================================================
+	AtomicOps.h - Atomic operations on plain memory
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Functions:
+
+		bool atomicCompareAndSwap(unsigned char*, unsigned char, unsigned char)
+
+  Requirements:
+		GCC compatible compiler, or Visual C++ 2010 or later
+
+  Dependencies:
+		<intrin.h> with Visual C++
+
+=====================================================================*/
+#if !defined(ATOMICOPS_H)
+#define ATOMICOPS_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <stddef.h> // size_t
+
+#if defined(_MSC_VER)
+#include <intrin.h> // _InterlockedCompareExchange8
+#endif
+
+//------------------------------------------------------------------------
+// atomicCompareAndSwap
+// Sets *address to desired if it's expected, as one atomic operation,
+// with a full barrier. Returns true if it did. For arrays the tables
+// allocate as plain bytes but sometimes fill from several threads, eg
+// the slot states in a parallel rehash.
+inline bool atomicCompareAndSwap(unsigned char* address, unsigned char expected, unsigned char desired)
+{
+#if defined(__GNUC__)
+	return __sync_bool_compare_and_swap(address, expected, desired);
+#else
+	return static_cast<unsigned char>(_InterlockedCompareExchange8(reinterpret_cast<volatile char*>(address),
+		static_cast<char>(desired), static_cast<char>(expected))) == expected;
+#endif
+}
+
+#endif // !defined(ATOMICOPS_H)
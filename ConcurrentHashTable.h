@@ -0,0 +1,307 @@
+/*=====================================================================
+	ConcurrentHashTable.h - Lock striped hash table template class
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		// The hash table
+		template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class Table = HashTableChained<Key, Value, MyHasher>
+		  >
+		class ConcurrentHashTable
+
+  Requirements:
+		A Hasher must be implemented if the generic ones isn't applicable,
+		with the full width () operator, ie without a size.
+		Caller needs to #inlude default Grower/Hasher if they are to be used.
+
+  Dependencies:
+		HashTableChained.h if the default Table is used
+		ReadWriteLock.h, HashMix.h
+
+  Shards:
+		The elements are spread over a number of sub tables (shards), each
+		an ordinary single threaded Table with a reader-writer lock of its
+		own. A key's shard is picked from the high bits of its (mixed) hash
+		value, the Table maps it to a slot with the low bits, or the
+		remainder by a prime, so the two don't correlate. Lookups in a shard
+		run in parallel, anything that changes it waits for the lookups to
+		finish. Operations on different shards never wait for each other.
+		No operation holds more than one shard lock at a time.
+
+  Visitors:
+		There are no iterators, an element is only safe to touch while its
+		shard is locked. Instead find(), visit(), upsert() and for_each()
+		take a function object that's called with the element while the
+		lock is held. It must not call back into the same table, and
+		should be quick as it holds up the other users of the shard.
+
+=====================================================================*/
+#if !defined(CONCURRENTHASHTABLE_H)
+#define CONCURRENTHASHTABLE_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <map> // std::pair
+
+#include "HashMix.h"
+#include "HashTableChained.h"
+#include "ReadWriteLock.h"
+
+//------------------------------------------------------------------------
+// ConcurrentHashTable
+// A thread safe hash collection, see Shards and Visitors above.
+// class Key
+//   The key type
+// class Value:
+//   The value type
+// class MyHasher:
+//   Picks the shard. Also the Table's hasher by default, which then hashes
+//   the key a second time to find the slot.
+// class Table:
+//   The sub table type, eg HashTableChained or HashTableProbed. It needs
+//   the find/try_emplace/insert_or_assign/erase/clear/size methods and
+//   iterators of those, and a constructor taking the initial size.
+template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class Table = HashTableChained<Key, Value, MyHasher>
+		  >
+class ConcurrentHashTable
+{
+public:
+	//------------------------------------------------------------------
+	// Public Type Definitions
+	//------------------------------------------------------------------
+	typedef typename Table::value_type value_type;
+
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	// shards is rounded up to a power of two, initialSize is shared among
+	// them. A few shards per thread keeps the odds of two threads wanting
+	// the same one low.
+	explicit ConcurrentHashTable(size_t shards=64, size_t initialSize=1000):mShards(0), mShardCount(1), mShardBits(0)
+	{
+		while (mShardCount < shards)
+		{
+			mShardCount *= 2;
+			mShardBits++;
+		}
+
+		mShards = new Shard*[mShardCount];
+		for (size_t i=0;i<mShardCount;++i)
+		{
+			mShards[i] = new Shard(initialSize/mShardCount);
+		}
+	}
+
+	~ConcurrentHashTable()
+	{
+		for (size_t i=0;i<mShardCount;++i)
+		{
+			delete mShards[i];
+		}
+		delete [] mShards;
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+	// Calls visitor(const value_type&) with the element with key, if any.
+	// Returns false if there's none.
+	template <class Visitor>
+	bool find(const Key& key, Visitor visitor) const
+	{
+		Shard& shard = getShard(key);
+		ReadLocker lock(shard.lock);
+
+		const Table& table = shard.table;
+		typename Table::const_iterator it = table.find(key);
+		if (it == table.end())
+			return false;
+
+		visitor(*it);
+		return true;
+	}
+
+	bool contains(const Key& key) const
+	{
+		Shard& shard = getShard(key);
+		ReadLocker lock(shard.lock);
+
+		const Table& table = shard.table;
+		return table.find(key) != table.end();
+	}
+
+	// Calls visitor(const value_type&) for each element, one shard at a
+	// time. Elements inserted or erased meanwhile may or may not be
+	// visited.
+	template <class Visitor>
+	Visitor for_each(Visitor visitor) const
+	{
+		for (size_t i=0;i<mShardCount;++i)
+		{
+			ReadLocker lock(mShards[i]->lock);
+
+			const Table& table = mShards[i]->table;
+			for (typename Table::const_iterator it = table.begin();it != table.end();++it)
+			{
+				visitor(*it);
+			}
+		}
+		return visitor;
+	}
+
+	// The sum of the shards' sizes, each read at a different moment
+	size_t size() const
+	{
+		size_t total = 0;
+		for (size_t i=0;i<mShardCount;++i)
+		{
+			ReadLocker lock(mShards[i]->lock);
+			total += mShards[i]->table.size();
+		}
+		return total;
+	}
+
+	size_t getShardCount() const { return mShardCount; }
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+	// insert - returns false if no insertion took place, ie key already stored
+	bool insert(const Key& key, const Value& value)
+	{
+		Shard& shard = getShard(key);
+		WriteLocker lock(shard.lock);
+
+		return shard.table.try_emplace(key, value).second;
+	}
+
+	// Inserts, or assigns value if key is already stored. Returns true
+	// if it was inserted.
+	bool upsert(const Key& key, const Value& value)
+	{
+		Shard& shard = getShard(key);
+		WriteLocker lock(shard.lock);
+
+		return shard.table.insert_or_assign(key, value).second;
+	}
+
+	// Inserts (key, value), or calls visitor(value_type&) with the element
+	// already stored, eg to add to a count. Returns true if it was
+	// inserted.
+	template <class Visitor>
+	bool upsert(const Key& key, const Value& value, Visitor visitor)
+	{
+		Shard& shard = getShard(key);
+		WriteLocker lock(shard.lock);
+
+		std::pair<typename Table::iterator, bool> result = shard.table.try_emplace(key, value);
+		if (result.second)
+			return true;
+
+		if (result.first == shard.table.end())
+			throw "Failed to insert";
+
+		visitor(*result.first);
+		return false;
+	}
+
+	// Calls visitor(value_type&) with the element with key, if any, and
+	// may change its value. Returns false if there's none.
+	template <class Visitor>
+	bool visit(const Key& key, Visitor visitor)
+	{
+		Shard& shard = getShard(key);
+		WriteLocker lock(shard.lock);
+
+		typename Table::iterator it = shard.table.find(key);
+		if (it == shard.table.end())
+			return false;
+
+		visitor(*it);
+		return true;
+	}
+
+	size_t erase(const Key& key)
+	{
+		Shard& shard = getShard(key);
+		WriteLocker lock(shard.lock);
+
+		return shard.table.erase(key);
+	}
+
+	// Empties the shards one at a time, elements inserted meanwhile in
+	// the ones already done are kept.
+	void clear()
+	{
+		for (size_t i=0;i<mShardCount;++i)
+		{
+			WriteLocker lock(mShards[i]->lock);
+			mShards[i]->table.clear();
+		}
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	ConcurrentHashTable(const ConcurrentHashTable&);
+
+	// Assignment operator
+	ConcurrentHashTable& operator = (const ConcurrentHashTable&);
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	// Assumed cache line size
+	enum { cCacheLine = 64 };
+
+	//------------------------------------------------------------------
+	// Private Classes
+	//------------------------------------------------------------------
+	// Each shard is allocated on its own, and padded so that no other
+	// shard's lock shares a cache line with it.
+	struct Shard
+	{
+		explicit Shard(size_t initialSize):table(initialSize) {}
+
+		ReadWriteLock lock;
+		Table table;
+		char padding[cCacheLine];
+	};
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	// The shard from the top mShardBits bits of the hash. It's mixed first
+	// as a hasher's high bits are often 0, eg for small ints.
+	Shard& getShard(const Key& key) const
+	{
+		if (mShardBits == 0)
+			return *mShards[0];
+
+		MyHasher hasher;
+		size_t hashValue = HashMix<sizeof(size_t)>::mix(hasher(key));
+		return *mShards[hashValue >> (sizeof(size_t)*8 - mShardBits)];
+	}
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	Shard**	mShards;
+	size_t	mShardCount; // A power of two
+	size_t	mShardBits;  // log2(mShardCount)
+};
+
+#endif // !defined(CONCURRENTHASHTABLE_H)
@@ -1,113 +1,210 @@
-/*=====================================================================
-	DefaultGrower.h - A default grower for hash tables
-
-	Author: Per Nilsson
-
-	Freeware and no copyright on my behalf. However, if you use the 
-	code in some manner	I'd appreciate a notification about it
-	perfnurt@hotmail.com
-
-	Classes:
-
-		class DefaultGrower
-
-  Requirements:
-		N/A
-
-  Dependencies:
-		std::set
-
-=====================================================================*/
-#if !defined(DEFAULTGROWER_H)
-#define DEFAULTGROWER_H
-
-#if _MSC_VER > 1000
-#pragma once
-#endif // _MSC_VER > 1000
-
-#include <set>
-
-//------------------------------------------------------------------------
-// DefaultGrower 
-class DefaultGrower
-{
-public:
-	// Default constructor
-	DefaultGrower()
-	{
-		// We don't store _ALL_ primes, modify or make your own Grower if 
-		// you find this inapropriate
-		mPrimes.insert(5);
-		mPrimes.insert(11);
-		mPrimes.insert(23);
-		mPrimes.insert(1009);
-		mPrimes.insert(5009);
-		mPrimes.insert(10009);
-		mPrimes.insert(20011);
-		mPrimes.insert(50021);
-		mPrimes.insert(100003);
-		mPrimes.insert(200003);
-		mPrimes.insert(500009);
-	}
-
-	// Name is self explanatory I guess
-	size_t getPrimeGreaterThan(size_t size) const
-	{
-		{
-			PrimeSet::const_iterator i=mPrimes.find(size);
-
-			if (i == mPrimes.end())
-			{
-				// size is not a prime number, gotta go looking for the next 
-				// bigger prime. Only done the first time since queries after
-				// initialization will give a size that is a prime.
-				for (i=mPrimes.begin();i!=mPrimes.end(); ++i)
-				{
-					if (size<(*i))
-						break;
-				}
-			}
-			else
-			{
-				// size is a prime, just pick one following it
-				i++;
-			}
-
-			// DefaultGrower has its limitations
-			if (i == mPrimes.end())
-				throw "Need more primes";
-
-			return (*i);
-		}
-	}
-
-	// Called by HashTable to figure out if the array needs to grow.
-	// If returned value <= currentSize array won't grow.
-	size_t getNewSize(size_t currentSize, size_t freeSlots) const
-	{
-		size_t newSize = currentSize;
-
-		// Simple algoritm: Make sure at least 10% slots are free.
-		while (freeSlots <= (newSize/10))
-		{
-			newSize =  getPrimeGreaterThan(newSize);
-			// As the array grows more slots will be available
-			freeSlots = freeSlots + (newSize-currentSize); 
-		}
-		return newSize;
-	}
-
-
-private:
-	//------------------------------------------------------------------
-	// Private Type Definitions
-	//------------------------------------------------------------------
-	typedef std::set<size_t> PrimeSet;
-
-	//------------------------------------------------------------------
-	// Members
-	//------------------------------------------------------------------
-	PrimeSet mPrimes;
-};
-
-#endif // DEFAULTGROWER_H
\ No newline at end of file
+/*=====================================================================
+	DefaultGrower.h - A default grower for hash tables
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the 
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		class DefaultGrower
+
+  Requirements:
+		The Hasher needs the full width () operator, ie without a size.
+
+  Dependencies:
+		FastModulo.h
+
+  If you implement your own Grower:
+		It needs the same public methods as DefaultGrower: 
+		getPrimeGreaterThan() for the initial size, getNewSize() to decide
+		when and how much to grow, getMagic() that the tables keep with
+		each array size, and getIndex() that maps a key to a slot given
+		both. Also getIndexFromHash() if used with a HashCache, and 
+		setMaxLoadFactor()/getMaxLoadFactor() for the tables' 
+		max_load_factor().
+
+=====================================================================*/
+#if !defined(DEFAULTGROWER_H)
+#define DEFAULTGROWER_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include "FastModulo.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h> // _BitScanReverse
+#endif
+
+//------------------------------------------------------------------------
+// DefaultGrower 
+// Array sizes are primes, one for every power of two from 5 to about 2^47
+// (as far as size_t goes). Each prime comes with the reciprocal FastModulo
+// uses, so mapping a hash value to a slot doesn't divide.
+class DefaultGrower
+{
+public:
+	// Default constructor
+	DefaultGrower():mMaxLoadFactor(0.9) {}
+
+	// The largest fraction of the slots that may be in use before the 
+	// array grows, 0 < factor < 1. 
+	void setMaxLoadFactor(float factor)
+	{
+		if (!(factor > 0 && factor < 1))
+			throw "Invalid max load factor";
+		mMaxLoadFactor = factor;
+	}
+	float getMaxLoadFactor() const { return float(mMaxLoadFactor); }
+
+	// Name is self explanatory I guess. Actually the smallest of the
+	// grower's primes greater than size.
+	size_t getPrimeGreaterThan(size_t size) const
+	{
+		// The prime for the power of two size is in, or the next one
+		size_t index = size < 4 ? 0 : floorLog2(size) - 2;
+		if (index < cPrimes && getPrimes()[index].prime <= size)
+			index++;
+
+		// DefaultGrower has its limitations
+		if (index >= cPrimes || getPrimes()[index].magic == 0)
+			throw "Need more primes";
+
+		return static_cast<size_t>(getPrimes()[index].prime);
+	}
+
+	// Called by HashTable to figure out if the array needs to grow.
+	// If returned value <= currentSize array won't grow.
+	size_t getNewSize(size_t currentSize, size_t freeSlots) const
+	{
+		size_t newSize = currentSize;
+
+		// Simple algoritm: Make sure the slots in use don't exceed the max
+		// load factor, by default 90%.
+		while (freeSlots <= getMinFreeSlots(newSize))
+		{
+			newSize =  getPrimeGreaterThan(newSize);
+			// As the array grows more slots will be available
+			freeSlots = freeSlots + (newSize-currentSize); 
+		}
+		return newSize;
+	}
+
+	// Called by HashTable when the array size changes, it passes the
+	// result along with allocated to getIndex(). The reciprocal of
+	// allocated if it's one of the primes, 0 if it isn't (eg from a 
+	// custom grower wrapping this one).
+	size_t getMagic(size_t allocated) const
+	{
+		if (allocated >= 4)
+		{
+			size_t index = floorLog2(allocated) - 2;
+			if (index < cPrimes && getPrimes()[index].prime == allocated)
+				return getPrimes()[index].magic;
+		}
+		return 0;
+	}
+
+	// Called by HashTable to map key to a slot in an array of size 
+	// allocated, magic is getMagic(allocated).
+	template <class MyHasher, class Key>
+	size_t getIndex(MyHasher& hasher, const Key& key, size_t allocated, size_t magic) const
+	{
+		return getIndexFromHash(hasher(key), allocated, magic);
+	}
+
+	// Same as above for a full width hash value, also used by HashCache.
+	size_t getIndexFromHash(size_t hashValue, size_t allocated, size_t magic) const
+	{
+		if (magic != 0)
+			return FastModulo<sizeof(size_t)>::mod(hashValue, allocated, magic);
+		return hashValue % allocated;
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Private Type Definitions
+	//------------------------------------------------------------------
+	struct Prime
+	{
+		unsigned long long prime;
+		size_t magic; // FastModulo's reciprocal, 0 if prime doesn't fit a size_t
+	};
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	enum { cPrimes = 46 };
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	// The primes, the one at index i is between 2^(i+2) and 2^(i+3), as far
+	// as possible from both. The table is constant initialized, ie it's
+	// set up before any code runs.
+	static const Prime* getPrimes()
+	{
+#define DEFAULTGROWER_PRIME(p) { p, size_t(~size_t(0) / (p)) }
+		static const Prime primes[cPrimes] =
+		{
+			DEFAULTGROWER_PRIME(5ULL), DEFAULTGROWER_PRIME(11ULL), DEFAULTGROWER_PRIME(23ULL),
+			DEFAULTGROWER_PRIME(53ULL), DEFAULTGROWER_PRIME(97ULL), DEFAULTGROWER_PRIME(193ULL),
+			DEFAULTGROWER_PRIME(389ULL), DEFAULTGROWER_PRIME(769ULL), DEFAULTGROWER_PRIME(1543ULL),
+			DEFAULTGROWER_PRIME(3079ULL), DEFAULTGROWER_PRIME(6151ULL), DEFAULTGROWER_PRIME(12289ULL),
+			DEFAULTGROWER_PRIME(24593ULL), DEFAULTGROWER_PRIME(49157ULL), DEFAULTGROWER_PRIME(98317ULL),
+			DEFAULTGROWER_PRIME(196613ULL), DEFAULTGROWER_PRIME(393241ULL), DEFAULTGROWER_PRIME(786433ULL),
+			DEFAULTGROWER_PRIME(1572869ULL), DEFAULTGROWER_PRIME(3145739ULL), DEFAULTGROWER_PRIME(6291469ULL),
+			DEFAULTGROWER_PRIME(12582917ULL), DEFAULTGROWER_PRIME(25165843ULL), DEFAULTGROWER_PRIME(50331653ULL),
+			DEFAULTGROWER_PRIME(100663319ULL), DEFAULTGROWER_PRIME(201326611ULL), DEFAULTGROWER_PRIME(402653189ULL),
+			DEFAULTGROWER_PRIME(805306457ULL), DEFAULTGROWER_PRIME(1610612741ULL), DEFAULTGROWER_PRIME(3221225473ULL),
+			DEFAULTGROWER_PRIME(6442450967ULL), DEFAULTGROWER_PRIME(12884901893ULL), DEFAULTGROWER_PRIME(25769803799ULL),
+			DEFAULTGROWER_PRIME(51539607599ULL), DEFAULTGROWER_PRIME(103079215111ULL), DEFAULTGROWER_PRIME(206158430209ULL),
+			DEFAULTGROWER_PRIME(412316860441ULL), DEFAULTGROWER_PRIME(824633720837ULL), DEFAULTGROWER_PRIME(1649267441681ULL),
+			DEFAULTGROWER_PRIME(3298534883417ULL), DEFAULTGROWER_PRIME(6597069766657ULL), DEFAULTGROWER_PRIME(13194139533349ULL),
+			DEFAULTGROWER_PRIME(26388279066671ULL), DEFAULTGROWER_PRIME(52776558133303ULL), DEFAULTGROWER_PRIME(105553116266509ULL),
+			DEFAULTGROWER_PRIME(211106232533047ULL)
+		};
+#undef DEFAULTGROWER_PRIME
+		return primes;
+	}
+
+	// Slots that must be free in an array of size, see getNewSize()
+	size_t getMinFreeSlots(size_t size) const
+	{
+		return size - size_t(size * mMaxLoadFactor);
+	}
+
+	// Index of the highest bit set, value must not be 0
+	static size_t floorLog2(size_t value)
+	{
+#if defined(__GNUC__)
+		return 63 - __builtin_clzll(value);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index;
+#elif defined(_MSC_VER) && _MSC_VER >= 1400
+		unsigned long index;
+		_BitScanReverse(&index, value);
+		return index;
+#else
+		size_t index = 0;
+		while (value >>= 1)
+		{
+			index++;
+		}
+		return index;
+#endif
+	}
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	double mMaxLoadFactor;
+};
+
+#endif // DEFAULTGROWER_H
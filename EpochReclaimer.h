@@ -0,0 +1,299 @@
+/*=====================================================================
+	EpochReclaimer.h - Epoch based memory reclamation
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		class EpochReclaimer
+		{
+			// One per reading thread
+			class Reader
+
+			// Inside an epoch for the lifetime of the object
+			class ReadGuard
+		}
+
+  Requirements:
+		C++11 (std::atomic, std::mutex)
+
+  Dependencies:
+		No external dependencies
+
+  How it works:
+		There's a global epoch counter. A reader announces the epoch it
+		saw when it starts reading, and withdraws the announcement when
+		it's done. Something unlinked by a writer is retired rather than
+		deleted, tagged with the epoch at the time. The epoch only moves on
+		when every reader inside one has announced the current epoch, so
+		once it has moved on twice no reader can still hold a pointer to
+		what was retired, and it's deleted.
+		Readers don't wait and don't do any atomic read-modify-write, just
+		a store and a fence to their own (cache line padded) record.
+
+=====================================================================*/
+#if !defined(EPOCHRECLAIMER_H)
+#define EPOCHRECLAIMER_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+//------------------------------------------------------------------------
+// EpochReclaimer
+// retire() and reclaim() must be called by one thread at a time, ie by
+// writers that are serialized anyway. Readers may come and go from any
+// thread, each with a Reader of its own.
+class EpochReclaimer
+{
+	struct Record;
+
+public:
+	//------------------------------------------------------------------
+	// Public Classes
+	//------------------------------------------------------------------
+	// class Reader
+	// Registers a reading thread, which then enters and leaves epochs
+	// through it, eg with a ReadGuard. Registering takes a lock, so it's
+	// meant to be done once per thread rather than per read. A Reader
+	// must only be used by one thread at a time.
+	class Reader
+	{
+	public:
+		explicit Reader(EpochReclaimer& reclaimer):mReclaimer(reclaimer), mRecord(reclaimer.acquireRecord()), mDepth(0) {}
+
+		~Reader()
+		{
+			mReclaimer.releaseRecord(mRecord);
+		}
+
+		// Nested calls only announce the epoch for the outermost one
+		void enter()
+		{
+			if (mDepth++ == 0)
+			{
+				// Acquire, as whatever was retired before the epoch moved on
+				// has been unlinked
+				mRecord->epoch.store(mReclaimer.mEpoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+				// The announcement must be visible before any pointer is read
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+		}
+
+		void leave()
+		{
+			if (--mDepth == 0)
+				mRecord->epoch.store(cQuiescent, std::memory_order_release);
+		}
+
+	private:
+		// Disabled
+		Reader(const Reader&);
+		Reader& operator = (const Reader&);
+
+		EpochReclaimer& mReclaimer;
+		Record* mRecord;
+		size_t mDepth;
+	};
+
+	// class ReadGuard
+	// Inside an epoch, ie pointers read from the protected structure
+	// stay valid, until it goes out of scope.
+	class ReadGuard
+	{
+	public:
+		explicit ReadGuard(Reader& reader):mReader(reader)
+		{
+			mReader.enter();
+		}
+
+		~ReadGuard()
+		{
+			mReader.leave();
+		}
+
+	private:
+		// Disabled
+		ReadGuard(const ReadGuard&);
+		ReadGuard& operator = (const ReadGuard&);
+
+		Reader& mReader;
+	};
+
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	EpochReclaimer():mEpoch(1) {}
+
+	// All readers must be gone. Whatever is still retired is deleted.
+	~EpochReclaimer()
+	{
+		for (size_t i=0;i<mRetired.size();++i)
+		{
+			mRetired[i].deleter(mRetired[i].pointer);
+		}
+		for (size_t i=0;i<mRecords.size();++i)
+		{
+			delete mRecords[i];
+		}
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+	// Things retired but not yet deleted
+	size_t getRetiredCount() const { return mRetired.size(); }
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+	// pointer is no longer reachable for new readers, deleter(pointer) is
+	// called once the ones that may have seen it are done.
+	void retire(void* pointer, void (*deleter)(void*))
+	{
+		Retired retired;
+		retired.pointer = pointer;
+		retired.deleter = deleter;
+		retired.epoch = mEpoch.load(std::memory_order_relaxed);
+		mRetired.push_back(retired);
+	}
+
+	// Same as above, for something to delete
+	template <class T>
+	void retire(T* pointer)
+	{
+		retire(pointer, &deleteObject<T>);
+	}
+
+	// Moves the epoch on if all readers have caught up, and deletes what
+	// no reader can see any more. Cheap enough to call after every write
+	// when writes are rare, it looks at each reader's record once.
+	void reclaim()
+	{
+		if (mRetired.empty())
+			return;
+
+		// Whatever was unlinked before must be visible to readers entering
+		// after the records have been read
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		size_t epoch = mEpoch.load(std::memory_order_relaxed);
+		bool caughtUp = true;
+		{
+			std::lock_guard<std::mutex> lock(mRecordMutex);
+			for (size_t i=0;i<mRecords.size() && caughtUp;++i)
+			{
+				size_t readerEpoch = mRecords[i]->epoch.load(std::memory_order_acquire);
+				caughtUp = readerEpoch == cQuiescent || readerEpoch == epoch;
+			}
+		}
+		if (caughtUp)
+		{
+			epoch++;
+			mEpoch.store(epoch, std::memory_order_release);
+		}
+
+		// Two epochs later no reader can hold it
+		size_t kept = 0;
+		for (size_t i=0;i<mRetired.size();++i)
+		{
+			if (mRetired[i].epoch + 2 <= epoch)
+				mRetired[i].deleter(mRetired[i].pointer);
+			else
+				mRetired[kept++] = mRetired[i];
+		}
+		mRetired.resize(kept);
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	EpochReclaimer(const EpochReclaimer&);
+
+	// Assignment operator
+	EpochReclaimer& operator = (const EpochReclaimer&);
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	// A reader's epoch when it's not reading, the global one is never 0
+	enum { cQuiescent = 0 };
+
+	// Assumed cache line size
+	enum { cCacheLine = 64 };
+
+	//------------------------------------------------------------------
+	// Private Classes
+	//------------------------------------------------------------------
+	// A reader's announced epoch, alone on its cache line so that readers
+	// don't slow each other down.
+	struct Record
+	{
+		Record():epoch(cQuiescent), inUse(false) {}
+
+		std::atomic<size_t> epoch;
+		bool inUse; // Guarded by mRecordMutex
+		char padding[cCacheLine];
+	};
+
+	struct Retired
+	{
+		void* pointer;
+		void (*deleter)(void*);
+		size_t epoch;
+	};
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	// Records are reused, and only deleted with the reclaimer
+	Record* acquireRecord()
+	{
+		std::lock_guard<std::mutex> lock(mRecordMutex);
+		for (size_t i=0;i<mRecords.size();++i)
+		{
+			if (!mRecords[i]->inUse)
+			{
+				mRecords[i]->inUse = true;
+				return mRecords[i];
+			}
+		}
+		mRecords.push_back(new Record);
+		mRecords.back()->inUse = true;
+		return mRecords.back();
+	}
+
+	void releaseRecord(Record* record)
+	{
+		record->epoch.store(cQuiescent, std::memory_order_release);
+
+		std::lock_guard<std::mutex> lock(mRecordMutex);
+		record->inUse = false;
+	}
+
+	template <class T>
+	static void deleteObject(void* pointer)
+	{
+		delete static_cast<T*>(pointer);
+	}
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	std::atomic<size_t> mEpoch;
+	std::mutex mRecordMutex;
+	std::vector<Record*> mRecords;	// Guarded by mRecordMutex
+	std::vector<Retired> mRetired;	// Only touched by the writer
+};
+
+#endif // !defined(EPOCHRECLAIMER_H)
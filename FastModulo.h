@@ -0,0 +1,85 @@
+/*=====================================================================
+	FastModulo.h - Remainder by a reciprocal multiplication
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		template <int Bytes> struct FastModulo
+
+  Requirements:
+		N/A
+
+  Dependencies:
+		No external dependencies
+
+=====================================================================*/
+#if !defined(FASTMODULO_H)
+#define FASTMODULO_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <stddef.h> // size_t
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+#include <intrin.h> // __umulh
+#endif
+
+//------------------------------------------------------------------------
+// FastModulo
+// value % divisor without a division, for a divisor known in advance.
+// magic is the reciprocal (2^bits-1)/divisor, worked out once per divisor
+// (DefaultGrower keeps one with each of its primes). The high half of
+// value*magic is then the quotient or at most two less. So the remainder
+// takes a multiplication, a multiply-subtract and a correction or two.
+// For 32 and 64 bit size_t.
+template <int Bytes> struct FastModulo;
+
+template <> struct FastModulo<4>
+{
+	static size_t mod(size_t value, size_t divisor, size_t magic)
+	{
+		size_t quotient = static_cast<size_t>(((unsigned long long)value * magic) >> 32);
+		size_t remainder = value - quotient * divisor;
+		while (remainder >= divisor)
+			remainder -= divisor;
+		return remainder;
+	}
+};
+
+template <> struct FastModulo<8>
+{
+	static size_t mod(size_t value, size_t divisor, size_t magic)
+	{
+		size_t quotient = static_cast<size_t>(mulHigh(value, magic));
+		size_t remainder = value - quotient * divisor;
+		while (remainder >= divisor)
+			remainder -= divisor;
+		return remainder;
+	}
+
+	// The high 64 bits of the 128 bit product
+	static unsigned long long mulHigh(unsigned long long a, unsigned long long b)
+	{
+#if defined(__SIZEOF_INT128__)
+		return (unsigned long long)(((unsigned __int128)a * b) >> 64);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+		return __umulh(a, b);
+#else
+		unsigned long long aLow = a & 0xffffffffu, aHigh = a >> 32;
+		unsigned long long bLow = b & 0xffffffffu, bHigh = b >> 32;
+		unsigned long long low = aLow * bLow;
+		unsigned long long middle1 = aHigh * bLow + (low >> 32);
+		unsigned long long middle2 = aLow * bHigh + (middle1 & 0xffffffffu);
+		return aHigh * bHigh + (middle1 >> 32) + (middle2 >> 32);
+#endif
+	}
+};
+
+#endif // FASTMODULO_H
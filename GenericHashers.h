@@ -1,76 +1,108 @@
-/*=====================================================================
-	GenericHashers.h - Some generis hasher classes
-
-	Author: Per Nilsson
-
-	Freeware and no copyright on my behalf. However, if you use the 
-	code in some manner	I'd appreciate a notification about it
-	perfnurt@hotmail.com
-
-	Classes:
-
-		class Hasher<int>
-
-		class Hasher<const char*>
-
-  Requirements:
-		N/A
-
-  Dependencies:
-		No external dependencies
-
-=====================================================================*/
-
-#if !defined(GENERICHASHERS_H)
-#define GENERICHASHERS_H
-
-#if _MSC_VER > 1000
-#pragma once
-#endif // _MSC_VER > 1000
-
-// A generic, empty, template for the hash function. 
-template <class Key> class Hasher;
-
-// If you implement your own Hasher: 
-//   It's supposed to work like a function object (aka functor): It should have
-//   a () operator defined that takes a const Key& and a size_t and return 
-//   a size_t. See the generic hashers below...
-//   Note: 
-//     It's only required to have the proper () operator, it doesn't have
-//     to be dependant on the classes below.
-//------------------------------------------------------------------------ 
-// Some generic hashers
-
-// int
-class Hasher<int>
-{
-public:
-	size_t operator ()(const int& key, size_t size)
-	{
-		return (static_cast<unsigned int>(key)) % size;
-	}
-};
-
-// const char*
-class Hasher<const char*>
-{
-public:
-	size_t operator ()(const char* key, size_t size)
-	{
-		// This is a rather common string hasher algorithm. Don't ask me to explain it :-P
-
-		size_t h = 0;
-		size_t g;
-		while (*key)
-		{
-			h = (h << 4) + *key++;
-
-			if ( (g = h & 0xF0000000)!=0)
-				h ^= g >> 24;
-			h &= ~g;
-		}
-		return (h % size);
-	}
-};
-
+/*=====================================================================
+	GenericHashers.h - Some generis hasher classes
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the 
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		class Hasher<int>
+
+		class Hasher<const char*>
+
+  Requirements:
+		A Hasher of your own needs the full width () operator, the one
+		that takes just the key, to be used with DefaultGrower or
+		PowerOfTwoGrower. See below.
+
+  Dependencies:
+		No external dependencies
+
+=====================================================================*/
+
+#if !defined(GENERICHASHERS_H)
+#define GENERICHASHERS_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <stddef.h> // size_t
+
+// A generic, empty, template for the hash function. 
+template <class Key> class Hasher;
+
+// If you implement your own Hasher: 
+//   It's supposed to work like a function object (aka functor): It should have
+//   a () operator defined that takes a const Key& and returns the full width
+//   hash value as a size_t, ie not reduced to any size. The growers 
+//   (DefaultGrower, PowerOfTwoGrower) map it to a slot themselves, and won't
+//   compile without it. See the generic hashers below...
+//   A hasher written for the older () operator, that takes a const Key& and
+//   a size_t and returns the hash value modulo the size, is ported by adding
+//   the full width one, eg as the old one without the modulo. The old one
+//   is only needed by growers of your own that call it.
+//   Note: 
+//     It's only required to have the proper () operator(s), it doesn't have
+//     to be dependant on the classes below.
+//------------------------------------------------------------------------ 
+// Some generic hashers
+
+// int
+template <> class Hasher<int>
+{
+public:
+	size_t operator ()(const int& key, size_t size)
+	{
+		return (*this)(key) % size;
+	}
+
+	size_t operator ()(const int& key)
+	{
+		return static_cast<unsigned int>(key);
+	}
+};
+
+// FNV-1a parameters for 32 and 64 bit size_t
+template <int Bytes> struct FnvParameters;
+
+template <> struct FnvParameters<4>
+{
+	static size_t offset() { return 2166136261u; }
+	static size_t prime() { return 16777619u; }
+};
+
+template <> struct FnvParameters<8>
+{
+	static size_t offset() { return static_cast<size_t>(14695981039346656037ULL); }
+	static size_t prime() { return static_cast<size_t>(1099511628211ULL); }
+};
+
+// const char*
+template <> class Hasher<const char*>
+{
+public:
+	size_t operator ()(const char* key, size_t size)
+	{
+		return (*this)(key) % size;
+	}
+
+	// FNV-1a, all bits of the result depend on the whole string
+	size_t operator ()(const char* key)
+	{
+		typedef FnvParameters<sizeof(size_t)> Fnv;
+
+		size_t h = Fnv::offset();
+		while (*key)
+		{
+			h ^= static_cast<unsigned char>(*key++);
+			h *= Fnv::prime();
+		}
+		return h;
+	}
+};
+
 #endif // GENERICHASHERS_H
\ No newline at end of file
@@ -0,0 +1,604 @@
+/*=====================================================================
+	HashBench.cpp - Micro benchmarks of the hash tables
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+  Requirements:
+		C++11, builds with GCC or Clang (see Makefile) as well as MSVC,
+		together with HashBenchAlloc.cpp. Doesn't need MFC, unlike
+		TestHash.cpp.
+
+  Usage:
+		HashBench [--sizes n,n,...] [--loads f,f,...] [--keys k,k,...]
+		          [--tables t,t,...] [--min-ops n]
+
+		--sizes    Element counts, default 1000,10000,...,100000000
+		--loads    Max load factors, default 0.5,0.7,0.9. Tables that
+		           can't set one are only run once, at their own, and
+		           reported with load factor 0. For std::unordered_map
+		           it's elements per bucket.
+		--keys     sequential, uniform and/or zipf, default all three
+		--tables   Names as printed, default all
+		--min-ops  Small tables repeat an operation until it has been
+		           done at least this many times, default 1000000
+
+  Output:
+		CSV on stdout, one line per table, key distribution, size, load
+		factor and operation:
+		table,keys,size,load_factor,operation,ns_per_op,bytes_per_entry
+		The operations are insert (into an empty table, so including its
+		growth), hit and miss (lookups of stored and not stored keys),
+		iterate (per element), resize (a rehash to four times the size,
+		per element) and erase (of every element). bytes_per_entry is all
+		the table had allocated once filled, divided by size. The exit
+		code is 1 if a table got something wrong on the way.
+
+  Keys:
+		sequential  0, 1, 2... inserted and looked up in order
+		uniform     scattered 31 bit keys, looked up at random
+		zipf        the same keys, looked up with a Zipfian skew (0.99),
+		            so a few hot keys get most of the lookups
+
+=====================================================================*/
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GenericHashers.h"
+#include "DefaultGrower.h"
+#include "PowerOfTwoGrower.h"
+#include "HashTableChained.h"
+#include "HashTableProbed.h"
+#include "HashTableRobinHood.h"
+#include "HashTableSwiss.h"
+
+// All the bytes currently allocated by operator new, see HashBenchAlloc.cpp
+size_t getAllocatedBytes();
+
+//-----------------------------------------------------------------------
+// Table operations. The repo's tables share an interface, the ones that
+// can't set a load factor or rehash on demand, and std::unordered_map,
+// get their own.
+//-----------------------------------------------------------------------
+template <class Table>
+struct BasicTableOps
+{
+	static Table* create() { return new Table(0); }
+	static bool insert(Table& table, int key, int value) { return table.insert(key, value); }
+
+	static const int* find(Table& table, int key)
+	{
+		typename Table::iterator it = table.find(key);
+		return it == table.end() ? 0 : &(*it).second;
+	}
+};
+
+template <class Table>
+struct TableOps : public BasicTableOps<Table>
+{
+	static bool setMaxLoadFactor(Table& table, float factor) { table.max_load_factor(factor); return true; }
+	static bool rehash(Table& table, size_t n) { table.rehash(n); return true; }
+};
+
+// Fixed load factor, and no rehash()
+template <class Table>
+struct FixedTableOps : public BasicTableOps<Table>
+{
+	static bool setMaxLoadFactor(Table&, float) { return false; }
+	static bool rehash(Table&, size_t) { return false; }
+};
+
+template <class Key, class Value, class MyHasher, class MyGrower>
+struct TableOps<HashTableSwiss<Key, Value, MyHasher, MyGrower> > : public FixedTableOps<HashTableSwiss<Key, Value, MyHasher, MyGrower> > {};
+
+template <class Key, class Value, class MyHasher, class MyGrower>
+struct TableOps<HashTableRobinHood<Key, Value, MyHasher, MyGrower> > : public FixedTableOps<HashTableRobinHood<Key, Value, MyHasher, MyGrower> > {};
+
+template <>
+struct TableOps<std::unordered_map<int, int> >
+{
+	typedef std::unordered_map<int, int> Table;
+
+	static Table* create() { return new Table; }
+	static bool setMaxLoadFactor(Table& table, float factor) { table.max_load_factor(factor); return true; }
+	static bool insert(Table& table, int key, int value) { return table.insert(Table::value_type(key, value)).second; }
+	static bool rehash(Table& table, size_t n) { table.rehash(n); return true; }
+
+	static const int* find(Table& table, int key)
+	{
+		Table::iterator it = table.find(key);
+		return it == table.end() ? 0 : &it->second;
+	}
+};
+
+//-----------------------------------------------------------------------
+// Keys
+//-----------------------------------------------------------------------
+enum Distribution { cSequential, cUniform, cZipf };
+
+static const char* getDistributionName(Distribution distribution)
+{
+	switch (distribution)
+	{
+	case cSequential: return "sequential";
+	case cUniform: return "uniform";
+	default: return "zipf";
+	}
+}
+
+// splitmix64, so that runs are repeatable
+class Random
+{
+public:
+	explicit Random(unsigned long long seed):mState(seed) {}
+
+	unsigned long long next()
+	{
+		unsigned long long z = (mState += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	// [0, n)
+	size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+
+	// [0, 1)
+	double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+	unsigned long long mState;
+};
+
+// The i:th key of the uniform and zipf distributions. Multiplying by an
+// odd number is a bijection modulo 2^31, so the keys are all different,
+// and ones for i >= n are never inserted.
+static int getScatteredKey(size_t i)
+{
+	return static_cast<int>((static_cast<unsigned long long>(i) * 2654435761ULL) & 0x7fffffff);
+}
+
+// Ranks 0..n-1 with a Zipfian skew, as in Gray et al, "Quickly
+// generating billion-record synthetic databases"
+class Zipf
+{
+public:
+	Zipf(size_t n, double theta):mN(n), mTheta(theta)
+	{
+		mZetaN = 0;
+		for (size_t i=1;i<=n;++i)
+		{
+			mZetaN += 1.0 / pow(double(i), theta);
+		}
+		double zeta2 = 1.0 + 1.0 / pow(2.0, theta);
+		mAlpha = 1.0 / (1.0 - theta);
+		mEta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / mZetaN);
+	}
+
+	size_t next(Random& random) const
+	{
+		double u = random.unit();
+		double uz = u * mZetaN;
+		if (uz < 1.0)
+			return 0;
+		if (uz < 1.0 + pow(0.5, mTheta))
+			return mN > 1 ? 1 : 0;
+		size_t rank = static_cast<size_t>(mN * pow(mEta*u - mEta + 1.0, mAlpha));
+		return rank < mN ? rank : mN - 1;
+	}
+
+private:
+	size_t mN;
+	double mTheta;
+	double mZetaN;
+	double mAlpha;
+	double mEta;
+};
+
+// What a run inserts and looks up
+struct KeySet
+{
+	std::vector<int> inserted;	// In insert order
+	std::vector<int> hits;		// Lookups of inserted keys
+	std::vector<int> misses;	// Lookups of keys not inserted
+};
+
+static void makeKeys(Distribution distribution, size_t n, KeySet& keys)
+{
+	Random random(n);
+	keys.inserted.resize(n);
+	keys.hits.resize(n);
+	keys.misses.resize(n);
+
+	size_t i;
+	for (i=0;i<n;++i)
+	{
+		keys.inserted[i] = distribution == cSequential ? int(i) : getScatteredKey(i);
+	}
+
+	if (distribution == cZipf)
+	{
+		Zipf zipf(n, 0.99);
+		for (i=0;i<n;++i)
+		{
+			keys.hits[i] = keys.inserted[zipf.next(random)];
+		}
+	}
+	else
+	{
+		for (i=0;i<n;++i)
+		{
+			keys.hits[i] = distribution == cSequential ? keys.inserted[i] : keys.inserted[random.below(n)];
+		}
+	}
+
+	for (i=0;i<n;++i)
+	{
+		keys.misses[i] = distribution == cSequential ? int(n + i) : getScatteredKey(n + random.below(n));
+	}
+}
+
+//-----------------------------------------------------------------------
+// Measuring
+//-----------------------------------------------------------------------
+struct Settings
+{
+	Settings():minOps(1000000) {}
+
+	std::vector<size_t> sizes;
+	std::vector<float> loads;
+	std::vector<Distribution> distributions;
+	std::vector<std::string> tables;
+	size_t minOps;
+};
+
+static bool gFailed = false;
+
+// Keeps the compiler from throwing away lookups. Unsigned, so that the
+// sums may wrap around.
+static volatile unsigned int gSink = 0;
+
+class Stopwatch
+{
+public:
+	Stopwatch():mStart(std::chrono::steady_clock::now()) {}
+
+	double getNanoseconds() const
+	{
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - mStart).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point mStart;
+};
+
+static void report(const char* table, Distribution distribution, size_t size, float load, const char* operation, double ns, size_t ops, double bytesPerEntry)
+{
+	printf("%s,%s,%lu,%.2f,%s,%.2f,%.1f\n", table, getDistributionName(distribution), (unsigned long)size, load, operation, ns / (ops > 0 ? ops : 1), bytesPerEntry);
+	fflush(stdout);
+}
+
+static void check(bool ok, const char* table, const char* what)
+{
+	if (!ok)
+	{
+		fprintf(stderr, "%s: %s\n", table, what);
+		gFailed = true;
+	}
+}
+
+// One table with one key set and load factor. Returns false if the table
+// can't set the load factor.
+template <class Table>
+bool runTable(const char* name, const Settings& settings, Distribution distribution, const KeySet& keys, float load)
+{
+	typedef TableOps<Table> Ops;
+
+	size_t n = keys.inserted.size();
+	size_t reps = settings.minOps / n > 0 ? settings.minOps / n : 1;
+	size_t lookups = n > settings.minOps ? n : settings.minOps;
+
+	// insert, the last table is kept for the other operations
+	Table* table = 0;
+	float reportedLoad = load;
+	double insertNs = 0;
+	double bytesPerEntry = 0;
+	size_t i;
+	for (size_t rep=0;rep<reps;++rep)
+	{
+		delete table;
+		size_t before = getAllocatedBytes();
+		table = Ops::create();
+		if (!Ops::setMaxLoadFactor(*table, load))
+		{
+			if (load != settings.loads[0])
+			{
+				delete table;
+				return false;
+			}
+			reportedLoad = 0;
+		}
+
+		Stopwatch stopwatch;
+		for (i=0;i<n;++i)
+		{
+			Ops::insert(*table, keys.inserted[i], int(i));
+		}
+		insertNs += stopwatch.getNanoseconds();
+		bytesPerEntry = double(getAllocatedBytes() - before) / n;
+	}
+	check(table->size() == n, name, "wrong size after insert");
+	report(name, distribution, n, reportedLoad, "insert", insertNs, reps*n, bytesPerEntry);
+
+	// hit
+	{
+		size_t found = 0;
+		unsigned int sum = 0;
+		Stopwatch stopwatch;
+		for (i=0;i<lookups;++i)
+		{
+			const int* value = Ops::find(*table, keys.hits[i % n]);
+			if (value != 0)
+			{
+				found++;
+				sum += unsigned(*value);
+			}
+		}
+		double ns = stopwatch.getNanoseconds();
+		gSink = sum;
+		check(found == lookups, name, "hit not found");
+		report(name, distribution, n, reportedLoad, "hit", ns, lookups, bytesPerEntry);
+	}
+
+	// miss
+	{
+		size_t found = 0;
+		Stopwatch stopwatch;
+		for (i=0;i<lookups;++i)
+		{
+			if (Ops::find(*table, keys.misses[i % n]) != 0)
+				found++;
+		}
+		double ns = stopwatch.getNanoseconds();
+		check(found == 0, name, "miss found");
+		report(name, distribution, n, reportedLoad, "miss", ns, lookups, bytesPerEntry);
+	}
+
+	// iterate
+	{
+		size_t visited = 0;
+		unsigned int sum = 0;
+		Stopwatch stopwatch;
+		for (size_t rep=0;rep<reps;++rep)
+		{
+			for (typename Table::iterator it=table->begin();it!=table->end();++it)
+			{
+				sum += unsigned((*it).second);
+				visited++;
+			}
+		}
+		double ns = stopwatch.getNanoseconds();
+		gSink = sum;
+		check(visited == reps*n, name, "iterated the wrong number of elements");
+		report(name, distribution, n, reportedLoad, "iterate", ns, visited, bytesPerEntry);
+	}
+
+	// resize
+	{
+		Stopwatch stopwatch;
+		if (Ops::rehash(*table, 4*n))
+		{
+			double ns = stopwatch.getNanoseconds();
+			check(table->size() == n && Ops::find(*table, keys.inserted[n/2]) != 0, name, "lost elements in resize");
+			report(name, distribution, n, reportedLoad, "resize", ns, n, bytesPerEntry);
+		}
+	}
+
+	// erase
+	{
+		size_t erased = 0;
+		Stopwatch stopwatch;
+		for (i=0;i<n;++i)
+		{
+			erased += table->erase(keys.inserted[i]);
+		}
+		double ns = stopwatch.getNanoseconds();
+		check(erased == n && table->size() == 0, name, "wrong number of elements erased");
+		report(name, distribution, n, reportedLoad, "erase", ns, n, bytesPerEntry);
+	}
+
+	delete table;
+	return true;
+}
+
+// A table as the collection of a HashTableChained's buckets. Starts at
+// the smallest size rather than the default 1000, which every bucket
+// would allocate.
+template <class Table>
+struct NestedTable : public Table
+{
+	NestedTable():Table(0) {}
+};
+
+// A table configuration, by name
+struct TableConfig
+{
+	const char* name;
+	bool (*run)(const char*, const Settings&, Distribution, const KeySet&, float);
+};
+
+static const TableConfig cConfigs[] =
+{
+	{ "chained", &runTable<HashTableChained<int, int> > },
+	{ "chained_map", &runTable<HashTableChained<int, int, Hasher<int>, DefaultGrower, std::map<int, int> > > },
+	{ "chained_pool", &runTable<HashTableChained<int, int, Hasher<int>, DefaultGrower, InlineBucket<int, int>, PoolAllocator> > },
+	{ "chained_probed", &runTable<HashTableChained<int, int, Hasher<int>, DefaultGrower, NestedTable<HashTableProbed<int, int> > > > },
+	{ "chained_chained", &runTable<HashTableChained<int, int, Hasher<int>, DefaultGrower, NestedTable<HashTableChained<int, int> > > > },
+	{ "probed", &runTable<HashTableProbed<int, int> > },
+	{ "probed_pow2", &runTable<HashTableProbed<int, int, Hasher<int>, PowerOfTwoGrower> > },
+	{ "swiss", &runTable<HashTableSwiss<int, int> > },
+	{ "robinhood", &runTable<HashTableRobinHood<int, int> > },
+	{ "std_unordered_map", &runTable<std::unordered_map<int, int> > },
+};
+
+//-----------------------------------------------------------------------
+// Command line
+//-----------------------------------------------------------------------
+static std::vector<std::string> split(const char* list)
+{
+	std::vector<std::string> parts;
+	std::string part;
+	for (const char* p=list;;++p)
+	{
+		if (*p == ',' || *p == 0)
+		{
+			if (!part.empty())
+				parts.push_back(part);
+			part.clear();
+			if (*p == 0)
+				break;
+		}
+		else
+			part += *p;
+	}
+	return parts;
+}
+
+static bool parseArguments(int argc, char* argv[], Settings& settings)
+{
+	for (int arg=1;arg<argc;++arg)
+	{
+		if (arg + 1 >= argc)
+			return false;
+
+		std::vector<std::string> values = split(argv[arg+1]);
+		size_t i;
+		if (strcmp(argv[arg], "--sizes") == 0)
+		{
+			for (i=0;i<values.size();++i)
+			{
+				settings.sizes.push_back(strtoul(values[i].c_str(), 0, 10));
+				if (settings.sizes.back() == 0 || settings.sizes.back() > 0x3fffffff)
+					return false;
+			}
+		}
+		else if (strcmp(argv[arg], "--loads") == 0)
+		{
+			for (i=0;i<values.size();++i)
+			{
+				settings.loads.push_back(float(atof(values[i].c_str())));
+				if (!(settings.loads.back() > 0 && settings.loads.back() < 1))
+					return false;
+			}
+		}
+		else if (strcmp(argv[arg], "--keys") == 0)
+		{
+			for (i=0;i<values.size();++i)
+			{
+				if (values[i] == "sequential")
+					settings.distributions.push_back(cSequential);
+				else if (values[i] == "uniform")
+					settings.distributions.push_back(cUniform);
+				else if (values[i] == "zipf")
+					settings.distributions.push_back(cZipf);
+				else
+					return false;
+			}
+		}
+		else if (strcmp(argv[arg], "--tables") == 0)
+			settings.tables = values;
+		else if (strcmp(argv[arg], "--min-ops") == 0)
+			settings.minOps = strtoul(argv[arg+1], 0, 10);
+		else
+			return false;
+		arg++;
+	}
+
+	if (settings.sizes.empty())
+	{
+		for (size_t size=1000;size<=100000000;size*=10)
+		{
+			settings.sizes.push_back(size);
+		}
+	}
+	if (settings.loads.empty())
+	{
+		settings.loads.push_back(0.5f);
+		settings.loads.push_back(0.7f);
+		settings.loads.push_back(0.9f);
+	}
+	if (settings.distributions.empty())
+	{
+		settings.distributions.push_back(cSequential);
+		settings.distributions.push_back(cUniform);
+		settings.distributions.push_back(cZipf);
+	}
+	if (settings.minOps == 0)
+		settings.minOps = 1;
+	return true;
+}
+
+static bool isSelected(const Settings& settings, const char* table)
+{
+	if (settings.tables.empty())
+		return true;
+	for (size_t i=0;i<settings.tables.size();++i)
+	{
+		if (settings.tables[i] == table)
+			return true;
+	}
+	return false;
+}
+
+int main(int argc, char* argv[])
+{
+	Settings settings;
+	if (!parseArguments(argc, argv, settings))
+	{
+		fprintf(stderr, "Usage: %s [--sizes n,n,...] [--loads f,f,...] [--keys sequential,uniform,zipf] [--tables t,t,...] [--min-ops n]\n", argv[0]);
+		return 2;
+	}
+
+	printf("table,keys,size,load_factor,operation,ns_per_op,bytes_per_entry\n");
+	try
+	{
+		for (size_t d=0;d<settings.distributions.size();++d)
+		{
+			for (size_t s=0;s<settings.sizes.size();++s)
+			{
+				KeySet keys;
+				makeKeys(settings.distributions[d], settings.sizes[s], keys);
+
+				for (size_t c=0;c<sizeof(cConfigs)/sizeof(cConfigs[0]);++c)
+				{
+					if (!isSelected(settings, cConfigs[c].name))
+						continue;
+
+					for (size_t l=0;l<settings.loads.size();++l)
+					{
+						if (!cConfigs[c].run(cConfigs[c].name, settings, settings.distributions[d], keys, settings.loads[l]))
+							break;
+					}
+				}
+			}
+		}
+	}
+	catch (const char* error)
+	{
+		fprintf(stderr, "%s\n", error);
+		return 1;
+	}
+
+	return gFailed ? 1 : 0;
+}
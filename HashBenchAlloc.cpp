@@ -0,0 +1,58 @@
+/*=====================================================================
+	HashBenchAlloc.cpp - Allocation counting for HashBench
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Replaces the global operator new and delete, so that HashBench can
+	tell how much memory a table uses. In a file of its own, so that the
+	compiler doesn't inline them into the code it measures.
+
+=====================================================================*/
+#include <new>
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------
+// Allocation counting, for bytes_per_entry. Every allocation gets a
+// header with its size, the same size as malloc's alignment.
+//-----------------------------------------------------------------------
+static size_t gAllocated = 0;
+
+size_t getAllocatedBytes()
+{
+	return gAllocated;
+}
+
+enum { cAllocHeader = 16 };
+
+void* operator new(size_t size)
+{
+	char* block = static_cast<char*>(malloc(size + cAllocHeader));
+	if (block == 0)
+		throw std::bad_alloc();
+	*reinterpret_cast<size_t*>(block) = size;
+	gAllocated += size;
+	return block + cAllocHeader;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* pointer) throw()
+{
+	if (pointer == 0)
+		return;
+	char* block = static_cast<char*>(pointer) - cAllocHeader;
+	gAllocated -= *reinterpret_cast<size_t*>(block);
+	free(block);
+}
+
+void operator delete[](void* pointer) throw()
+{
+	operator delete(pointer);
+}
@@ -0,0 +1,134 @@
+/*=====================================================================
+	HashCache.h - Policies for keeping the hash values of stored keys
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the 
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		class NoHashCache
+
+		class HashCache
+
+  Requirements:
+		HashCache needs the full width () operator of the Hasher and the
+		getIndexFromHash() method of the Grower.
+
+  Dependencies:
+		No external dependencies
+
+=====================================================================*/
+#if !defined(HASHCACHE_H)
+#define HASHCACHE_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <stddef.h> // size_t
+
+//------------------------------------------------------------------------
+// NoHashCache
+// The default: Nothing is stored, the key is hashed again whenever its
+// slot is needed, eg when rehashing.
+class NoHashCache
+{
+public:
+	void allocate(size_t /*count*/) {}
+	void release() {}
+	void swap(NoHashCache& /*src*/) {}
+
+	// Memory per slot, for stats()
+	static size_t getBytesPerSlot() { return 0; }
+
+	// Slot for key in an array of size allocated, magic is the grower's
+	// getMagic(allocated). hashValue is what to store for key, see set().
+	template <class MyHasher, class MyGrower, class Key>
+	size_t getIndex(MyHasher& hasher, const MyGrower& grower, const Key& key, size_t allocated, size_t magic, size_t& hashValue) const
+	{
+		hashValue = 0;
+		return grower.getIndex(hasher, key, allocated, magic);
+	}
+
+	// Same as above, for a key already stored in slot.
+	template <class MyHasher, class MyGrower, class Key>
+	size_t getStoredIndex(MyHasher& hasher, const MyGrower& grower, const Key& key, size_t /*slot*/, size_t allocated, size_t magic, size_t& hashValue) const
+	{
+		return getIndex(hasher, grower, key, allocated, magic, hashValue);
+	}
+
+	// false if the key in slot can't be the one with hashValue
+	bool matches(size_t /*slot*/, size_t /*hashValue*/) const { return true; }
+
+	void set(size_t /*slot*/, size_t /*hashValue*/) {}
+};
+
+//------------------------------------------------------------------------
+// HashCache
+// Keeps the full width hash value of every stored key in an array parallel
+// to the slots. Rehashing then just redistributes the values, and lookups
+// skip keys with another hash value without comparing them.
+// Pays off for keys that are expensive to hash or compare, eg long strings.
+class HashCache
+{
+public:
+	HashCache():mHashes(0) {}
+	~HashCache() { release(); }
+
+	void allocate(size_t count)
+	{
+		release();
+		mHashes = new size_t[count];
+	}
+
+	void release()
+	{
+		delete [] mHashes;
+		mHashes = 0;
+	}
+
+	void swap(HashCache& src)
+	{
+		size_t* hashes = mHashes;
+		mHashes = src.mHashes;
+		src.mHashes = hashes;
+	}
+
+	static size_t getBytesPerSlot() { return sizeof(size_t); }
+
+	template <class MyHasher, class MyGrower, class Key>
+	size_t getIndex(MyHasher& hasher, const MyGrower& grower, const Key& key, size_t allocated, size_t magic, size_t& hashValue) const
+	{
+		hashValue = hasher(key);
+		return grower.getIndexFromHash(hashValue, allocated, magic);
+	}
+
+	// The stored key isn't hashed again
+	template <class MyHasher, class MyGrower, class Key>
+	size_t getStoredIndex(MyHasher& /*hasher*/, const MyGrower& grower, const Key& /*key*/, size_t slot, size_t allocated, size_t magic, size_t& hashValue) const
+	{
+		hashValue = mHashes[slot];
+		return grower.getIndexFromHash(hashValue, allocated, magic);
+	}
+
+	bool matches(size_t slot, size_t hashValue) const { return mHashes[slot] == hashValue; }
+
+	void set(size_t slot, size_t hashValue) { mHashes[slot] = hashValue; }
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	HashCache(const HashCache&);
+	HashCache& operator = (const HashCache&);
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	size_t* mHashes; // One hash value per slot, undefined for unused slots
+};
+
+#endif // HASHCACHE_H
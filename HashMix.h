@@ -0,0 +1,63 @@
+/*=====================================================================
+	HashMix.h - Bit mixing of hash values
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the 
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		template <int Bytes> struct HashMix
+
+  Requirements:
+		N/A
+
+  Dependencies:
+		No external dependencies
+
+=====================================================================*/
+#if !defined(HASHMIX_H)
+#define HASHMIX_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <stddef.h> // size_t
+
+//------------------------------------------------------------------------
+// HashMix
+// Scrambles a hash value so that all its bits affect the low ones, which
+// are the ones a mask keeps. Murmur3 finalizers for 32 and 64 bit size_t.
+template <int Bytes> struct HashMix;
+
+template <> struct HashMix<4>
+{
+	static size_t mix(size_t h)
+	{
+		h ^= h >> 16;
+		h *= 0x85ebca6bu;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35u;
+		h ^= h >> 16;
+		return h;
+	}
+};
+
+template <> struct HashMix<8>
+{
+	static size_t mix(size_t h)
+	{
+		unsigned long long x = h;
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdULL;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ULL;
+		x ^= x >> 33;
+		return static_cast<size_t>(x);
+	}
+};
+
+#endif // HASHMIX_H
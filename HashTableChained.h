@@ -1,556 +1,1682 @@
-/*=====================================================================
-	HashTableChained.h - Chained hash table template class
-
-	Author: Per Nilsson
-
-	Freeware and no copyright on my behalf. However, if you use the 
-	code in some manner	I'd appreciate a notification about it
-	perfnurt@hotmail.com
-
-	Classes:
-
-		// The hash table 
-		template <class Key, class Value, 
-		  class MyHasher = Hasher<Key>,
-		  class MyGrower = DefaultGrower,
-		  class Collection = std::map<Key, Value> 
-		  >
-		class HashTableChained
-		{
-			class iterator
-			class const_iterator
-
-			// Used as a proxy when operator[] is called
-			class Access
-		}
-
-  Requirements:
-		A Hasher must be implemented if the generic ones isn't applicable.
-		Caller needs to #inlude default Grower/Hasher if they are to be used.
-
-    Dependencies:
-		To std::map if the default Collection is used
-
-=====================================================================*/
-#if !defined(HASHTABLECHAINED_H)
-#define HASHTABLECHAINED_H
-
-#if _MSC_VER > 1000
-#pragma once
-#endif // _MSC_VER > 1000
-
-#include <map>
-#include <memory> // std::auto_ptr
-
-//------------------------------------------------------------------------
-// HashTableChained
-// A generic hash collection, requires that the Hasher
-// has been implemented somwehere for the apropriate Key type.
-// class Key
-//   The, well, key type
-// class Value: 
-//   The value type
-// class MyHasher:
-//   A class (function object) that will be called when computing the...well...hash value.
-//   Substitute with your own if the generic hashers aren't good enough/applicable
-// class MyGrower:
-//   A class used to determine what size the array should grow to
-// class Collection:
-//   The HashTableChained will actually be an array of Collection*, which is a 
-//   pointer to a std::map<Key, Value> by default. 
-//   You could let it be any other <Key, Value> collection type given that 
-//   it follows the same form as a std::map 
-//   (insert, find, erase, value_type, iterators etc) 
-template <class Key, class Value, 
-		  class MyHasher = Hasher<Key>,
-		  class MyGrower = DefaultGrower,
-		  class Collection = std::map<Key, Value> 
-		  >
-class HashTableChained  
-{
-public:
-	//------------------------------------------------------------------
-	// Public Type Definitions
-	//------------------------------------------------------------------
-	typedef Collection::value_type value_type;
-
-	//------------------------------------------------------------------
-	// Public Classes
-	//------------------------------------------------------------------
-	// class iterator
-	class iterator
-	{
-	public:
-
-		iterator(HashTableChained& ht, size_t index):mHT(ht), mIndex(index), mIterator(0)
-		{
-			inc();
-		}
-		iterator(HashTableChained& ht, size_t index, Collection::iterator it):mHT(ht), mIndex(index), mIterator(new Collection::iterator(it)) 
-		{
-		}
-
-		iterator& operator = (const iterator& src)
-		{
-			mIndex = src.index;
-			mIterator = src.mIterator;
-		}
-		bool operator == (const iterator& src) const
-		{
-			return mHT == src.mHT && mIndex == src.mIndex && mIterator.get() == src.mIterator.get();
-		}
-
-		bool operator != (const iterator& src) const
-		{
-			return !(*this == src);
-		}
-
-		value_type& operator*()
-		{
-			return **(mIterator.get());
-		}
-
-		size_t getIndex() const { return mIndex; }
-
-		iterator& operator ++ ()
-		{
-			// Have we reached the end()?
-			if (mIndex<mHT.getAllocated())
-			{				
-				// The hash table won't hold any empty collections,
-				Collection::iterator& iter = *(mIterator.get());
-				Collection& collection = *mHT.getCollection(mIndex);
-
-				// Have we reached the collection's end()?
-				if (iter!=collection.end())
-				{
-					// No. Just to to next element in the collection
-					++iter;
-
-					// But now we might have reached the collection's end()
-					if (iter==collection.end())
-					{
-						// Go find the next collection's begin() (if any)
-						mIndex++;
-						inc();
-					}
-				}
-
-			}
-			return (*this);
-		}
-
-	private:
-		// Go to next used slot, or to end()
-		void inc()
-		{
-			
-			mIterator = CollectionIterator(0);
-			while(mIndex<mHT.getAllocated() && mHT.getCollection(mIndex)==0)
-			{
-				mIndex++;
-			}
-			if(mIndex<mHT.getAllocated())
-			{
-				mIterator = CollectionIterator(new Collection::iterator(mHT.getCollection(mIndex)->begin()));
-			}
-
-		}
-
-		HashTableChained& mHT;
-		size_t mIndex;
-
-		// auto_ptr is a nifty way to have "optional" members, as you dont have to worry about delete.
-		// Just set it to 0 if it's not applicable. For this class it means that we might not have
-		// an iterator to the collection, as we might not be pointing to a valid Collection, ie
-		// iterator is at end().
-		typedef std::auto_ptr<Collection::iterator> CollectionIterator;
-		CollectionIterator mIterator;
-	};
-
-	// class const_iterator
-	class const_iterator
-	{
-	public:
-
-		const_iterator(const HashTableChained& ht, size_t index):mHT(ht), mIndex(index), mIterator(0)
-		{
-			inc();
-		}
-		const_iterator(const HashTableChained& ht, size_t index, Collection::const_iterator it):mHT(ht), mIndex(index), mIterator(new Collection::const_iterator(it)) 
-		{
-		}
-
-		const_iterator& operator = (const const_iterator& src)
-		{
-			mIndex = src.index;
-			mIterator = src.mIterator;
-		}
-		bool operator == (const const_iterator& src) const
-		{
-			return mHT == src.mHT && mIndex == src.mIndex && mIterator.get() == src.mIterator.get();
-		}
-
-		bool operator != (const const_iterator& src) const
-		{
-			return !(*this == src);
-		}
-
-		const value_type& operator*()
-		{
-			return **(mIterator.get());
-		}
-
-		size_t getIndex() const { return mIndex; }
-
-		const_iterator& operator ++ ()
-		{
-			if (mIndex<mHT.getAllocated())
-			{				
-				Collection::const_iterator& iter = *(mIterator.get());
-				const Collection& collection = *mHT.getCollection(mIndex);
-
-				if (iter!=collection.end())
-				{
-					++iter;
-					if (iter==collection.end())
-					{
-						mIndex++;
-						inc();
-					}
-				}
-			}
-			return (*this);
-		}
-	private:
-		void inc()
-		{
-			mIterator = CollectionIterator(0);
-			while(mIndex<mHT.getAllocated() && mHT.getCollection(mIndex)==0)
-			{
-				mIndex++;
-			}
-			if(mIndex<mHT.getAllocated())
-			{
-				mIterator = CollectionIterator(new Collection::const_iterator(mHT.getCollection(mIndex)->begin()));
-			}
-
-		}
-		typedef std::auto_ptr<Collection::const_iterator> CollectionIterator;
-		const HashTableChained& mHT;
-		size_t mIndex;
-		CollectionIterator mIterator;
-	};
-	
-	// Used as proxy when calling the [] operator.
-	// Handles theHash["foo"] = 42 and i = theHash["Foo"] differently.
-	class Access
-	{
-
-	public:
-		Access(HashTableChained& ht, const Key& key):mHash(ht),mKey(key){}
-
-		// Assignment operator. Handles the myHash["Foo"] = 32; situation
-		operator=(const Value& value)
-		{
-			// Just use the Set method, it handles already exist/not exist situation
-			mHash.set(mKey,value);
-		}
-
-		// ValueType operator
-		operator Value()
-		{
-			iterator it = mHash.find(mKey);
-
-			// Not found
-			if (it == mHash.end())
-			{
-				throw "Item not found";
-			}
-
-			return (*it).second;
-		}
-
-
-	private:
-		//------------------------------
-		// Disabled Methods
-		//------------------------------
-		// Default constructor
-		Access();
-
-		//------------------------------
-		// Private Members
-		//------------------------------
-		HashTableChained& mHash;
-		const Key& mKey;
-	}; // Access
-	
-	//------------------------------------------------------------------ 
-	// Public Construction
-	//------------------------------------------------------------------
-	// Default constructor
-	explicit HashTableChained(size_t initialSize=1000) // Might be adjusted upwards
-	{
-		
-		size_t newAlloc = mGrower.getPrimeGreaterThan(initialSize);
-
-		mAllocated = newAlloc;
-		mFreeSlots = mAllocated;
-		mArray = new Collection*[mAllocated+1];
-		memset(mArray, 0, sizeof(mArray[0])*(mAllocated+1));
-		mSize=0;
-	}
-
-	// Destructor
-	virtual ~HashTableChained()
-	{
-		clear();
-	}
-
-	//------------------------------------------------------------------
-	// Public Queries
-	//------------------------------------------------------------------
-	
-	// Find a const_iterator, returns end() if not found.
-	const_iterator find(const Key& key) const
-	{
-		size_t hashValue = hash(key, mAllocated);
-
-		const Collection* collection = mArray[hashValue];
-
-		if (collection != 0)
-		{
-			Collection::const_iterator it = collection->find(key);
-			if (it != collection->end())
-			{
-				return const_iterator(*this, hashValue, it);
-			}
-		}
-
-		return end();
-	}
-
-	// Find a iterator, returns end() if not found.
-	iterator find(const Key& key) 
-	{
-		size_t hashValue = hash(key, mAllocated);
-
-		Collection* collection = mArray[hashValue];
-
-		if (collection != 0)
-		{
-			Collection::iterator it = collection->find(key);
-			if (it != collection->end())
-			{
-				return iterator(*this, hashValue, it);
-			}
-		}
-
-		return end();
-	}
-
-	size_t size() const { return mSize; }
-	size_t  getAllocated() const { return mAllocated; }
-
-	//------------------------------------------------------------------
-	// Public Iterators
-	//------------------------------------------------------------------
-	iterator		begin() { return iterator(*this, 0); }
-	const_iterator	begin() const { return const_iterator(*this, 0); }
-	iterator		end() { return iterator(*this, mAllocated); }
-	const_iterator	end() const { return const_iterator(*this, mAllocated); }
-
-	//------------------------------------------------------------------
-	// Public Commands
-	//------------------------------------------------------------------
-
-	void set(const Key& key, const Value& value)
-	{
-		iterator it = find(key);
-		if (it == end())
-		{
-			if (!insert(key, value))
-				throw "Failed to insert";
-		}
-		else
-		{
-			(*it).second = value;
-		}
-			
-	}
-
-	// insert - returns false if no insertion took place, ie key already stored
-	bool  insert(const value_type& vt)
-	{
-		return insert(vt.first, vt.second);
-	}
-
-	// insert - returns false if no insertion took place, ie key already stored
-	bool insert(const Key& key, const Value& value)
-	{
-		if (find(key) != end())
-			return false;
-
-		size_t newAlloc = mGrower.getNewSize(mAllocated, mFreeSlots);
-		if (newAlloc > mAllocated)
-		{
-			rehash(newAlloc);
-		}
-
-		size_t hashValue = hash(key, mAllocated);
-
-		Collection* collection = mArray[hashValue];
-
-
-		if (!collection)
-		{
-			collection= new Collection;
-			mArray[hashValue] = collection;
-			mFreeSlots--;
-		}
-
-		collection->insert(Collection::value_type(key, value)); 
-		mSize++;
-		return true;
-	}
-
-	size_t erase(const Key& key)
-	{
-		size_t erased = 0;
-
-		size_t index = hash(key,mAllocated);
-		
-		Collection* collection = mArray[index];
-
-		if (collection!=0)
-		{
-			erased = collection->erase(key);
-			if (erased > 0)
-			{
-				if (collection->size() == 0)
-				{
-					delete collection;
-					mArray[index] = 0;
-					mFreeSlots++;
-				}
-				
-			}
-		}
-		mSize-=erased;
-		return erased;
-	}
-
-	void clear()
-	{
-		if (mArray != 0)
-		{
-			for (size_t i=0;i<mAllocated;++i)
-			{
-				delete mArray[i];
-				mArray[i] = 0;
-			}
-
-			delete [] mArray;
-			mArray = 0;
-		}
-		mAllocated=0;
-		mFreeSlots=0;
-		mSize=0;
-	}
-	//------------------------------------------------------------------
-	// Public Operators
-	//------------------------------------------------------------------
-	Access operator[](const Key& key)
-	{
-		return Access(*this, key);
-	}
-
-	bool operator == (const HashTableChained& src) const
-	{
-		return mArray == src.mArray;
-	}
-
-	Collection*	getCollection(size_t index) { return mArray[index]; }
-	const Collection*	getCollection(size_t index) const { return mArray[index]; }
-
-private:
-	//------------------------------------------------------------------
-	// Disabled Methods
-	//------------------------------------------------------------------
-    // Copy constructor
-	explicit HashTableChained(const HashTableChained&);
-
-	// Assignment operator
-	HashTableChained operator = (const HashTableChained&);
-
-	//------------------------------------------------------------------
-	// Private Type Definitions
-	//------------------------------------------------------------------
-	typedef Collection**	 Array; // == array of Collection pointer
-	//------------------------------------------------------------------
-	// Private Helper Methods
-	//------------------------------------------------------------------
-	size_t hash(const Key& key, size_t allocated) const
-	{
-		MyHasher hasher;
-		size_t size_t = hasher(key, allocated);
-		return size_t;
-	}
-
-	// Create a new, bigger, array
-	void rehash(size_t newAlloc)
-	{
-		size_t oldAllocated = mAllocated;
-		Array newArray = new Collection*[newAlloc+1];
-		memset(newArray, 0, sizeof(newArray[0])*(newAlloc+1));
-
-		size_t newFreeSlots = newAlloc;
-		size_t oldSize=size();
-
-		for (size_t i=0; i<oldAllocated; ++i)
-		{
-			const Collection* collection = mArray[i];
-			if(collection)
-			{
-				for(Collection::const_iterator iElem=collection->begin();iElem!=collection->end();++iElem)
-				{
-					size_t newsize_t = hash((*iElem).first, newAlloc);
-					Collection* newCollection = newArray[newsize_t];
-
-					// We need create new collectiosn since it's not likely the collections themselves
-					// will be identical to the ones the new array.
-					if (!newCollection)
-					{
-						newCollection = new Collection;
-						newArray[newsize_t] = newCollection;
-						newFreeSlots--;
-					}
-
-					newCollection->insert(Collection::value_type((*iElem).first, (*iElem).second));
-				}
-			}
-		}
-
-		// Delete all old stuff, even the collections and their elements as new
-		// ones have been created for the new array.
-		clear();
-		mArray = newArray;
-		mAllocated = newAlloc;
-		mFreeSlots = newFreeSlots;
-		mSize = oldSize;
-	}
-
-	//------------------------------------------------------------------
-	// Members
-	//------------------------------------------------------------------
-	// The hash table iteself
-	Array	mArray;
-	size_t	mAllocated; // The actual size of the array
-	size_t	mFreeSlots; // Number of free slots in the array
-	size_t	mSize;	// Number of collections stored in the hash table (incl. sub collections)
-
-	MyGrower mGrower;
-};
-
-#endif // !defined(HASHTABLECHAINED_H)
+/*=====================================================================
+	HashTableChained.h - Chained hash table template class
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the 
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		// The hash table 
+		template <class Key, class Value, 
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower,
+		  class Collection = InlineBucket<Key, Value>,
+		  class MyAllocator = NewAllocator
+		  >
+		class HashTableChained
+		{
+			class iterator
+			class const_iterator
+
+			// Used as a proxy when operator[] is called
+			class Access
+		}
+
+  Requirements:
+		A Hasher must be implemented if the generic ones isn't applicable,
+		it needs the full width () operator (see GenericHashers.h).
+		Caller needs to #inlude default Grower/Hasher if they are to be used.
+
+    Dependencies:
+		To InlineBucket.h if the default Collection is used
+		To std::vector for build()
+		PoolAllocator.h, Prefetch.h, WorkerPool.h, HashTableStats.h
+
+  Incremental rehash:
+		By default all elements are moved to the new array at once when it
+		grows. After setIncrementalRehash(n) the old array is kept instead,
+		and each insert, erase and (non-const) find moves the elements of
+		the next n old buckets. Lookups check both arrays until it's done.
+		The bucket index space (getAllocated(), getCollection()) then covers
+		the new array followed by the old one. Note that moving elements
+		invalidates iterators, also for a find().
+
+  Parallel rehash:
+		After setWorkerPool() a rehash of a big array is split over the
+		pool's threads, in three rounds. First each task goes through a
+		range of the old buckets and sorts what's there by the range of new
+		buckets it goes to, into lists of its own. Then each task fills its
+		range of new buckets from the lists all tasks made for it. Last the
+		old collections that weren't moved as a whole are deleted, again
+		a range per task. Not combined with incremental rehash, nor with
+		an allocator that isn't thread safe. build() fills the buckets on
+		the pool in the same way, a range of its partitions per task.
+
+  Allocators:
+		The collections of the buckets are allocated by MyAllocator, a
+		NewAllocator by default. With a PoolAllocator they come from big
+		slabs instead, erased ones are reused for the next buckets, and
+		clear() and the destructor give the slabs back all at once.
+
+  Parallel traversal:
+		for_each_in(first, last, visitor) visits the elements in a range
+		of the bucket index space (see getAllocated()), and disjoint ranges
+		may be visited by different threads at the same time, eg from a
+		std::for_each(std::execution::par, ...) over a list of ranges.
+		parallel_for_each(pool, visitor) does the splitting on a WorkerPool
+		and gives each task a copy of visitor, which are returned so that
+		their results can be combined. Nothing may change the table while
+		it's being visited.
+
+  Statistics:
+		stats() tells how many elements each bucket holds, how many are
+		empty, how often and for how long the table has rehashed, and
+		roughly how much memory it uses. With HASHTABLE_STATS defined it
+		also counts the buckets searched by find, insert and erase, and
+		the elements in them. See HashTableStats.h.
+
+=====================================================================*/
+#if !defined(HASHTABLECHAINED_H)
+#define HASHTABLECHAINED_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <map>
+#include <new> // placement new
+#include <string.h> // memset
+#include <vector>
+
+#include "HashTableStats.h"
+#include "InlineBucket.h"
+#include "PoolAllocator.h"
+#include "Prefetch.h"
+#include "WorkerPool.h"
+
+template <class Key, class Value, class MyHasher, class MyGrower, class MyHashCache>
+class HashTableProbed;
+
+//------------------------------------------------------------------------
+// HashTableChained
+// A generic hash collection, requires that the Hasher
+// has been implemented somwehere for the apropriate Key type.
+// class Key
+//   The, well, key type
+// class Value: 
+//   The value type
+// class MyHasher:
+//   A class (function object) that will be called when computing the...well...hash value.
+//   Substitute with your own if the generic hashers aren't good enough/applicable
+// class MyGrower:
+//   A class used to determine what size the array should grow to
+// class Collection:
+//   The HashTableChained will actually be an array of Collection*, which is a 
+//   pointer to an InlineBucket<Key, Value> by default. 
+//   You could let it be any other <Key, Value> collection type given that 
+//   it follows the same form as a std::map 
+//   (insert, find, erase, value_type, iterators etc), eg std::map itself 
+// class MyAllocator:
+//   Where the collections are allocated, see Allocators above
+template <class Key, class Value, 
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower,
+		  class Collection = InlineBucket<Key, Value>,
+		  class MyAllocator = NewAllocator
+		  >
+class HashTableChained  
+{
+public:
+	//------------------------------------------------------------------
+	// Public Type Definitions
+	//------------------------------------------------------------------
+	typedef typename Collection::value_type value_type;
+
+	//------------------------------------------------------------------
+	// Public Classes
+	//------------------------------------------------------------------
+	// class iterator
+	class iterator
+	{
+		typedef typename Collection::iterator CollectionIterator;
+
+	public:
+
+		iterator(HashTableChained& ht, size_t index):mHT(&ht), mIndex(index), mValid(false)
+		{
+			inc();
+		}
+		iterator(HashTableChained& ht, size_t index, const CollectionIterator& it):mHT(&ht), mIndex(index), mValid(false)
+		{
+			setIterator(it);
+		}
+		iterator(const iterator& src):mHT(src.mHT), mIndex(src.mIndex), mValid(false)
+		{
+			if (src.mValid)
+				setIterator(src.getIterator());
+		}
+		~iterator()
+		{
+			resetIterator();
+		}
+
+		iterator& operator = (const iterator& src)
+		{
+			if (this != &src)
+			{
+				mHT = src.mHT;
+				mIndex = src.mIndex;
+				resetIterator();
+				if (src.mValid)
+					setIterator(src.getIterator());
+			}
+			return (*this);
+		}
+		bool operator == (const iterator& src) const
+		{
+			return mHT == src.mHT && mIndex == src.mIndex && mValid == src.mValid && 
+				(!mValid || getIterator() == src.getIterator());
+		}
+
+		bool operator != (const iterator& src) const
+		{
+			return !(*this == src);
+		}
+
+		value_type& operator*()
+		{
+			return *getIterator();
+		}
+
+		size_t getIndex() const { return mIndex; }
+
+		iterator& operator ++ ()
+		{
+			// Have we reached the end()?
+			if (mIndex<mHT->getAllocated())
+			{				
+				// The hash table won't hold any empty collections,
+				CollectionIterator& iter = getIterator();
+				Collection& collection = *mHT->getCollection(mIndex);
+
+				// Have we reached the collection's end()?
+				if (iter!=collection.end())
+				{
+					// No. Just to to next element in the collection
+					++iter;
+
+					// But now we might have reached the collection's end()
+					if (iter==collection.end())
+					{
+						// Go find the next collection's begin() (if any)
+						mIndex++;
+						inc();
+					}
+				}
+
+			}
+			return (*this);
+		}
+
+	private:
+		// Go to next used slot, or to end()
+		void inc()
+		{
+			
+			resetIterator();
+			while(mIndex<mHT->getAllocated() && mHT->getCollection(mIndex)==0)
+			{
+				mIndex++;
+			}
+			if(mIndex<mHT->getAllocated())
+			{
+				setIterator(mHT->getCollection(mIndex)->begin());
+			}
+
+		}
+
+		// The collection's iterator is constructed in place, as it might
+		// lack a default constructor. It's only there when mValid is set,
+		// ie the iterator isn't at end().
+		CollectionIterator& getIterator() { return *reinterpret_cast<CollectionIterator*>(mStorage.mData); }
+		const CollectionIterator& getIterator() const { return *reinterpret_cast<const CollectionIterator*>(mStorage.mData); }
+
+		void setIterator(const CollectionIterator& it)
+		{
+			new (mStorage.mData) CollectionIterator(it);
+			mValid = true;
+		}
+
+		void resetIterator()
+		{
+			if (mValid)
+			{
+				getIterator().~CollectionIterator();
+				mValid = false;
+			}
+		}
+
+		HashTableChained* mHT;
+		size_t mIndex;
+		bool mValid;
+		union
+		{
+			char	mData[sizeof(CollectionIterator)];
+			double	mAlignDouble;
+			void*	mAlignPointer;
+		} mStorage;
+	};
+
+	// class const_iterator
+	class const_iterator
+	{
+		typedef typename Collection::const_iterator CollectionIterator;
+
+	public:
+
+		const_iterator(const HashTableChained& ht, size_t index):mHT(&ht), mIndex(index), mValid(false)
+		{
+			inc();
+		}
+		const_iterator(const HashTableChained& ht, size_t index, const CollectionIterator& it):mHT(&ht), mIndex(index), mValid(false)
+		{
+			setIterator(it);
+		}
+		const_iterator(const const_iterator& src):mHT(src.mHT), mIndex(src.mIndex), mValid(false)
+		{
+			if (src.mValid)
+				setIterator(src.getIterator());
+		}
+		~const_iterator()
+		{
+			resetIterator();
+		}
+
+		const_iterator& operator = (const const_iterator& src)
+		{
+			if (this != &src)
+			{
+				mHT = src.mHT;
+				mIndex = src.mIndex;
+				resetIterator();
+				if (src.mValid)
+					setIterator(src.getIterator());
+			}
+			return (*this);
+		}
+		bool operator == (const const_iterator& src) const
+		{
+			return mHT == src.mHT && mIndex == src.mIndex && mValid == src.mValid && 
+				(!mValid || getIterator() == src.getIterator());
+		}
+
+		bool operator != (const const_iterator& src) const
+		{
+			return !(*this == src);
+		}
+
+		const value_type& operator*()
+		{
+			return *getIterator();
+		}
+
+		size_t getIndex() const { return mIndex; }
+
+		const_iterator& operator ++ ()
+		{
+			if (mIndex<mHT->getAllocated())
+			{				
+				CollectionIterator& iter = getIterator();
+				const Collection& collection = *mHT->getCollection(mIndex);
+
+				if (iter!=collection.end())
+				{
+					++iter;
+					if (iter==collection.end())
+					{
+						mIndex++;
+						inc();
+					}
+				}
+			}
+			return (*this);
+		}
+	private:
+		void inc()
+		{
+			resetIterator();
+			while(mIndex<mHT->getAllocated() && mHT->getCollection(mIndex)==0)
+			{
+				mIndex++;
+			}
+			if(mIndex<mHT->getAllocated())
+			{
+				setIterator(mHT->getCollection(mIndex)->begin());
+			}
+
+		}
+
+		CollectionIterator& getIterator() { return *reinterpret_cast<CollectionIterator*>(mStorage.mData); }
+		const CollectionIterator& getIterator() const { return *reinterpret_cast<const CollectionIterator*>(mStorage.mData); }
+
+		void setIterator(const CollectionIterator& it)
+		{
+			new (mStorage.mData) CollectionIterator(it);
+			mValid = true;
+		}
+
+		void resetIterator()
+		{
+			if (mValid)
+			{
+				getIterator().~CollectionIterator();
+				mValid = false;
+			}
+		}
+
+		const HashTableChained* mHT;
+		size_t mIndex;
+		bool mValid;
+		union
+		{
+			char	mData[sizeof(CollectionIterator)];
+			double	mAlignDouble;
+			void*	mAlignPointer;
+		} mStorage;
+	};
+	
+	// Used as proxy when calling the [] operator.
+	// Handles theHash["foo"] = 42 and i = theHash["Foo"] differently.
+	class Access
+	{
+
+	public:
+		Access(HashTableChained& ht, const Key& key):mHash(ht),mKey(key){}
+
+		// Assignment operator. Handles the myHash["Foo"] = 32; situation
+		void operator=(const Value& value)
+		{
+			// Just use the Set method, it handles already exist/not exist situation
+			mHash.set(mKey,value);
+		}
+
+		// ValueType operator
+		operator Value()
+		{
+			iterator it = mHash.find(mKey);
+
+			// Not found
+			if (it == mHash.end())
+			{
+				throw "Item not found";
+			}
+
+			return (*it).second;
+		}
+
+
+	private:
+		//------------------------------
+		// Disabled Methods
+		//------------------------------
+		// Default constructor
+		Access();
+
+		//------------------------------
+		// Private Members
+		//------------------------------
+		HashTableChained& mHash;
+		const Key& mKey;
+	}; // Access
+	
+	//------------------------------------------------------------------ 
+	// Public Construction
+	//------------------------------------------------------------------
+	// Default constructor
+	explicit HashTableChained(size_t initialSize=1000) // Might be adjusted upwards
+		:mIncrementalStep(0), mWorkerPool(0), mParallelRehashMin(cParallelRehashMin), mRehashes(0), mRehashSeconds(0)
+	{
+		init(initialSize);
+	}
+
+	// Range constructor, the elements of [first, last) are inserted by 
+	// build(), see below.
+	template <class ForwardIterator>
+	HashTableChained(ForwardIterator first, ForwardIterator last)
+		:mIncrementalStep(0), mWorkerPool(0), mParallelRehashMin(cParallelRehashMin), mRehashes(0), mRehashSeconds(0)
+	{
+		init(0);
+		build(first, last);
+	}
+
+	// Destructor
+	virtual ~HashTableChained()
+	{
+		release();
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+	
+	// Find a const_iterator, returns end() if not found.
+	const_iterator find(const Key& key) const
+	{
+		size_t hashValue = hash(key, mAllocated, mMagic);
+
+		const Collection* collection = mArray[hashValue];
+		mCounters.countLookup(collection != 0 ? collection->size() : 0);
+
+		if (collection != 0)
+		{
+			typename Collection::const_iterator it = collection->find(key);
+			if (it != collection->end())
+			{
+				return const_iterator(*this, hashValue, it);
+			}
+		}
+
+		// During an incremental rehash it may still be in the old array
+		if (mOldArray != 0)
+		{
+			size_t oldHashValue = hash(key, mOldAllocated, mOldMagic);
+
+			collection = mOldArray[oldHashValue];
+			mCounters.countLookup(collection != 0 ? collection->size() : 0);
+
+			if (collection != 0)
+			{
+				typename Collection::const_iterator it = collection->find(key);
+				if (it != collection->end())
+				{
+					return const_iterator(*this, mAllocated + oldHashValue, it);
+				}
+			}
+		}
+
+		return end();
+	}
+
+	// Find a iterator, returns end() if not found.
+	iterator find(const Key& key) 
+	{
+		migrate(mIncrementalStep);
+
+		size_t hashValue = hash(key, mAllocated, mMagic);
+
+		Collection* collection = mArray[hashValue];
+		mCounters.countLookup(collection != 0 ? collection->size() : 0);
+
+		if (collection != 0)
+		{
+			typename Collection::iterator it = collection->find(key);
+			if (it != collection->end())
+			{
+				return iterator(*this, hashValue, it);
+			}
+		}
+
+		// During an incremental rehash it may still be in the old array
+		if (mOldArray != 0)
+		{
+			size_t oldHashValue = hash(key, mOldAllocated, mOldMagic);
+
+			collection = mOldArray[oldHashValue];
+			mCounters.countLookup(collection != 0 ? collection->size() : 0);
+
+			if (collection != 0)
+			{
+				typename Collection::iterator it = collection->find(key);
+				if (it != collection->end())
+				{
+					return iterator(*this, mAllocated + oldHashValue, it);
+				}
+			}
+		}
+
+		return end();
+	}
+
+	// Looks up n keys, results[i] is set to the element with keys[i], or 0 
+	// if not found. The keys are handled in batches, the bucket pointers 
+	// of all keys in a batch are prefetched, then the collections, before
+	// the first key is searched for, so that the cache misses overlap. 
+	void find_batch(const Key* keys, size_t n, const value_type** results) const
+	{
+		size_t hashValues[cBatchSize];
+		const Collection* collections[cBatchSize];
+
+		for (size_t first=0;first<n;first+=cBatchSize)
+		{
+			size_t count = n-first < cBatchSize ? n-first : size_t(cBatchSize);
+			size_t i;
+			for (i=0;i<count;++i)
+			{
+				hashValues[i] = hash(keys[first+i], mAllocated, mMagic);
+				HASH_PREFETCH(&mArray[hashValues[i]]);
+			}
+
+			for (i=0;i<count;++i)
+			{
+				collections[i] = mArray[hashValues[i]];
+				if (collections[i] != 0)
+					HASH_PREFETCH(collections[i]);
+			}
+
+			for (i=0;i<count;++i)
+			{
+				const Key& key = keys[first+i];
+				results[first+i] = 0;
+				mCounters.countLookup(collections[i] != 0 ? collections[i]->size() : 0);
+				if (collections[i] != 0)
+				{
+					typename Collection::const_iterator it = collections[i]->find(key);
+					if (it != collections[i]->end())
+						results[first+i] = &*it;
+				}
+
+				// During an incremental rehash it may still be in the old array
+				if (results[first+i] == 0 && mOldArray != 0)
+				{
+					const Collection* collection = mOldArray[hash(key, mOldAllocated, mOldMagic)];
+					mCounters.countLookup(collection != 0 ? collection->size() : 0);
+					if (collection != 0)
+					{
+						typename Collection::const_iterator it = collection->find(key);
+						if (it != collection->end())
+							results[first+i] = &*it;
+					}
+				}
+			}
+		}
+	}
+
+	void find_batch(const Key* keys, size_t n, value_type** results)
+	{
+		migrate(mIncrementalStep);
+		static_cast<const HashTableChained&>(*this).find_batch(keys, n, const_cast<const value_type**>(results));
+	}
+
+	size_t size() const { return mSize; }
+
+	// During an incremental rehash the indexes from the size of the new 
+	// array and up are the old array's.
+	size_t  getAllocated() const { return mAllocated + mOldAllocated; }
+
+	// True while an incremental rehash is in progress
+	bool isRehashing() const { return mOldArray != 0; }
+
+	// The size of every bucket, the empty ones, the rehashes and the
+	// memory used, see above. Goes through all buckets.
+	HashTableStats stats() const
+	{
+		HashTableStats stats;
+		stats.size = mSize;
+		stats.allocated = getAllocated();
+		stats.bytes = sizeof(*this) + sizeof(mArray[0])*(mAllocated+1);
+		addStats(mArray, mAllocated, stats);
+		if (mOldArray != 0)
+		{
+			stats.bytes += sizeof(mOldArray[0])*(mOldAllocated+1);
+			addStats(mOldArray, mOldAllocated, stats);
+		}
+		stats.empty = stats.histogram.empty() ? 0 : stats.histogram[0];
+		stats.rehashes = mRehashes;
+		stats.rehashSeconds = mRehashSeconds;
+		mCounters.get(stats);
+		return stats;
+	}
+
+	//------------------------------------------------------------------
+	// Public Iterators
+	//------------------------------------------------------------------
+	iterator		begin() { return iterator(*this, 0); }
+	const_iterator	begin() const { return const_iterator(*this, 0); }
+	iterator		end() { return iterator(*this, getAllocated()); }
+	const_iterator	end() const { return const_iterator(*this, getAllocated()); }
+
+	// Calls visitor(element) for the elements in the buckets [first, last),
+	// see Parallel traversal above. Returns visitor, like std::for_each.
+	template <class Visitor>
+	Visitor for_each_in(size_t first, size_t last, Visitor visitor)
+	{
+		for (size_t i=first;i<last;++i)
+		{
+			Collection* collection = getCollection(i);
+			if (collection == 0)
+				continue;
+
+			for (typename Collection::iterator iElem=collection->begin();iElem!=collection->end();++iElem)
+			{
+				visitor(*iElem);
+			}
+		}
+		return visitor;
+	}
+
+	template <class Visitor>
+	Visitor for_each_in(size_t first, size_t last, Visitor visitor) const
+	{
+		for (size_t i=first;i<last;++i)
+		{
+			const Collection* collection = getCollection(i);
+			if (collection == 0)
+				continue;
+
+			for (typename Collection::const_iterator iElem=collection->begin();iElem!=collection->end();++iElem)
+			{
+				visitor(*iElem);
+			}
+		}
+		return visitor;
+	}
+
+	// Visits all elements on pool, a range of buckets per task, with a
+	// copy of visitor each. Returns the copies.
+	template <class Visitor>
+	std::vector<Visitor> parallel_for_each(WorkerPool& pool, const Visitor& visitor)
+	{
+		std::vector<Visitor> visitors(pool.getThreadCount()*cTasksPerThread, visitor);
+		parallelFor(pool, visitors.size(), ForEachTask<HashTableChained, Visitor>(*this, visitors));
+		return visitors;
+	}
+
+	template <class Visitor>
+	std::vector<Visitor> parallel_for_each(WorkerPool& pool, const Visitor& visitor) const
+	{
+		std::vector<Visitor> visitors(pool.getThreadCount()*cTasksPerThread, visitor);
+		parallelFor(pool, visitors.size(), ForEachTask<const HashTableChained, Visitor>(*this, visitors));
+		return visitors;
+	}
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+
+	void set(const Key& key, const Value& value)
+	{
+		if (insert_or_assign(key, value).first == end())
+			throw "Failed to insert";
+	}
+
+	// insert - returns false if no insertion took place, ie key already stored
+	bool  insert(const value_type& vt)
+	{
+		return insert(vt.first, vt.second);
+	}
+
+	// insert - returns false if no insertion took place, ie key already stored
+	bool insert(const Key& key, const Value& value)
+	{
+		return try_emplace(key, value).second;
+	}
+
+	// The element with key, and true if it was inserted by this call.
+	// Inserts an element constructed from key and arg, if not already 
+	// stored. Hashes once and searches the bucket once, unless the array
+	// has to grow (a std::map like collection searches again to insert).
+	// Returns (end(), false) if the collection refused it.
+	template <class Arg>
+	std::pair<iterator, bool> try_emplace(const Key& key, const Arg& arg)
+	{
+		migrate(mIncrementalStep);
+
+		size_t hashValue = hash(key, mAllocated, mMagic);
+
+		Collection* collection = mArray[hashValue];
+		mCounters.countLookup(collection != 0 ? collection->size() : 0);
+
+		if (collection != 0)
+		{
+			typename Collection::iterator it = collection->find(key);
+			if (it != collection->end())
+			{
+				return std::pair<iterator, bool>(iterator(*this, hashValue, it), false);
+			}
+		}
+
+		// During an incremental rehash it may still be in the old array
+		if (mOldArray != 0)
+		{
+			size_t oldHashValue = hash(key, mOldAllocated, mOldMagic);
+
+			Collection* oldCollection = mOldArray[oldHashValue];
+			mCounters.countLookup(oldCollection != 0 ? oldCollection->size() : 0);
+
+			if (oldCollection != 0)
+			{
+				typename Collection::iterator it = oldCollection->find(key);
+				if (it != oldCollection->end())
+				{
+					return std::pair<iterator, bool>(iterator(*this, mAllocated + oldHashValue, it), false);
+				}
+			}
+		}
+
+		// The elements still in the old array may need slots as well
+		size_t freeSlots = mFreeSlots > mOldSize ? mFreeSlots - mOldSize : 0;
+		size_t newAlloc = mGrower.getNewSize(mAllocated, freeSlots);
+		if (newAlloc > mAllocated)
+		{
+			// Can't start a new rehash before the current one is done
+			finishMigration();
+			rehashTo(newAlloc);
+
+			hashValue = hash(key, mAllocated, mMagic);
+			collection = mArray[hashValue];
+		}
+
+		bool created = false;
+		if (!collection)
+		{
+			collection = createCollection();
+			mArray[hashValue] = collection;
+			mFreeSlots--;
+			created = true;
+		}
+
+		iterator it = insertNew(*collection, hashValue, key, arg, Bool<sizeof(hasTryEmplace(collection)) == sizeof(char)>());
+		if (it == end())
+		{
+			if (created)
+			{
+				destroyCollection(collection);
+				mArray[hashValue] = 0;
+				mFreeSlots++;
+			}
+			return std::pair<iterator, bool>(it, false);
+		}
+		mSize++;
+		return std::pair<iterator, bool>(it, true);
+	}
+
+	std::pair<iterator, bool> try_emplace(const Key& key)
+	{
+		return try_emplace(key, Value());
+	}
+
+	// Same as try_emplace()
+	template <class Arg>
+	std::pair<iterator, bool> emplace(const Key& key, const Arg& arg)
+	{
+		return try_emplace(key, arg);
+	}
+
+	// As try_emplace(), but assigns arg to the value if key is already stored
+	template <class Arg>
+	std::pair<iterator, bool> insert_or_assign(const Key& key, const Arg& arg)
+	{
+		std::pair<iterator, bool> result = try_emplace(key, arg);
+		if (!result.second && result.first != end())
+			(*result.first).second = arg;
+		return result;
+	}
+
+	// Inserts the elements of [first, last), skipping keys already stored,
+	// just like calling insert() for each of them. But the array is grown
+	// once up front to fit them all, every key is hashed once, and they
+	// are inserted partitioned by bucket so the writes sweep the array 
+	// rather than hitting it at random. The partitions are filled on the
+	// worker pool, if the table has one, see Parallel rehash above.
+	template <class ForwardIterator>
+	void build(ForwardIterator first, ForwardIterator last)
+	{
+		typedef BuildEntry<ForwardIterator> Entry;
+
+		size_t count = 0;
+		ForwardIterator it;
+		for (it=first;it!=last;++it)
+		{
+			count++;
+		}
+		if (count == 0)
+			return;
+
+		growFor(mSize + count);
+
+		// Radix partition on the bucket index: count, offsets, scatter
+		size_t partitionSlots = mAllocated / cBuildPartitions + 1;
+		std::vector<size_t> offsets(cBuildPartitions + 1, 0);
+		std::vector<Entry> hashed(count);
+		size_t i = 0;
+		for (it=first;it!=last;++it,++i)
+		{
+			hashed[i].hashValue = hash((*it).first, mAllocated, mMagic);
+			hashed[i].it = it;
+			offsets[hashed[i].hashValue / partitionSlots + 1]++;
+		}
+		size_t partition;
+		for (partition=0;partition<cBuildPartitions;++partition)
+		{
+			offsets[partition+1] += offsets[partition];
+		}
+		std::vector<Entry> partitioned(count);
+		for (i=0;i<count;++i)
+		{
+			partitioned[offsets[hashed[i].hashValue / partitionSlots]++] = hashed[i];
+		}
+
+		// The partitions cover disjoint ranges of buckets, so they can be
+		// filled at the same time. offsets[p] is now where partition p+1
+		// starts.
+		if (mWorkerPool != 0 && mAllocated >= mParallelRehashMin && MyAllocator::cThreadSafe)
+		{
+			size_t tasks = mWorkerPool->getThreadCount()*cTasksPerThread;
+			std::vector<size_t> inserted(tasks, 0);
+			std::vector<size_t> used(tasks, 0);
+			parallelFor(*mWorkerPool, tasks, BuildTask<Entry>(*this, partitioned, offsets, inserted, used));
+			for (i=0;i<tasks;++i)
+			{
+				mSize += inserted[i];
+				mFreeSlots -= used[i];
+			}
+		}
+		else
+		{
+			size_t inserted = 0, used = 0;
+			fillBuilt(&partitioned[0], count, inserted, used);
+			mSize += inserted;
+			mFreeSlots -= used;
+		}
+	}
+
+	size_t erase(const Key& key)
+	{
+		migrate(mIncrementalStep);
+
+		size_t erased = 0;
+
+		size_t index = hash(key, mAllocated, mMagic);
+		
+		Collection* collection = mArray[index];
+		mCounters.countLookup(collection != 0 ? collection->size() : 0);
+
+		if (collection!=0)
+		{
+			erased = collection->erase(key);
+			if (erased > 0)
+			{
+				if (collection->size() == 0)
+				{
+					destroyCollection(collection);
+					mArray[index] = 0;
+					mFreeSlots++;
+				}
+				
+			}
+		}
+
+		// During an incremental rehash it may still be in the old array
+		if (erased == 0 && mOldArray != 0)
+		{
+			index = hash(key, mOldAllocated, mOldMagic);
+			collection = mOldArray[index];
+			mCounters.countLookup(collection != 0 ? collection->size() : 0);
+
+			if (collection!=0)
+			{
+				erased = collection->erase(key);
+				if (collection->size() == 0)
+				{
+					destroyCollection(collection);
+					mOldArray[index] = 0;
+				}
+				mOldSize-=erased;
+			}
+		}
+		mSize-=erased;
+		return erased;
+	}
+
+	// Removes all elements, leaving the smallest array the grower hands
+	// out. The settings (load factor, incremental rehash, worker pool) 
+	// are kept.
+	void clear()
+	{
+		release();
+		init(0);
+	}
+
+	// Grows the array so that n elements fit without it growing again
+	void reserve(size_t n)
+	{
+		growFor(n);
+	}
+
+	// Sets the number of buckets to the grower's smallest size of at 
+	// least n, or the size the elements need if that's bigger. Unlike
+	// reserve() it may shrink the array.
+	void rehash(size_t n)
+	{
+		finishMigration();
+
+		size_t newAlloc = getSizeFor(mSize, mGrower.getPrimeGreaterThan(n > 0 ? n-1 : 0));
+		if (newAlloc != mAllocated)
+		{
+			rehashTo(newAlloc);
+			finishMigration();
+		}
+	}
+
+	// Shrinks the array to the size the elements need, eg after erasing
+	// most of them
+	void shrink_to_fit()
+	{
+		rehash(0);
+	}
+
+	// The largest fraction of the buckets that may be in use before the 
+	// array grows, 0 < factor < 1. Note that it's not the number of 
+	// elements per bucket. Set by the grower, 0.9 by default.
+	float max_load_factor() const { return mGrower.getMaxLoadFactor(); }
+	void max_load_factor(float factor)
+	{
+		mGrower.setMaxLoadFactor(factor);
+		growFor(mSize);
+	}
+
+	// Rehash incrementally, see above. bucketsPerOperation is the number 
+	// of old buckets handled per insert/erase/find, 0 (default) moves all
+	// elements at once.
+	void setIncrementalRehash(size_t bucketsPerOperation)
+	{
+		mIncrementalStep = bucketsPerOperation;
+		if (mIncrementalStep == 0)
+			finishMigration();
+	}
+
+	// Rehash arrays of at least minAllocated buckets on pool, see above.
+	// 0 (default) rehashes on the calling thread only. The pool must
+	// outlive the table, or the next setWorkerPool() call.
+	void setWorkerPool(WorkerPool* pool, size_t minAllocated=cParallelRehashMin)
+	{
+		mWorkerPool = pool;
+		mParallelRehashMin = minAllocated;
+	}
+
+	// Starts counting rehashes, and the hot path counters, from 0 again
+	void resetStats()
+	{
+		mRehashes = 0;
+		mRehashSeconds = 0;
+		mCounters.reset();
+	}
+	//------------------------------------------------------------------
+	// Public Operators
+	//------------------------------------------------------------------
+	Access operator[](const Key& key)
+	{
+		return Access(*this, key);
+	}
+
+	bool operator == (const HashTableChained& src) const
+	{
+		return mArray == src.mArray;
+	}
+
+	Collection*	getCollection(size_t index) { return index < mAllocated ? mArray[index] : mOldArray[index - mAllocated]; }
+	const Collection*	getCollection(size_t index) const { return index < mAllocated ? mArray[index] : mOldArray[index - mAllocated]; }
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+    // Copy constructor
+	explicit HashTableChained(const HashTableChained&);
+
+	// Assignment operator
+	HashTableChained operator = (const HashTableChained&);
+
+	//------------------------------------------------------------------
+	// Private Type Definitions
+	//------------------------------------------------------------------
+	typedef Collection**	 Array; // == array of Collection pointer
+
+	// An element of the range given to build(), and where it goes
+	template <class ForwardIterator>
+	struct BuildEntry
+	{
+		size_t hashValue;
+		ForwardIterator it;
+	};
+
+	// A task of a parallel build(), task i fills the i:th range of the
+	// partitions
+	template <class Entry>
+	class BuildTask
+	{
+	public:
+		BuildTask(HashTableChained& ht, const std::vector<Entry>& entries, const std::vector<size_t>& ends, std::vector<size_t>& inserted, std::vector<size_t>& used)
+			:mHT(ht), mEntries(entries), mEnds(ends), mInserted(inserted), mUsed(used) {}
+
+		void operator()(size_t task) const
+		{
+			size_t partitionsPerTask = cBuildPartitions / mInserted.size() + 1;
+			size_t first = task*partitionsPerTask < size_t(cBuildPartitions) ? task*partitionsPerTask : size_t(cBuildPartitions);
+			size_t last = first + partitionsPerTask < size_t(cBuildPartitions) ? first + partitionsPerTask : size_t(cBuildPartitions);
+
+			// mEnds[p] is where partition p ends
+			size_t begin = first > 0 ? mEnds[first-1] : 0;
+			size_t end = last > 0 ? mEnds[last-1] : 0;
+			if (begin < end)
+				mHT.fillBuilt(&mEntries[begin], end - begin, mInserted[task], mUsed[task]);
+		}
+
+	private:
+		HashTableChained& mHT;
+		const std::vector<Entry>& mEntries;
+		const std::vector<size_t>& mEnds;
+		std::vector<size_t>& mInserted;
+		std::vector<size_t>& mUsed;
+	};
+
+	// Something for a new bucket in a parallel rehash, an element of the
+	// old bucket or, if element is 0, its whole collection
+	struct MoveEntry
+	{
+		MoveEntry(size_t i, size_t oldI, const value_type* e):index(i), oldIndex(oldI), element(e) {}
+
+		size_t index;
+		size_t oldIndex;
+		const value_type* element;
+	};
+
+	// Gives InlineBucket::moveAll() the new bucket of each element, see
+	// moveElements()
+	class MoveTarget
+	{
+	public:
+		MoveTarget(HashTableChained& ht, const size_t* indexes):mHT(ht), mIndexes(indexes), mElement(0) {}
+
+		Collection* operator()(const Key& key)
+		{
+			size_t index = mElement < cMoveIndexes ? mIndexes[mElement] : mHT.hash(key, mHT.mAllocated, mHT.mMagic);
+			mElement++;
+			return mHT.getNewCollection(index);
+		}
+
+	private:
+		HashTableChained& mHT;
+		const size_t* mIndexes;
+		size_t mElement;
+	};
+
+	// A task of parallelMigrate(), task i works on the i:th range of the
+	// old or the new buckets depending on the round
+	class MigrateTask
+	{
+	public:
+		enum Round { cSort, cFill, cDelete };
+
+		MigrateTask(HashTableChained& ht, Round round, size_t tasks, std::vector<std::vector<MoveEntry> >& lists, std::vector<size_t>& used)
+			:mHT(ht), mRound(round), mTasks(tasks), mLists(lists), mUsed(used) {}
+
+		void operator()(size_t task) const
+		{
+			size_t oldPerTask = mHT.mOldAllocated / mTasks + 1;
+			size_t first = task*oldPerTask < mHT.mOldAllocated ? task*oldPerTask : mHT.mOldAllocated;
+			size_t last = first + oldPerTask < mHT.mOldAllocated ? first + oldPerTask : mHT.mOldAllocated;
+
+			switch (mRound)
+			{
+			case cSort:
+				mHT.sortRange(first, last, mHT.mAllocated / mTasks + 1, &mLists[task*mTasks]);
+				break;
+			case cFill:
+				for (size_t from=0;from<mTasks;++from)
+				{
+					mUsed[task] += mHT.fillFrom(mLists[from*mTasks + task]);
+				}
+				break;
+			case cDelete:
+				mHT.deleteRange(first, last);
+				break;
+			}
+		}
+
+	private:
+		HashTableChained& mHT;
+		Round mRound;
+		size_t mTasks;
+		std::vector<std::vector<MoveEntry> >& mLists;
+		std::vector<size_t>& mUsed;
+	};
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	// Shared by the constructors
+	void init(size_t initialSize)
+	{
+		size_t newAlloc = mGrower.getPrimeGreaterThan(initialSize);
+
+		mAllocated = newAlloc;
+		mMagic = mGrower.getMagic(mAllocated);
+		mFreeSlots = mAllocated;
+		mArray = new Collection*[mAllocated+1];
+		memset(mArray, 0, sizeof(mArray[0])*(mAllocated+1));
+		mSize=0;
+
+		mOldArray = 0;
+		mOldAllocated = 0;
+		mOldMagic = 0;
+		mOldSize = 0;
+		mMigrated = 0;
+	}
+
+	// The grower knows how to map a key to a slot for the array sizes it 
+	// hands out, magic is what it worked out for allocated in advance
+	size_t hash(const Key& key, size_t allocated, size_t magic) const
+	{
+		MyHasher hasher;
+		return mGrower.getIndex(hasher, key, allocated, magic);
+	}
+
+	// Tells if the collection's insert() took place, std::map like 
+	// collections return a pair, the hash tables a bool.
+	template <class CollectionIterator>
+	static bool isInserted(const std::pair<CollectionIterator, bool>& result)
+	{
+		return result.second;
+	}
+
+	static bool isInserted(bool result)
+	{
+		return result;
+	}
+
+	// Inserts count partitioned elements for build(), adds how many were
+	// inserted and the buckets taken in use. Only touches the buckets the
+	// elements go to, mSize and mFreeSlots are left to the caller.
+	template <class Entry>
+	void fillBuilt(const Entry* entries, size_t count, size_t& inserted, size_t& used)
+	{
+		for (size_t i=0;i<count;++i)
+		{
+			const Entry& entry = entries[i];
+			Collection* collection = mArray[entry.hashValue];
+			bool created = false;
+			if (!collection)
+			{
+				collection = createCollection();
+				mArray[entry.hashValue] = collection;
+				used++;
+				created = true;
+			}
+
+			if (isInserted(collection->insert(typename Collection::value_type((*entry.it).first, (*entry.it).second))))
+			{
+				inserted++;
+			}
+			else if (created)
+			{
+				destroyCollection(collection);
+				mArray[entry.hashValue] = 0;
+				used--;
+			}
+		}
+	}
+
+	// Grow the array, at once, so that total elements fit without the 
+	// grower asking for more.
+	void growFor(size_t total)
+	{
+		finishMigration();
+
+		size_t newAlloc = getSizeFor(total, mAllocated);
+		if (newAlloc > mAllocated)
+		{
+			rehashTo(newAlloc);
+			finishMigration();
+		}
+	}
+
+	// The array size, from size and up, the grower settles on for total 
+	// elements. The grower counts free buckets, to be sure that there's 
+	// no rehash every element is assumed to get a bucket of its own.
+	size_t getSizeFor(size_t total, size_t size) const
+	{
+		for (;;)
+		{
+			size_t freeSlots = size > total ? size - total : 0;
+			size_t biggerSize = mGrower.getNewSize(size, freeSlots);
+			if (biggerSize <= size)
+				return size;
+			size = biggerSize;
+		}
+	}
+
+	// insertNew() overloads, picked by hasTryEmplace() as Bool<true> or
+	// Bool<false>
+	template <bool B> struct Bool {};
+
+	// Tells the nested hash tables, which have try_emplace(), from other
+	// collections. Derived classes match as well.
+	template <class K, class V, class H, class G, class C>
+	static char hasTryEmplace(const HashTableProbed<K, V, H, G, C>*);
+	template <class K, class V, class H, class G, class C, class A>
+	static char hasTryEmplace(const HashTableChained<K, V, H, G, C, A>*);
+	static long hasTryEmplace(...);
+
+	// Inserts an element constructed from key and arg into the collection
+	// at index, where find() just came back empty. Returns end() if the
+	// collection refused it. An InlineBucket doesn't search again, and a
+	// nested table only inside its own try_emplace().
+	template <class K, class V, size_t N, class Arg>
+	iterator insertNew(InlineBucket<K, V, N>& collection, size_t index, const Key& key, const Arg& arg, Bool<false>)
+	{
+		return iterator(*this, index, collection.insertNew(key, arg));
+	}
+
+	template <class OtherCollection, class Arg>
+	iterator insertNew(OtherCollection& collection, size_t index, const Key& key, const Arg& arg, Bool<true>)
+	{
+		std::pair<typename OtherCollection::iterator, bool> result = collection.try_emplace(key, arg);
+		return result.second ? iterator(*this, index, result.first) : end();
+	}
+
+	template <class OtherCollection, class Arg>
+	iterator insertNew(OtherCollection& collection, size_t index, const Key& key, const Arg& arg, Bool<false>)
+	{
+		return getInserted(index, collection.insert(typename Collection::value_type(key, arg)), key);
+	}
+
+	// The iterator to a just inserted element in the collection at index,
+	// or end() if it wasn't inserted. std::map like collections return it
+	// from insert(), other hash tables only tell if it succeeded.
+	template <class CollectionIterator>
+	iterator getInserted(size_t index, const std::pair<CollectionIterator, bool>& result, const Key& /*key*/)
+	{
+		return result.second ? iterator(*this, index, result.first) : end();
+	}
+
+	iterator getInserted(size_t index, bool result, const Key& key)
+	{
+		return result ? iterator(*this, index, mArray[index]->find(key)) : end();
+	}
+
+	// Create a new, bigger, array. The current array becomes the old one,
+	// its elements are moved right away unless rehashing incrementally. 
+	void rehashTo(size_t newAlloc)
+	{
+		StatsTimer timer;
+		mRehashes++;
+
+		mOldArray = mArray;
+		mOldAllocated = mAllocated;
+		mOldMagic = mMagic;
+		mOldSize = mSize;
+		mMigrated = 0;
+
+		mArray = new Collection*[newAlloc+1];
+		memset(mArray, 0, sizeof(mArray[0])*(newAlloc+1));
+		mAllocated = newAlloc;
+		mMagic = mGrower.getMagic(newAlloc);
+		mFreeSlots = newAlloc;
+
+		if (mIncrementalStep == 0)
+		{
+			if (mWorkerPool != 0 && mOldAllocated >= mParallelRehashMin && MyAllocator::cThreadSafe)
+				parallelMigrate();
+			else
+				migrate(mOldAllocated);
+		}
+		timer.addTo(mRehashSeconds);
+	}
+
+	// Move the elements of the next steps buckets of the old array, if any.
+	// A collection whose elements all end up in the same, still empty,
+	// bucket is moved as is. Otherwise its elements are moved one by one,
+	// see moveElements(), and it's deleted right away, so there's never 
+	// more than one bucket duplicated.
+	void migrate(size_t steps)
+	{
+		if (mOldArray == 0)
+			return;
+
+		size_t last = mOldAllocated - mMigrated > steps ? mMigrated + steps : mOldAllocated;
+
+		for (; mMigrated < last && mOldSize > 0; ++mMigrated)
+		{
+			Collection* collection = mOldArray[mMigrated];
+			if(collection)
+			{
+				mOldSize -= collection->size();
+				mOldArray[mMigrated] = 0;
+
+				size_t indexes[cMoveIndexes];
+				size_t index = getMoveIndex(*collection, indexes);
+				if (index < mAllocated)
+				{
+					mArray[index] = collection;
+					mFreeSlots--;
+					continue;
+				}
+
+				moveElements(*collection, indexes);
+				destroyCollection(collection);
+			}
+		}
+
+		if (mOldSize == 0)
+			releaseOld();
+	}
+
+	// The new bucket to move the whole collection to, or mAllocated if its
+	// elements are spread out or the bucket is already in use. The new
+	// buckets of the first cMoveIndexes elements are kept in indexes, so
+	// that moveElements() needn't hash them again.
+	size_t getMoveIndex(const Collection& collection, size_t* indexes) const
+	{
+		size_t index = mAllocated;
+		bool spread = false;
+		size_t element = 0;
+		for(typename Collection::const_iterator iElem=collection.begin();iElem!=collection.end() && !(spread && element >= cMoveIndexes);++iElem,++element)
+		{
+			size_t elementIndex = hash((*iElem).first, mAllocated, mMagic);
+			if (element < cMoveIndexes)
+				indexes[element] = elementIndex;
+			if (element == 0)
+				index = elementIndex;
+			else if (elementIndex != index)
+				spread = true;
+		}
+		return spread || mArray[index] != 0 ? mAllocated : index;
+	}
+
+	// Moves the elements of a collection that's split up to their new
+	// buckets, indexes is from getMoveIndex(). An InlineBucket relinks its
+	// nodes, so only the inline elements are copied, other collections
+	// copy every element.
+	template <class K, class V, size_t N>
+	void moveElements(InlineBucket<K, V, N>& collection, const size_t* indexes)
+	{
+		MoveTarget target(*this, indexes);
+		collection.moveAll(target);
+	}
+
+	template <class OtherCollection>
+	void moveElements(OtherCollection& collection, const size_t* indexes)
+	{
+		const OtherCollection& constCollection = collection;
+		size_t element = 0;
+		for(typename OtherCollection::const_iterator iElem=constCollection.begin();iElem!=constCollection.end();++iElem,++element)
+		{
+			size_t index = element < cMoveIndexes ? indexes[element] : hash((*iElem).first, mAllocated, mMagic);
+			getNewCollection(index)->insert(typename Collection::value_type((*iElem).first, (*iElem).second));
+		}
+	}
+
+	// The collection of a bucket in the new array, created if it's empty
+	Collection* getNewCollection(size_t index)
+	{
+		Collection* collection = mArray[index];
+		if (!collection)
+		{
+			collection = createCollection();
+			mArray[index] = collection;
+			mFreeSlots--;
+		}
+		return collection;
+	}
+
+	// Moves what's left of the old array, timed as part of the rehash
+	void finishMigration()
+	{
+		if (mOldArray == 0)
+			return;
+
+		StatsTimer timer;
+		migrate(mOldAllocated);
+		timer.addTo(mRehashSeconds);
+	}
+
+	// Moves all of the old array on mWorkerPool, see above. The lists are
+	// indexed by the task making them times tasks plus the task they're for.
+	void parallelMigrate()
+	{
+		size_t tasks = mWorkerPool->getThreadCount()*cTasksPerThread;
+		std::vector<std::vector<MoveEntry> > lists(tasks*tasks);
+		std::vector<size_t> used(tasks, 0);
+
+		parallelFor(*mWorkerPool, tasks, MigrateTask(*this, MigrateTask::cSort, tasks, lists, used));
+		parallelFor(*mWorkerPool, tasks, MigrateTask(*this, MigrateTask::cFill, tasks, lists, used));
+		parallelFor(*mWorkerPool, tasks, MigrateTask(*this, MigrateTask::cDelete, tasks, lists, used));
+
+		for (size_t i=0;i<tasks;++i)
+		{
+			mFreeSlots -= used[i];
+		}
+		mOldSize = 0;
+		mMigrated = mOldAllocated;
+		releaseOld();
+	}
+
+	// First round: What the old buckets [first, last) hold goes to the
+	// lists for the tasks filling the new buckets, a whole collection if
+	// all its elements go to the same bucket.
+	void sortRange(size_t first, size_t last, size_t bucketsPerTask, std::vector<MoveEntry>* lists)
+	{
+		std::vector<size_t> indexes;
+		for (size_t i=first;i<last;++i)
+		{
+			const Collection* collection = mOldArray[i];
+			if (collection == 0)
+				continue;
+
+			indexes.clear();
+			bool spread = false;
+			for(typename Collection::const_iterator iElem=collection->begin();iElem!=collection->end();++iElem)
+			{
+				indexes.push_back(hash((*iElem).first, mAllocated, mMagic));
+				spread = spread || indexes.back() != indexes.front();
+			}
+
+			if (!spread)
+			{
+				lists[indexes.front() / bucketsPerTask].push_back(MoveEntry(indexes.front(), i, 0));
+				continue;
+			}
+
+			size_t element = 0;
+			for(typename Collection::const_iterator iElem=collection->begin();iElem!=collection->end();++iElem,++element)
+			{
+				lists[indexes[element] / bucketsPerTask].push_back(MoveEntry(indexes[element], i, &*iElem));
+			}
+		}
+	}
+
+	// Second round: Fills new buckets from a list. The old collection of
+	// a whole collection entry is moved, and taken out of the old array,
+	// if its new bucket is still empty. Returns the buckets taken in use.
+	size_t fillFrom(const std::vector<MoveEntry>& list)
+	{
+		size_t used = 0;
+		for (size_t i=0;i<list.size();++i)
+		{
+			const MoveEntry& entry = list[i];
+			Collection*& newCollection = mArray[entry.index];
+			if (entry.element == 0 && newCollection == 0)
+			{
+				newCollection = mOldArray[entry.oldIndex];
+				mOldArray[entry.oldIndex] = 0;
+				used++;
+				continue;
+			}
+
+			if (newCollection == 0)
+			{
+				newCollection = createCollection();
+				used++;
+			}
+
+			if (entry.element != 0)
+			{
+				newCollection->insert(typename Collection::value_type(entry.element->first, entry.element->second));
+			}
+			else
+			{
+				const Collection* collection = mOldArray[entry.oldIndex];
+				for(typename Collection::const_iterator iElem=collection->begin();iElem!=collection->end();++iElem)
+				{
+					newCollection->insert(typename Collection::value_type((*iElem).first, (*iElem).second));
+				}
+			}
+		}
+		return used;
+	}
+
+	// Third round: Deletes the collections left in the old buckets
+	// [first, last)
+	void deleteRange(size_t first, size_t last)
+	{
+		for (size_t i=first;i<last;++i)
+		{
+			destroyCollection(mOldArray[i]);
+			mOldArray[i] = 0;
+		}
+	}
+
+	// Adds the buckets of array to stats
+	void addStats(const Array array, size_t allocated, HashTableStats& stats) const
+	{
+		for (size_t i=0;i<allocated;++i)
+		{
+			const Collection* collection = array[i];
+			stats.addLength(collection != 0 ? collection->size() : 0);
+			if (collection != 0)
+				stats.bytes += getCollectionBytes(*collection);
+		}
+	}
+
+	// Roughly what a collection has allocated, its own memory included.
+	// An InlineBucket knows, others are taken to allocate a node per 
+	// element, of the element and three pointers (as std::map does).
+	template <class K, class V, size_t N>
+	static size_t getCollectionBytes(const InlineBucket<K, V, N>& collection)
+	{
+		return sizeof(collection) + collection.getNodeBytes();
+	}
+
+	template <class OtherCollection>
+	static size_t getCollectionBytes(const OtherCollection& collection)
+	{
+		return sizeof(collection) + collection.size()*(sizeof(value_type) + 3*sizeof(void*));
+	}
+
+	Collection* createCollection()
+	{
+		return new (mAllocator.allocate(sizeof(Collection))) Collection;
+	}
+
+	// The memory is left to the caller unless deallocate, see release()
+	void destroyCollection(Collection* collection, bool deallocate=true)
+	{
+		if (collection != 0)
+		{
+			collection->~Collection();
+			if (deallocate)
+				mAllocator.deallocate(collection, sizeof(Collection));
+		}
+	}
+
+	// Delete the array and everything in it, the table is unusable until
+	// init() is called. An allocator that can will free the collections
+	// all at once.
+	void release()
+	{
+		if (mArray != 0)
+		{
+			for (size_t i=0;i<mAllocated;++i)
+			{
+				destroyCollection(mArray[i], !MyAllocator::cCanReleaseAll);
+				mArray[i] = 0;
+			}
+
+			delete [] mArray;
+			mArray = 0;
+		}
+		releaseOld(!MyAllocator::cCanReleaseAll);
+		mAllocator.releaseAll();
+		mAllocated=0;
+		mMagic=0;
+		mFreeSlots=0;
+		mSize=0;
+	}
+
+	// Delete the old array, and any collections left in it. Their memory
+	// is left to the caller unless deallocate.
+	void releaseOld(bool deallocate=true)
+	{
+		if (mOldArray != 0)
+		{
+			for (size_t i=0;i<mOldAllocated;++i)
+			{
+				destroyCollection(mOldArray[i], deallocate);
+			}
+
+			delete [] mOldArray;
+			mOldArray = 0;
+		}
+		mOldAllocated = 0;
+		mOldMagic = 0;
+		mOldSize = 0;
+		mMigrated = 0;
+	}
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	// Keys hashed and prefetched ahead by find_batch()
+	enum { cBatchSize = 16 };
+
+	// Elements of an old bucket whose new buckets are kept while it's
+	// moved, the ones after that, if any, are hashed twice
+	enum { cMoveIndexes = 16 };
+
+	// Partitions of neighbouring buckets build() sorts the elements into
+	enum { cBuildPartitions = 1024 };
+
+	// Old arrays smaller than this are rehashed on the calling thread
+	// by default, see setWorkerPool()
+	enum { cParallelRehashMin = 1 << 16 };
+
+	// Tasks a parallel rehash or traversal is split into per thread, to
+	// even out the load
+	enum { cTasksPerThread = 4 };
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	// The hash table iteself
+	Array	mArray;
+	size_t	mAllocated; // The actual size of the array
+	size_t	mMagic; // mGrower.getMagic(mAllocated), so lookups don't work it out
+	size_t	mFreeSlots; // Number of free slots in the array
+	size_t	mSize;	// Number of collections stored in the hash table (incl. sub collections)
+
+	MyGrower mGrower;
+	MyAllocator mAllocator;
+
+	// The array being moved from during an incremental rehash, see above.
+	// mOldArray is 0 when there's none.
+	Array	mOldArray;
+	size_t	mOldAllocated;
+	size_t	mOldMagic;
+	size_t	mOldSize; // Number of elements left in the old array
+	size_t	mMigrated; // Old buckets before this one have been moved
+	size_t	mIncrementalStep; // Old buckets to move per operation, 0 if not incremental
+
+	WorkerPool* mWorkerPool; // Rehashes on it if not 0, see above
+	size_t	mParallelRehashMin; // Smallest old array rehashed on mWorkerPool
+
+	// See stats()
+	size_t	mRehashes;
+	double	mRehashSeconds;
+	HashTableCounters mCounters;
+};
+
+#endif // !defined(HASHTABLECHAINED_H)
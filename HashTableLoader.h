@@ -0,0 +1,438 @@
+/*=====================================================================
+	HashTableLoader.h - Parallel loading of delimited text into a table
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		// Splits a line at a delimiter and converts the two parts
+		class DelimitedParser
+
+		template <class Key, class Value,
+		  class MyParser = DelimitedParser
+		  >
+		class HashTableLoader
+
+  Requirements:
+		C++11 (std::mutex, std::exception_ptr)
+		The table needs build(), eg HashTableProbed or HashTableChained.
+
+  Dependencies:
+		MappedFile.h, WorkerPool.h
+
+  Pipeline:
+		The file is mapped, not read, and cut into chunks at the first
+		line break after every chunkSize bytes. The pool's threads take
+		chunks in file order and parse each into a batch of elements. A
+		batch is inserted, by build(), when all batches before it have
+		been, so the first of duplicate keys is kept just like when
+		inserting line by line. Only one thread inserts at a time, and it's
+		whichever finds the next batch ready, so the threads parse whenever
+		there's nothing to insert. There are a fixed number of batches,
+		reused for one chunk after another, which limits how far parsing
+		can run ahead of inserting. Reusing them also reuses the elements'
+		memory, eg a std::string key is assigned to rather than allocated.
+
+=====================================================================*/
+#if !defined(HASHTABLELOADER_H)
+#define HASHTABLELOADER_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdlib.h> // strtod
+#include <string.h> // memchr
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "WorkerPool.h"
+
+//------------------------------------------------------------------------
+// DelimitedParser
+// A line is a key and a value separated by a delimiter, a tab by default.
+// Strings are taken as is, numbers must be nothing but the number. Keys
+// and values of other types need a parser of your own, ie a class with
+// a bool operator()(const char* begin, const char* end, Key&, Value&)
+// that returns false if the line is malformed. It's called from several
+// threads at once.
+class DelimitedParser
+{
+public:
+	explicit DelimitedParser(char delimiter='\t'):mDelimiter(delimiter) {}
+
+	template <class Key, class Value>
+	bool operator()(const char* begin, const char* end, Key& key, Value& value) const
+	{
+		const char* delimiter = static_cast<const char*>(memchr(begin, mDelimiter, end - begin));
+		if (delimiter == 0)
+			return false;
+
+		return convert(begin, delimiter, key) && convert(delimiter + 1, end, value);
+	}
+
+	//------------------------------------------------------------------
+	// Conversions from [begin, end) to the supported types
+	//------------------------------------------------------------------
+	static bool convert(const char* begin, const char* end, std::string& result)
+	{
+		result.assign(begin, end);
+		return true;
+	}
+
+	static bool convert(const char* begin, const char* end, int& result) { return convertSigned(begin, end, result); }
+	static bool convert(const char* begin, const char* end, long& result) { return convertSigned(begin, end, result); }
+	static bool convert(const char* begin, const char* end, long long& result) { return convertSigned(begin, end, result); }
+	static bool convert(const char* begin, const char* end, unsigned int& result) { return convertUnsigned(begin, end, result); }
+	static bool convert(const char* begin, const char* end, unsigned long& result) { return convertUnsigned(begin, end, result); }
+	static bool convert(const char* begin, const char* end, unsigned long long& result) { return convertUnsigned(begin, end, result); }
+
+	static bool convert(const char* begin, const char* end, double& result)
+	{
+		// strtod wants it terminated, and the mapped file isn't
+		char buffer[cMaxNumber + 1];
+		if (begin == end || end - begin > cMaxNumber)
+			return false;
+		memcpy(buffer, begin, end - begin);
+		buffer[end - begin] = 0;
+
+		char* parsed = 0;
+		result = strtod(buffer, &parsed);
+		return parsed == buffer + (end - begin);
+	}
+
+	static bool convert(const char* begin, const char* end, float& result)
+	{
+		double value;
+		if (!convert(begin, end, value))
+			return false;
+		result = float(value);
+		return true;
+	}
+
+private:
+	// Longest number text taken by the floating point conversion
+	enum { cMaxNumber = 64 };
+
+	// Digits only, false on overflow
+	template <class Int>
+	static bool convertUnsigned(const char* begin, const char* end, Int& result)
+	{
+		if (begin == end)
+			return false;
+
+		Int value = 0;
+		for (const char* p=begin;p<end;++p)
+		{
+			if (*p < '0' || *p > '9')
+				return false;
+			Int digit = Int(*p - '0');
+			if (value > (Int(-1) - digit) / 10)
+				return false;
+			value = value*10 + digit;
+		}
+		result = value;
+		return true;
+	}
+
+	// An optional minus, then digits. The magnitude is parsed unsigned,
+	// so the most negative value fits.
+	template <class Int>
+	static bool convertSigned(const char* begin, const char* end, Int& result)
+	{
+		bool negative = begin != end && *begin == '-';
+		unsigned long long magnitude;
+		if (!convertUnsigned(negative ? begin + 1 : begin, end, magnitude))
+			return false;
+
+		unsigned long long max = ((unsigned long long)1 << (sizeof(Int)*8 - 1)) - 1;
+		if (magnitude > max + (negative ? 1 : 0))
+			return false;
+
+		result = negative ? Int(0 - magnitude) : Int(magnitude);
+		return true;
+	}
+
+	char mDelimiter;
+};
+
+//------------------------------------------------------------------------
+// HashTableLoader
+// Fills tables from text with a line per element, see Pipeline above.
+// class Key
+//   The key type
+// class Value:
+//   The value type
+// class MyParser:
+//   Turns a line (without the line break) into a key and a value, see
+//   DelimitedParser.
+template <class Key, class Value,
+		  class MyParser = DelimitedParser
+		  >
+class HashTableLoader
+{
+public:
+	//------------------------------------------------------------------
+	// Public Type Definitions
+	//------------------------------------------------------------------
+	typedef std::pair<Key, Value> value_type;
+
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	// Parses and inserts on pool's threads, in chunks of about chunkSize
+	// bytes
+	explicit HashTableLoader(WorkerPool& pool, const MyParser& parser=MyParser(), size_t chunkSize=cDefaultChunkSize)
+		:mPool(pool), mParser(parser), mChunkSize(chunkSize > 0 ? chunkSize : 1)
+	{
+	}
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+	// Inserts the elements of the file at path into table, skipping keys
+	// already stored. Returns the number of lines parsed, blank ones not
+	// counted. Throws "Malformed record" if the parser fails on a line,
+	// by then the lines before it may or may not have been inserted.
+	template <class Table>
+	size_t load(const char* path, Table& table)
+	{
+		MappedFile file;
+		file.open(path);
+		return load(file.getData(), file.getData() + file.getSize(), table);
+	}
+
+	// Same as above, for text in memory
+	template <class Table>
+	size_t load(const char* begin, const char* end, Table& table)
+	{
+		Pipeline<Table> pipeline(*this, begin, end, table);
+		parallelFor(mPool, mPool.getThreadCount(), PipelineTask<Table>(pipeline));
+		return pipeline.finish();
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	HashTableLoader(const HashTableLoader&);
+
+	// Assignment operator
+	HashTableLoader& operator = (const HashTableLoader&);
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	enum { cDefaultChunkSize = 4*1024*1024 };
+
+	// Batches per thread, ie how far parsing may run ahead
+	enum { cBatchesPerThread = 2 };
+
+	//------------------------------------------------------------------
+	// Private Classes
+	//------------------------------------------------------------------
+	// The parsed elements of a chunk. records only grows, count is how
+	// many of them belong to the current chunk.
+	struct Batch
+	{
+		Batch():count(0) {}
+
+		std::vector<value_type> records;
+		size_t count;
+	};
+
+	// One load(), worked on by every thread of the pool
+	template <class Table>
+	class Pipeline
+	{
+	public:
+		Pipeline(HashTableLoader& loader, const char* begin, const char* end, Table& table)
+			:mLoader(loader), mBegin(begin), mEnd(end), mTable(table),
+			mChunks((end - begin + loader.mChunkSize - 1) / loader.mChunkSize), mNextChunk(0), mNextInsert(0),
+			mInserting(false), mRecords(0)
+		{
+			mBatches.resize(mLoader.mPool.getThreadCount()*cBatchesPerThread);
+			for (size_t i=0;i<mBatches.size();++i)
+			{
+				mFree.push_back(&mBatches[i]);
+			}
+		}
+
+		// Inserts the next batch if it's ready and no one else is at it,
+		// otherwise parses the next chunk if there's a batch for it, until
+		// all are inserted or something failed.
+		void work()
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			while (!mError && mNextInsert < mChunks)
+			{
+				typename std::map<size_t, Batch*>::iterator ready = mReady.find(mNextInsert);
+				if (!mInserting && ready != mReady.end())
+				{
+					Batch* batch = ready->second;
+					mReady.erase(ready);
+					mInserting = true;
+
+					lock.unlock();
+					bool inserted = tryStep(&Pipeline::insert, batch);
+					lock.lock();
+
+					mInserting = false;
+					if (inserted)
+					{
+						mRecords += batch->count;
+						mFree.push_back(batch);
+						mNextInsert++;
+					}
+					mChanged.notify_all();
+				}
+				else if (mNextChunk < mChunks && !mFree.empty())
+				{
+					size_t chunk = mNextChunk++;
+					Batch* batch = mFree.back();
+					mFree.pop_back();
+
+					lock.unlock();
+					batch->count = 0;
+					bool parsed = tryStep(&Pipeline::parse, batch, chunk);
+					lock.lock();
+
+					if (parsed)
+						mReady[chunk] = batch;
+					mChanged.notify_all();
+				}
+				else
+					mChanged.wait(lock);
+			}
+		}
+
+		// Rethrows the first failure, or returns the lines parsed
+		size_t finish()
+		{
+			if (mError)
+				std::rethrow_exception(mError);
+			return mRecords;
+		}
+
+	private:
+		// Disabled
+		Pipeline(const Pipeline&);
+		Pipeline& operator = (const Pipeline&);
+
+		// The start of the line at or after p
+		const char* getLineStart(const char* p) const
+		{
+			if (p <= mBegin)
+				return mBegin;
+			if (p >= mEnd)
+				return mEnd;
+			const char* lineBreak = static_cast<const char*>(memchr(p - 1, '\n', mEnd - (p - 1)));
+			return lineBreak != 0 ? lineBreak + 1 : mEnd;
+		}
+
+		// Lines of chunk to batch
+		void parse(Batch* batch, size_t chunk)
+		{
+			const char* line = getLineStart(mBegin + chunk*mLoader.mChunkSize);
+			const char* last = chunk + 1 < mChunks ? getLineStart(mBegin + (chunk+1)*mLoader.mChunkSize) : mEnd;
+			std::vector<value_type>& records = batch->records;
+			while (line < last)
+			{
+				const char* lineEnd = static_cast<const char*>(memchr(line, '\n', last - line));
+				if (lineEnd == 0)
+					lineEnd = last;
+				const char* next = lineEnd < last ? lineEnd + 1 : last;
+				if (lineEnd > line && lineEnd[-1] == '\r')
+					lineEnd--;
+
+				if (lineEnd > line)
+				{
+					if (batch->count == records.size())
+						records.resize(records.size()*2 + 16);
+
+					value_type& record = records[batch->count];
+					if (!mLoader.mParser(line, lineEnd, record.first, record.second))
+						throw "Malformed record";
+					batch->count++;
+				}
+				line = next;
+			}
+		}
+
+		void insert(Batch* batch, size_t /*chunk*/)
+		{
+			mTable.build(batch->records.begin(), batch->records.begin() + batch->count);
+		}
+
+		// Calls step, returns false if it threw, after making sure the
+		// other threads stop
+		bool tryStep(void (Pipeline::*step)(Batch*, size_t), Batch* batch, size_t chunk=0)
+		{
+			try
+			{
+				(this->*step)(batch, chunk);
+				return true;
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (!mError)
+					mError = std::current_exception();
+				return false;
+			}
+		}
+
+		HashTableLoader& mLoader;
+		const char* mBegin;
+		const char* mEnd;
+		Table& mTable;
+		std::vector<Batch> mBatches;
+
+		// Guarded by mMutex
+		std::mutex mMutex;
+		std::condition_variable mChanged;	// A batch parsed or inserted, or a failure
+		size_t mChunks;
+		size_t mNextChunk;					// The next chunk to parse
+		size_t mNextInsert;					// The chunk whose batch is inserted next
+		std::map<size_t, Batch*> mReady;	// Parsed batches by chunk
+		std::vector<Batch*> mFree;			// Batches not in use
+		bool mInserting;
+		size_t mRecords;					// Lines parsed and inserted
+		std::exception_ptr mError;			// The first failure
+	};
+
+	// A task of load(), the tasks all work on the same pipeline
+	template <class Table>
+	class PipelineTask
+	{
+	public:
+		explicit PipelineTask(Pipeline<Table>& pipeline):mPipeline(pipeline) {}
+
+		void operator()(size_t /*task*/) const
+		{
+			mPipeline.work();
+		}
+
+	private:
+		Pipeline<Table>& mPipeline;
+	};
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	WorkerPool& mPool;
+	MyParser mParser;
+	size_t mChunkSize;
+};
+
+#endif // !defined(HASHTABLELOADER_H)
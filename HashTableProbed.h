@@ -1,501 +1,1258 @@
-/*=====================================================================
-	HashTableProbed.h - Probing hash table template class
-
-	Author: Per Nilsson
-
-	Freeware and no copyright on my behalf. However, if you use the 
-	code in some manner	I'd appreciate a notification about it
-	perfnurt@hotmail.com
-
-	Classes:
-
-		// The hash table 
-		template <class Key, class Value, 
-		  class MyHasher = Hasher<Key>,
-		  class MyGrower = DefaultGrower,
-		  >
-		class HashTableProbed
-		{
-			class iterator
-			class const_iterator
-
-			// Used as a proxy when operator[] is called
-			class Access			
-		}
-
-  Requirements:
-		A Hasher must be implemented if the generic ones isn't applicable.
-		Caller needs to #inlude default Grower/Hasher if they are to be used.
-
-  Dependencies:
-		To std::map if the default value_type is used
-
-=====================================================================*/
-#if !defined(HASHTABLEPROBED_H)
-#define HASHTABLEPROBED_H
-
-#if _MSC_VER > 1000
-#pragma once
-#endif // _MSC_VER > 1000
-
-#include <map>
-
-//------------------------------------------------------------------------
-// HashTableProbed
-// A generic hash collection, requires that the Hasher
-// has been implemented somwehere for the apropriate Key type.
-// It will simply hold ann array of <Key, Value> pairs, and using probing
-// to handle collisions
-// class Key
-//   The, well, key type
-// class Value: 
-//   The value type
-// class MyHasher:
-//   A class (function object) that will be called when computing the...well...hash value.
-//   Substitute with your own if the generic hashers aren't good enough/applicable
-// class MyGrower:
-//   A class used to determine what size the array should grow to
-template <class Key, class Value, 
-		  class MyHasher = Hasher<Key>,
-		  class MyGrower = DefaultGrower
-		  >
-class HashTableProbed  
-{
-public:
-	//------------------------------------------------------------------
-	// Public Type Definitions
-	//------------------------------------------------------------------
-	typedef std::pair<Key, Value> value_type;
-
-	//------------------------------------------------------------------
-	// Public Classes
-	//------------------------------------------------------------------
-	// class iterator
-	class iterator
-	{
-	public:
-		iterator(HashTableProbed& ht, size_t index):mHT(ht), mIndex(index) 
-		{
-			if (index<mHT.getAllocated() && mHT.getElement(index)==0)
-			{
-				++(*this);
-			}
-		}
-
-		bool operator == (const iterator& src) const
-		{
-			return mHT == src.mHT && mIndex == src.mIndex;
-		}
-
-		bool operator != (const iterator& src) const
-		{
-			return !(*this == src);
-		}
-
-		value_type& operator*()
-		{
-			return *mHT.getElement(mIndex);
-		}
-
-		size_t getIndex() const { return mIndex; }
-
-		iterator& operator ++ ()
-		{
-			mIndex++;
-			while (mIndex<mHT.getAllocated() && mHT.getElement(mIndex)==0)
-			{
-				mIndex++;
-			}
-			return (*this);
-		}
-
-	private:
-		HashTableProbed& mHT;
-		size_t mIndex;
-	};
-	// class const_iterator
-	class const_iterator
-	{
-	public:
-		const_iterator(const HashTableProbed& ht, size_t index):mHT(ht), mIndex(index) 
-		{
-			if (index<mHT.getAllocated() && mHT.getElement(index)==0)
-			{
-				++(*this);
-			}
-		}
-
-
-		bool operator == (const const_iterator& src) const
-		{
-			return mHT == src.mHT && mIndex == src.mIndex;
-		}
-
-		bool operator != (const const_iterator& src) const
-		{
-			return !(*this == src);
-		}
-
-		const value_type& operator*() const
-		{
-			return *mHT.getElement(mIndex);
-		}
-
-		size_t getIndex() const { return mIndex; }
-
-		const_iterator& operator ++ ()
-		{
-			mIndex++;
-			while (mIndex<mHT.getAllocated() && mHT.getElement(mIndex)==0)
-			{
-				mIndex++;
-			} 
-			return (*this);
-		}
-
-	private:
-		const HashTableProbed& mHT;
-		size_t mIndex;
-	};
-
-	// Used as a proxy when operator[] is called
-	// Handles theHash["foo"] = 42 and i = theHash["Foo"] differently.
-	class Access
-	{
-	public:
-		Access(HashTableProbed& ht, const Key& key):mHash(ht),mKey(key){}
-
-		// Assignment operator. Handles the myHash["Foo"] = 32; situation
-		operator=(const Value& value)
-		{
-			// Just use the Set method, it handles already exist/not exist situation
-			mHash.set(mKey,value);
-		}
-
-		// ValueType operator
-		operator Value()
-		{
-			HashTableProbed::iterator i = mHash.find(mKey);
-
-			// Not found
-			if (i==mHash.end())
-			{
-				throw "Item not found";
-			}
-
-			return (*i).second;
-		}
-	private:
-		//------------------------------
-		// Disabled Methods
-		//------------------------------
-		// Default constructor
-		Access();
-
-		//------------------------------
-		// Private Members
-		//------------------------------
-		HashTableProbed& mHash;
-		const Key& mKey;
-	}; // Access
-	
-	//------------------------------------------------------------------ 
-	// Public Construction
-	//------------------------------------------------------------------
-	// Default constructor
-	explicit HashTableProbed(size_t initialSize=1000) // Might be adjusted upwards
-	{
-		
-		size_t newAlloc = mGrower.getPrimeGreaterThan(initialSize);
-
-		mAllocated = newAlloc;
-		mFreeSlots = mAllocated;
-		mArray = new value_type*[mAllocated+1];
-		memset(mArray, 0, sizeof(mArray[0])*(mAllocated+1));
-		mSize=0;
-	}
-
-	// Destructor
-	virtual ~HashTableProbed()
-	{
-		clear();
-	}
-
-	//------------------------------------------------------------------
-	// Public Queries
-	//------------------------------------------------------------------
-	
-	// Find a non-const iterator, returns end() if not found.
-	const_iterator find(const Key& key) const
-	{
-		size_t hashValue = hash(key, mAllocated);
-		size_t index = hashValue;
-
-		const value_type* element = mArray[index];
-		const Value* v=0;
-
-		bool searchedAll = false;
-
-		while (!searchedAll)
-		{
-			if (element!=0 && element->first == key)
-			{
-				v = &element->second;
-				break;
-			}
-
-			index = (index + cIncBy) % mAllocated;
-			searchedAll = index==hashValue;
-			element = mArray[index];
-		}
-		if(v == 0)
-			return end();
-		else
-			return const_iterator(*this,index);
-	}
-
-
-	// Find a non-const iterator, returns end() if not found.
-	iterator find(const Key& key) 
-	{
-		size_t hashValue = hash(key, mAllocated);
-		size_t index = hashValue;
-
-		value_type* element = mArray[index];
-		Value* v=0;
-
-		bool searchedAll = false;
-
-		while (!searchedAll)
-		{
-			if (element!=0 && element->first == key)
-			{
-				v = &element->second;
-				break;
-			}
-
-			index = (index + cIncBy) % mAllocated;
-			searchedAll = index==hashValue;
-			element = mArray[index];
-		}
-		if(v == 0)
-			return end();
-		else
-			return iterator(*this,index);
-	}
-
-	size_t size() const { return mSize; }
-
-	value_type* getElement(size_t index) { return mArray[index]; }
-	const value_type* getElement(size_t index) const { return mArray[index]; }
-	size_t getAllocated() const { return mAllocated; }
-
-	//------------------------------------------------------------------
-	// Public Commands
-	//------------------------------------------------------------------
-
-	void set(const Key& key, const Value& value)
-	{
-		iterator i = find(key);
-		if (i == end())
-		{
-			if (!insert(key, value))
-				throw "Failed to insert";
-		}
-		else
-		{
-			(*i).second = value;
-		}
-			
-	}
-
-	// insert - returns false if no insertion took place
-	// key already stored or no free slots
-	bool insert(const value_type& vt)
-	{
-		return insert(vt.first, vt.second);
-	}
-
-	// insert - returns false if no insertion took place
-	// key already stored or no free slots
-	bool insert(const Key& key, const Value& value)
-	{
-		if (find(key) != end())
-			return false;
-
-		size_t newAlloc = mGrower.getNewSize(mAllocated, mFreeSlots);
-		bool allSearched=false;
-		if (newAlloc > mAllocated)
-		{
-			rehash(newAlloc);
-		}
-
-		size_t hashValue = hash(key, mAllocated);
-		size_t index = hashValue;
-		value_type* element = mArray[hashValue];
-
-		
-		while (element!=0 && !allSearched)
-		{
-			index = (index + cIncBy) % mAllocated;
-			element = mArray[index];
-
-			allSearched = index == hashValue;
-		}
-
-		if (allSearched)
-			return false;
-		else
-		{
-			element= new value_type(key, value);
-			mArray[index] = element;
-			mFreeSlots--;
-			mSize++;
-			return true;
-		};
-	}
-
-	size_t erase(const Key& key)
-	{
-		iterator it = find(key);
-		size_t erased=0;
-
-		if (it != end())
-		{
-			size_t index = it.getIndex();
-			delete mArray[index];
-			mArray[index] = 0;
-			mFreeSlots++;
-			mSize--;
-			erased++;
-		}
-
-		return erased;
-	}
-
-	void clear()
-	{
-		if (mArray != 0)
-		{
-			for (size_t i=0;i<mAllocated;++i)
-			{
-				delete mArray[i];
-				mArray[i] = 0;
-			}
-
-			delete [] mArray;
-			mArray = 0;
-		}
-		mAllocated=0;
-		mFreeSlots=0;
-		mSize=0;
-	}
-	//------------------------------------------------------------------
-	// Public Operators
-	//------------------------------------------------------------------
-	Access operator[](const Key& key)
-	{
-		return Access(*this, key);
-	}
-
-	bool operator == (const HashTableProbed& src) const
-	{
-		return mArray == src.mArray;
-	}
-
-	//------------------------------------------------------------------
-	// Public Iterators
-	//------------------------------------------------------------------
-	iterator		begin() { return iterator(*this, 0); }
-	const_iterator	begin() const { return const_iterator(*this, 0); }
-	iterator		end() { return iterator(*this, mAllocated); }
-	const_iterator	end() const { return const_iterator(*this, mAllocated); }
-
-private:
-	//------------------------------------------------------------------
-	// Disabled Methods
-	//------------------------------------------------------------------
-    // Copy constructor
-	explicit HashTableProbed(const HashTableProbed&);
-
-	// Assignment operator
-	HashTableProbed operator = (const HashTableProbed&);
-
-	//------------------------------------------------------------------
-	// Private Type Definitions
-	//------------------------------------------------------------------    
-	typedef value_type**	 Array; // == array of value_type pointer
-	//------------------------------------------------------------------
-	// Private Helper Methods
-	//------------------------------------------------------------------
-	size_t hash(const Key& key, size_t allocated) const
-	{
-		MyHasher hasher;
-		size_t size_t = hasher(key, allocated);
-		return size_t;
-	}
-
-	static void deleteElement(value_type* m)
-	{
-		delete m;
-		m = 0;
-	}
-
-	// Create a new, bigger, array
-	void rehash(size_t newAlloc)
-	{
-		size_t oldAllocated = mAllocated;
-		Array newArray = new value_type*[newAlloc+1];
-		memset(newArray, 0, sizeof(newArray[0])*(newAlloc+1));
-
-		size_t newFreeSlots = newAlloc;
-
-		for (size_t i=0; i<oldAllocated; ++i)
-		{
-			value_type* element = mArray[i];
-			if(element)
-			{
-				size_t newHashValue = hash(element->first, newAlloc);
-				size_t index = newHashValue;
-				value_type* newElement = newArray[newHashValue];
-
-				while (newElement!=0)
-				{
-					index = (index + cIncBy) % newAlloc;
-					newElement = newArray[index];
-				}
-
-				// Simply move the element to the new array
-				newArray[index] = element;
-				newFreeSlots--;
-			}
-		}
-
-		// Note: Dont delete the elements in the old array, they are moved
-		// as-is to the new array.
-		if (mArray!=0)
-			delete [] mArray;
-		mArray = newArray;
-		mAllocated = newAlloc;
-		mFreeSlots = newFreeSlots;
-	}
-	//------------------------------------------------------------------
-	// Private Constants
-	//------------------------------------------------------------------
-	// Probing increment
-	enum { cIncBy = 7 };
-
-	//------------------------------------------------------------------
-	// Members
-	//------------------------------------------------------------------
-	// The hash table iteself
-	Array	mArray;
-	size_t	mAllocated; // The actual size of the array
-	size_t	mFreeSlots; // Number of free slots in the array
-	size_t	mSize;	// Number of elements stored in the hash table (incl. sub collections)
-
-	MyGrower mGrower;
-
-};
-
-#endif // !defined(HASHTABLEPROBED_H)
+/*=====================================================================
+	HashTableProbed.h - Probing hash table template class
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the 
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		// The hash table 
+		template <class Key, class Value, 
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower,
+		  class MyHashCache = NoHashCache
+		  >
+		class HashTableProbed
+		{
+			class iterator
+			class const_iterator
+
+			// Used as a proxy when operator[] is called
+			class Access			
+		}
+
+  Requirements:
+		A Hasher must be implemented if the generic ones isn't applicable,
+		it needs the full width () operator (see GenericHashers.h).
+		Caller needs to #inlude default Grower/Hasher if they are to be used.
+
+  Dependencies:
+		To std::map if the default value_type is used
+		To std::vector for build()
+		HashCache.h, Prefetch.h, WorkerPool.h, AtomicOps.h, HashTableStats.h
+
+  Storage:
+		The <Key, Value> pairs are stored in place in one contiguous slot 
+		array, a separate array of state bytes tells which slots are used. 
+		Hence no heap allocation per element, but note that pointers and 
+		references to elements are invalidated when the array grows.
+
+  Erase:
+		An erased slot is marked as deleted (a tombstone) rather than empty,
+		so probe chains passing through it aren't broken. That lets find()
+		stop at the first empty slot. Tombstones are reused by insert, and
+		are turned back into empty slots when the following slot in the
+		probe sequence is empty. Tombstones don't count as free slots for 
+		the grower, when they're what makes the grower ask for a bigger 
+		array the table is instead rehashed at its current size.
+
+  Incremental rehash:
+		By default all elements are moved to the new array at once when it
+		grows. After setIncrementalRehash(n) the old array is kept instead,
+		and each insert, erase and (non-const) find moves the elements of
+		the next n old slots. Lookups check both arrays until it's done.
+		The slot index space (getAllocated(), getElement()) then covers the
+		new array followed by the old one. Note that moving elements
+		invalidates iterators, also for a find().
+
+  Parallel rehash:
+		After setWorkerPool() a rehash of a big array is split over the
+		pool's threads. Each takes a range of the old slots and moves the
+		elements to the new array, claiming their new slots with an atomic
+		compare-and-swap on the slot state. Not combined with incremental
+		rehash, which moves a few slots at a time anyway. build() doesn't
+		use the pool, the probe sequences of one partition of slots run
+		into the next.
+
+  Parallel traversal:
+		for_each_in(first, last, visitor) visits the elements in a range
+		of the slot index space (see getAllocated()), and disjoint ranges
+		may be visited by different threads at the same time, eg from a
+		std::for_each(std::execution::par, ...) over a list of ranges.
+		parallel_for_each(pool, visitor) does the splitting on a WorkerPool
+		and gives each task a copy of visitor, which are returned so that
+		their results can be combined. Nothing may change the table while
+		it's being visited.
+
+  Statistics:
+		stats() tells how long the probe sequences of the stored elements
+		are, how many slots are empty or tombstones, how often and for how
+		long the table has rehashed, and roughly how much memory it uses.
+		With HASHTABLE_STATS defined it also counts the slots looked at by
+		find, insert and erase. See HashTableStats.h.
+
+=====================================================================*/
+#if !defined(HASHTABLEPROBED_H)
+#define HASHTABLEPROBED_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <map>
+#include <new> // placement new
+#include <string.h> // memset
+#include <vector>
+
+#include "AtomicOps.h"
+#include "HashCache.h"
+#include "HashTableStats.h"
+#include "Prefetch.h"
+#include "WorkerPool.h"
+
+//------------------------------------------------------------------------
+// HashTableProbed
+// A generic hash collection, requires that the Hasher
+// has been implemented somwehere for the apropriate Key type.
+// It will simply hold ann array of <Key, Value> pairs, and using probing
+// to handle collisions. The pairs live directly in the array (no separate
+// node per element), occupancy is kept in a parallel array of state bytes.
+// class Key
+//   The, well, key type
+// class Value: 
+//   The value type
+// class MyHasher:
+//   A class (function object) that will be called when computing the...well...hash value.
+//   Substitute with your own if the generic hashers aren't good enough/applicable
+// class MyGrower:
+//   A class used to determine what size the array should grow to
+// class MyHashCache:
+//   NoHashCache or HashCache, the latter keeps the hash value of each key
+//   so rehashing doesn't have to hash the keys again. See HashCache.h
+template <class Key, class Value, 
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower,
+		  class MyHashCache = NoHashCache
+		  >
+class HashTableProbed  
+{
+public:
+	//------------------------------------------------------------------
+	// Public Type Definitions
+	//------------------------------------------------------------------
+	typedef std::pair<Key, Value> value_type;
+
+	//------------------------------------------------------------------
+	// Public Classes
+	//------------------------------------------------------------------
+	// class iterator
+	class iterator
+	{
+	public:
+		iterator(HashTableProbed& ht, size_t index):mHT(ht), mIndex(index) 
+		{
+			if (index<mHT.getAllocated() && mHT.getElement(index)==0)
+			{
+				++(*this);
+			}
+		}
+
+		bool operator == (const iterator& src) const
+		{
+			return mHT == src.mHT && mIndex == src.mIndex;
+		}
+
+		bool operator != (const iterator& src) const
+		{
+			return !(*this == src);
+		}
+
+		value_type& operator*()
+		{
+			return *mHT.getElement(mIndex);
+		}
+
+		size_t getIndex() const { return mIndex; }
+
+		iterator& operator ++ ()
+		{
+			mIndex++;
+			while (mIndex<mHT.getAllocated() && mHT.getElement(mIndex)==0)
+			{
+				mIndex++;
+			}
+			return (*this);
+		}
+
+	private:
+		HashTableProbed& mHT;
+		size_t mIndex;
+	};
+	// class const_iterator
+	class const_iterator
+	{
+	public:
+		const_iterator(const HashTableProbed& ht, size_t index):mHT(ht), mIndex(index) 
+		{
+			if (index<mHT.getAllocated() && mHT.getElement(index)==0)
+			{
+				++(*this);
+			}
+		}
+
+
+		bool operator == (const const_iterator& src) const
+		{
+			return mHT == src.mHT && mIndex == src.mIndex;
+		}
+
+		bool operator != (const const_iterator& src) const
+		{
+			return !(*this == src);
+		}
+
+		const value_type& operator*() const
+		{
+			return *mHT.getElement(mIndex);
+		}
+
+		size_t getIndex() const { return mIndex; }
+
+		const_iterator& operator ++ ()
+		{
+			mIndex++;
+			while (mIndex<mHT.getAllocated() && mHT.getElement(mIndex)==0)
+			{
+				mIndex++;
+			} 
+			return (*this);
+		}
+
+	private:
+		const HashTableProbed& mHT;
+		size_t mIndex;
+	};
+
+	// Used as a proxy when operator[] is called
+	// Handles theHash["foo"] = 42 and i = theHash["Foo"] differently.
+	class Access
+	{
+	public:
+		Access(HashTableProbed& ht, const Key& key):mHash(ht),mKey(key){}
+
+		// Assignment operator. Handles the myHash["Foo"] = 32; situation
+		void operator=(const Value& value)
+		{
+			// Just use the Set method, it handles already exist/not exist situation
+			mHash.set(mKey,value);
+		}
+
+		// ValueType operator
+		operator Value()
+		{
+			HashTableProbed::iterator i = mHash.find(mKey);
+
+			// Not found
+			if (i==mHash.end())
+			{
+				throw "Item not found";
+			}
+
+			return (*i).second;
+		}
+	private:
+		//------------------------------
+		// Disabled Methods
+		//------------------------------
+		// Default constructor
+		Access();
+
+		//------------------------------
+		// Private Members
+		//------------------------------
+		HashTableProbed& mHash;
+		const Key& mKey;
+	}; // Access
+	
+	//------------------------------------------------------------------ 
+	// Public Construction
+	//------------------------------------------------------------------
+	// Default constructor
+	explicit HashTableProbed(size_t initialSize=1000) // Might be adjusted upwards
+		:mIncrementalStep(0), mWorkerPool(0), mParallelRehashMin(cParallelRehashMin), mRehashes(0), mRehashSeconds(0)
+	{
+		init(initialSize);
+	}
+
+	// Range constructor, the elements of [first, last) are inserted by 
+	// build(), see below.
+	template <class ForwardIterator>
+	HashTableProbed(ForwardIterator first, ForwardIterator last)
+		:mIncrementalStep(0), mWorkerPool(0), mParallelRehashMin(cParallelRehashMin), mRehashes(0), mRehashSeconds(0)
+	{
+		init(0);
+		build(first, last);
+	}
+
+	// Destructor
+	virtual ~HashTableProbed()
+	{
+		release();
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+	
+	// Find a non-const iterator, returns end() if not found.
+	const_iterator find(const Key& key) const
+	{
+		return const_iterator(*this, findIndex(key));
+	}
+
+
+	// Find a non-const iterator, returns end() if not found.
+	iterator find(const Key& key) 
+	{
+		migrate(mIncrementalStep);
+		return iterator(*this, findIndex(key));
+	}
+
+	// Looks up n keys, results[i] is set to the element with keys[i], or 0 
+	// if not found. The keys are handled in batches, all keys of a batch 
+	// are hashed and their slots prefetched before the first is probed, 
+	// so that the cache misses overlap. 
+	void find_batch(const Key* keys, size_t n, const value_type** results) const
+	{
+		size_t hashValues[cBatchSize];
+		size_t fullHashes[cBatchSize];
+
+		for (size_t first=0;first<n;first+=cBatchSize)
+		{
+			size_t count = n-first < cBatchSize ? n-first : size_t(cBatchSize);
+			size_t i;
+			for (i=0;i<count;++i)
+			{
+				hashValues[i] = hash(keys[first+i], mAllocated, mMagic, fullHashes[i]);
+				HASH_PREFETCH(&mState[hashValues[i]]);
+				HASH_PREFETCH(&mArray[hashValues[i]]);
+			}
+
+			for (i=0;i<count;++i)
+			{
+				const Key& key = keys[first+i];
+				size_t index = probeIndexIn(key, hashValues[i], fullHashes[i], mArray, mState, mHashCache, mAllocated);
+				if (index == mAllocated && mOldArray != 0)
+				{
+					index = mAllocated + findIndexIn(key, mOldArray, mOldState, mOldHashCache, mOldAllocated, mOldMagic);
+				}
+				results[first+i] = index < getAllocated() ? getElement(index) : 0;
+			}
+		}
+	}
+
+	void find_batch(const Key* keys, size_t n, value_type** results)
+	{
+		migrate(mIncrementalStep);
+		static_cast<const HashTableProbed&>(*this).find_batch(keys, n, const_cast<const value_type**>(results));
+	}
+
+	size_t size() const { return mSize; }
+
+	// Returns 0 if the slot isn't used. During an incremental rehash the
+	// indexes from the size of the new array and up are the old array's.
+	value_type* getElement(size_t index) 
+	{ 
+		if (index >= mAllocated)
+			return mOldState[index - mAllocated] == cUsed ? &mOldArray[index - mAllocated] : 0;
+		return mState[index] == cUsed ? &mArray[index] : 0; 
+	}
+	const value_type* getElement(size_t index) const 
+	{ 
+		if (index >= mAllocated)
+			return mOldState[index - mAllocated] == cUsed ? &mOldArray[index - mAllocated] : 0;
+		return mState[index] == cUsed ? &mArray[index] : 0; 
+	}
+	size_t getAllocated() const { return mAllocated + mOldAllocated; }
+
+	// True while an incremental rehash is in progress
+	bool isRehashing() const { return mOldArray != 0; }
+
+	// The probe length of every element, the empty slots and tombstones,
+	// the rehashes and the memory used, see above. Goes through all slots.
+	HashTableStats stats() const
+	{
+		HashTableStats stats;
+		stats.size = mSize;
+		stats.allocated = getAllocated();
+		addStats(mArray, mState, mAllocated, mMagic, stats);
+		if (mOldArray != 0)
+			addStats(mOldArray, mOldState, mOldAllocated, mOldMagic, stats);
+		stats.rehashes = mRehashes;
+		stats.rehashSeconds = mRehashSeconds;
+		stats.bytes = sizeof(*this) + (sizeof(value_type) + 1 + MyHashCache::getBytesPerSlot())*getAllocated();
+		mCounters.get(stats);
+		return stats;
+	}
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+
+	void set(const Key& key, const Value& value)
+	{
+		if (insert_or_assign(key, value).first == end())
+			throw "Failed to insert";
+	}
+
+	// insert - returns false if no insertion took place
+	// key already stored or no free slots
+	bool insert(const value_type& vt)
+	{
+		return insert(vt.first, vt.second);
+	}
+
+	// insert - returns false if no insertion took place
+	// key already stored or no free slots
+	bool insert(const Key& key, const Value& value)
+	{
+		return try_emplace(key, value).second;
+	}
+
+	// The element with key, and true if it was inserted by this call.
+	// Constructs the element from key and arg in its slot, if not already 
+	// stored. Hashes and probes once. Returns (end(), false) if there's no
+	// free slot.
+	template <class Arg>
+	std::pair<iterator, bool> try_emplace(const Key& key, const Arg& arg)
+	{
+		bool inserted;
+		size_t index = emplaceIndex(key, arg, inserted);
+		return std::pair<iterator, bool>(iterator(*this, index), inserted);
+	}
+
+	std::pair<iterator, bool> try_emplace(const Key& key)
+	{
+		return try_emplace(key, Value());
+	}
+
+	// Same as try_emplace()
+	template <class Arg>
+	std::pair<iterator, bool> emplace(const Key& key, const Arg& arg)
+	{
+		return try_emplace(key, arg);
+	}
+
+	// As try_emplace(), but assigns arg to the value if key is already stored
+	template <class Arg>
+	std::pair<iterator, bool> insert_or_assign(const Key& key, const Arg& arg)
+	{
+		bool inserted;
+		size_t index = emplaceIndex(key, arg, inserted);
+		if (!inserted && index != getAllocated())
+			getElement(index)->second = arg;
+		return std::pair<iterator, bool>(iterator(*this, index), inserted);
+	}
+
+	// Inserts the elements of [first, last), skipping keys already stored,
+	// just like calling insert() for each of them. But the array is grown
+	// once up front to fit them all, every key is hashed once, and they
+	// are inserted partitioned by slot so the writes sweep the array 
+	// rather than hitting it at random.
+	template <class ForwardIterator>
+	void build(ForwardIterator first, ForwardIterator last)
+	{
+		typedef BuildEntry<ForwardIterator> Entry;
+
+		size_t count = 0;
+		ForwardIterator it;
+		for (it=first;it!=last;++it)
+		{
+			count++;
+		}
+		if (count == 0)
+			return;
+
+		growFor(mSize + count);
+
+		// Radix partition on the slot index: count, offsets, scatter
+		size_t partitionSlots = mAllocated / cBuildPartitions + 1;
+		std::vector<size_t> offsets(cBuildPartitions + 1, 0);
+		std::vector<Entry> hashed(count);
+		size_t i = 0;
+		for (it=first;it!=last;++it,++i)
+		{
+			hashed[i].hashValue = hash((*it).first, mAllocated, mMagic, hashed[i].fullHash);
+			hashed[i].it = it;
+			offsets[hashed[i].hashValue / partitionSlots + 1]++;
+		}
+		size_t partition;
+		for (partition=0;partition<cBuildPartitions;++partition)
+		{
+			offsets[partition+1] += offsets[partition];
+		}
+		std::vector<Entry> partitioned(count);
+		for (i=0;i<count;++i)
+		{
+			partitioned[offsets[hashed[i].hashValue / partitionSlots]++] = hashed[i];
+		}
+
+		for (i=0;i<count;++i)
+		{
+			const Entry& entry = partitioned[i];
+			const Key& key = (*entry.it).first;
+			size_t freeIndex;
+			if (probeForInsert(key, entry.hashValue, entry.fullHash, freeIndex) != mAllocated)
+				continue; // Already stored
+
+			if (freeIndex != mAllocated)
+				constructAt(freeIndex, entry.fullHash, key, (*entry.it).second);
+			else
+				insert(key, (*entry.it).second);
+		}
+	}
+
+	size_t erase(const Key& key)
+	{
+		iterator it = find(key);
+		size_t erased=0;
+
+		if (it != end() && it.getIndex() >= mAllocated)
+		{
+			// Still in the old array, which is thrown away when the rehash 
+			// is done, a tombstone will do.
+			size_t index = it.getIndex() - mAllocated;
+			mOldArray[index].~value_type();
+			mOldState[index] = cDeleted;
+			mOldSize--;
+			mSize--;
+			erased++;
+		}
+		else if (it != end())
+		{
+			size_t index = it.getIndex();
+			mArray[index].~value_type();
+
+			// A probe chain passing this slot would continue to the next one, 
+			// if that's empty no chain can pass, so no tombstone is needed.
+			if (mState[probeNext(index, mAllocated)] == cEmpty)
+			{
+				mState[index] = cEmpty;
+				mFreeSlots++;
+			}
+			else
+			{
+				mState[index] = cDeleted;
+				mDeleted++;
+			}
+			mSize--;
+			erased++;
+		}
+
+		return erased;
+	}
+
+	// Removes all elements, leaving the smallest array the grower hands
+	// out. The settings (load factor, incremental rehash, worker pool) 
+	// are kept.
+	void clear()
+	{
+		release();
+		init(0);
+	}
+
+	// Grows the array so that n elements fit without it growing again
+	void reserve(size_t n)
+	{
+		growFor(n);
+	}
+
+	// Sets the array size to the grower's smallest size of at least n 
+	// slots, or the size the elements need if that's bigger. Unlike
+	// reserve() it may shrink the array.
+	void rehash(size_t n)
+	{
+		finishMigration();
+
+		size_t newAlloc = getSizeFor(mSize, mGrower.getPrimeGreaterThan(n > 0 ? n-1 : 0));
+		if (newAlloc != mAllocated || mDeleted > 0)
+		{
+			rehashTo(newAlloc);
+			finishMigration();
+		}
+	}
+
+	// Shrinks the array to the size the elements need, eg after erasing
+	// most of them
+	void shrink_to_fit()
+	{
+		rehash(0);
+	}
+
+	// The largest fraction of the slots that may be in use before the 
+	// array grows, 0 < factor < 1. Set by the grower, 0.9 by default.
+	float max_load_factor() const { return mGrower.getMaxLoadFactor(); }
+	void max_load_factor(float factor)
+	{
+		mGrower.setMaxLoadFactor(factor);
+		growFor(mSize);
+	}
+
+	// Rehash incrementally, see above. slotsPerOperation is the number of
+	// old slots handled per insert/erase/find, 0 (default) moves all 
+	// elements at once.
+	void setIncrementalRehash(size_t slotsPerOperation)
+	{
+		mIncrementalStep = slotsPerOperation;
+		if (mIncrementalStep == 0)
+			finishMigration();
+	}
+
+	// Rehash arrays of at least minAllocated slots on pool, see above. 0
+	// (default) rehashes on the calling thread only. The pool must outlive
+	// the table, or the next setWorkerPool() call.
+	void setWorkerPool(WorkerPool* pool, size_t minAllocated=cParallelRehashMin)
+	{
+		mWorkerPool = pool;
+		mParallelRehashMin = minAllocated;
+	}
+
+	// Starts counting rehashes, and the hot path counters, from 0 again
+	void resetStats()
+	{
+		mRehashes = 0;
+		mRehashSeconds = 0;
+		mCounters.reset();
+	}
+
+	//------------------------------------------------------------------
+	// Public Operators
+	//------------------------------------------------------------------
+	Access operator[](const Key& key)
+	{
+		return Access(*this, key);
+	}
+
+	bool operator == (const HashTableProbed& src) const
+	{
+		return mArray == src.mArray;
+	}
+
+	//------------------------------------------------------------------
+	// Public Iterators
+	//------------------------------------------------------------------
+	iterator		begin() { return iterator(*this, 0); }
+	const_iterator	begin() const { return const_iterator(*this, 0); }
+	iterator		end() { return iterator(*this, getAllocated()); }
+	const_iterator	end() const { return const_iterator(*this, getAllocated()); }
+
+	// Calls visitor(element) for the elements in the slots [first, last),
+	// see Parallel traversal above. Returns visitor, like std::for_each.
+	template <class Visitor>
+	Visitor for_each_in(size_t first, size_t last, Visitor visitor)
+	{
+		for (size_t i=first;i<last;++i)
+		{
+			value_type* element = getElement(i);
+			if (element != 0)
+				visitor(*element);
+		}
+		return visitor;
+	}
+
+	template <class Visitor>
+	Visitor for_each_in(size_t first, size_t last, Visitor visitor) const
+	{
+		for (size_t i=first;i<last;++i)
+		{
+			const value_type* element = getElement(i);
+			if (element != 0)
+				visitor(*element);
+		}
+		return visitor;
+	}
+
+	// Visits all elements on pool, a range of slots per task, with a
+	// copy of visitor each. Returns the copies.
+	template <class Visitor>
+	std::vector<Visitor> parallel_for_each(WorkerPool& pool, const Visitor& visitor)
+	{
+		std::vector<Visitor> visitors(pool.getThreadCount()*cTasksPerThread, visitor);
+		parallelFor(pool, visitors.size(), ForEachTask<HashTableProbed, Visitor>(*this, visitors));
+		return visitors;
+	}
+
+	template <class Visitor>
+	std::vector<Visitor> parallel_for_each(WorkerPool& pool, const Visitor& visitor) const
+	{
+		std::vector<Visitor> visitors(pool.getThreadCount()*cTasksPerThread, visitor);
+		parallelFor(pool, visitors.size(), ForEachTask<const HashTableProbed, Visitor>(*this, visitors));
+		return visitors;
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+    // Copy constructor
+	explicit HashTableProbed(const HashTableProbed&);
+
+	// Assignment operator
+	HashTableProbed operator = (const HashTableProbed&);
+
+	//------------------------------------------------------------------
+	// Private Type Definitions
+	//------------------------------------------------------------------    
+	typedef value_type*	 Array; // == array of value_type slots (raw memory, see mState)
+
+	// An element of the range given to build(), and where it goes
+	template <class ForwardIterator>
+	struct BuildEntry
+	{
+		size_t hashValue;
+		size_t fullHash;
+		ForwardIterator it;
+	};
+
+	// A task of parallelMigrate(), task i moves the elements of the i:th
+	// range of old slots
+	class MigrateTask
+	{
+	public:
+		MigrateTask(HashTableProbed& ht, size_t tasks, std::vector<size_t>& moved):mHT(ht), mTasks(tasks), mMoved(moved) {}
+
+		void operator()(size_t task) const
+		{
+			size_t slotsPerTask = mHT.mOldAllocated / mTasks + 1;
+			size_t first = task*slotsPerTask;
+			size_t last = first + slotsPerTask;
+			if (first > mHT.mOldAllocated)
+				first = mHT.mOldAllocated;
+			if (last > mHT.mOldAllocated)
+				last = mHT.mOldAllocated;
+			mMoved[task] = mHT.migrateRange(first, last);
+		}
+
+	private:
+		HashTableProbed& mHT;
+		size_t mTasks;
+		std::vector<size_t>& mMoved;
+	};
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	// Shared by the constructors
+	void init(size_t initialSize)
+	{
+		size_t newAlloc = mGrower.getPrimeGreaterThan(initialSize);
+
+		mAllocated = newAlloc;
+		mMagic = mGrower.getMagic(mAllocated);
+		mFreeSlots = mAllocated;
+		mDeleted = 0;
+		mArray = allocateSlots(mAllocated);
+		mState = allocateStates(mAllocated);
+		mHashCache.allocate(mAllocated);
+		mSize=0;
+
+		mOldArray = 0;
+		mOldState = 0;
+		mOldAllocated = 0;
+		mOldMagic = 0;
+		mOldSize = 0;
+		mMigrated = 0;
+	}
+
+	// The grower knows how to map a key to a slot for the array sizes it 
+	// hands out, magic is what it worked out for allocated in advance. 
+	// fullHash is set to what the hash cache keeps for key.
+	size_t hash(const Key& key, size_t allocated, size_t magic, size_t& fullHash) const
+	{
+		MyHasher hasher;
+		return mHashCache.getIndex(hasher, mGrower, key, allocated, magic, fullHash);
+	}
+
+	// Next slot in the probe sequence. Subtracting instead of a modulo,
+	// only small arrays need more than one round.
+	static size_t probeNext(size_t index, size_t allocated)
+	{
+		index += cIncBy;
+		while (index >= allocated)
+			index -= allocated;
+		return index;
+	}
+
+	// Returns the slot index of key. If it's not stored an element is 
+	// constructed from key and arg, and inserted is set. Returns 
+	// getAllocated() if there's no free slot.
+	// The probe looking for key also notes the first free slot, so key is
+	// only hashed again if the array has to grow.
+	template <class Arg>
+	size_t emplaceIndex(const Key& key, const Arg& arg, bool& inserted)
+	{
+		migrate(mIncrementalStep);
+		inserted = false;
+
+		size_t fullHash;
+		size_t hashValue = hash(key, mAllocated, mMagic, fullHash);
+		size_t freeIndex;
+		size_t index = probeForInsert(key, hashValue, fullHash, freeIndex);
+		if (index != mAllocated)
+			return index;
+
+		if (mOldArray != 0)
+		{
+			size_t oldIndex = findIndexIn(key, mOldArray, mOldState, mOldHashCache, mOldAllocated, mOldMagic);
+			if (oldIndex != mOldAllocated)
+				return mAllocated + oldIndex;
+		}
+
+		// The elements still in the old array will need slots as well
+		size_t freeSlots = mFreeSlots > mOldSize ? mFreeSlots - mOldSize : 0;
+		size_t newAlloc = mGrower.getNewSize(mAllocated, freeSlots);
+		if (newAlloc > mAllocated)
+		{
+			// Can't start a new rehash before the current one is done
+			finishMigration();
+
+			// If getting rid of the tombstones frees enough slots there's
+			// no need to grow, just clean up
+			if (mGrower.getNewSize(mAllocated, mFreeSlots + mDeleted) <= mAllocated)
+				newAlloc = mAllocated;
+			rehashTo(newAlloc);
+
+			// The key isn't stored, so the first slot not in use will do
+			hashValue = hash(key, mAllocated, mMagic, fullHash);
+			freeIndex = hashValue;
+			while (mState[freeIndex]==cUsed)
+			{
+				freeIndex = probeNext(freeIndex, mAllocated);
+				if (freeIndex == hashValue)
+				{
+					freeIndex = mAllocated;
+					break;
+				}
+			}
+		}
+
+		if (freeIndex == mAllocated)
+			return getAllocated();
+
+		constructAt(freeIndex, fullHash, key, arg);
+		inserted = true;
+		return freeIndex;
+	}
+
+	// Returns the slot index of the already hashed key, or mAllocated if
+	// it's not in the current array. freeIndex is set to the first slot 
+	// not in use in its probe sequence, mAllocated if there's none.
+	size_t probeForInsert(const Key& key, size_t hashValue, size_t fullHash, size_t& freeIndex) const
+	{
+		size_t index = hashValue;
+		freeIndex = mAllocated;
+
+		bool searchedAll = false;
+		size_t steps = 1;
+
+		// An empty slot ends the probe chain, tombstones don't.
+		while (!searchedAll && mState[index]!=cEmpty)
+		{
+			if (mState[index]==cUsed)
+			{
+				if (mHashCache.matches(index, fullHash) && mArray[index].first == key)
+				{
+					mCounters.countLookup(steps);
+					return index;
+				}
+			}
+			else if (freeIndex == mAllocated)
+			{
+				freeIndex = index;
+			}
+
+			index = probeNext(index, mAllocated);
+			searchedAll = index==hashValue;
+			steps++;
+		}
+		if (freeIndex == mAllocated && !searchedAll)
+			freeIndex = index;
+		mCounters.countLookup(steps);
+		return mAllocated;
+	}
+
+	// Construct the pair right in the free slot index
+	template <class Arg>
+	void constructAt(size_t index, size_t fullHash, const Key& key, const Arg& arg)
+	{
+		if (mState[index] == cDeleted)
+			mDeleted--;
+		else
+			mFreeSlots--;
+
+		new (&mArray[index]) value_type(key, arg);
+		mState[index] = cUsed;
+		mHashCache.set(index, fullHash);
+		mSize++;
+	}
+
+	// Grow the array, at once, so that total elements fit without the 
+	// grower asking for more. Also gets rid of the tombstones if they're
+	// what's in the way.
+	void growFor(size_t total)
+	{
+		finishMigration();
+
+		size_t newAlloc = getSizeFor(total, mAllocated);
+		size_t adding = total > mSize ? total - mSize : 0;
+		if (newAlloc > mAllocated || 
+			mGrower.getNewSize(mAllocated, mFreeSlots > adding ? mFreeSlots - adding : 0) > mAllocated)
+		{
+			rehashTo(newAlloc);
+			finishMigration();
+		}
+	}
+
+	// The array size, from size and up, the grower settles on for total 
+	// elements
+	size_t getSizeFor(size_t total, size_t size) const
+	{
+		for (;;)
+		{
+			size_t freeSlots = size > total ? size - total : 0;
+			size_t biggerSize = mGrower.getNewSize(size, freeSlots);
+			if (biggerSize <= size)
+				return size;
+			size = biggerSize;
+		}
+	}
+
+	// Returns the slot index of key, or getAllocated() if not found
+	size_t findIndex(const Key& key) const
+	{
+		size_t index = findIndexIn(key, mArray, mState, mHashCache, mAllocated, mMagic);
+
+		if (index == mAllocated && mOldArray != 0)
+		{
+			index = mAllocated + findIndexIn(key, mOldArray, mOldState, mOldHashCache, mOldAllocated, mOldMagic);
+		}
+		return index;
+	}
+
+	// Returns the slot index of key in array, or allocated if not found
+	size_t findIndexIn(const Key& key, const Array array, const unsigned char* state, const MyHashCache& hashCache, size_t allocated, size_t magic) const
+	{
+		size_t fullHash;
+		size_t hashValue = hash(key, allocated, magic, fullHash);
+		return probeIndexIn(key, hashValue, fullHash, array, state, hashCache, allocated);
+	}
+
+	// As above, for a key already hashed
+	size_t probeIndexIn(const Key& key, size_t hashValue, size_t fullHash, const Array array, const unsigned char* state, const MyHashCache& hashCache, size_t allocated) const
+	{
+		size_t index = hashValue;
+
+		bool searchedAll = false;
+		size_t steps = 1;
+
+		// An empty slot ends the probe chain, tombstones don't.
+		while (!searchedAll && state[index]!=cEmpty)
+		{
+			if (state[index]==cUsed && hashCache.matches(index, fullHash) && array[index].first == key)
+			{
+				mCounters.countLookup(steps);
+				return index;
+			}
+
+			index = probeNext(index, allocated);
+			searchedAll = index==hashValue;
+			steps++;
+		}
+		mCounters.countLookup(steps);
+		return allocated;
+	}
+
+	// The slots are raw memory, elements are constructed in place when
+	// inserted and destroyed when erased. 
+	static Array allocateSlots(size_t count)
+	{
+		return static_cast<Array>(::operator new(sizeof(value_type)*count));
+	}
+
+	static unsigned char* allocateStates(size_t count)
+	{
+		unsigned char* states = new unsigned char[count];
+		memset(states, cEmpty, sizeof(states[0])*count);
+		return states;
+	}
+
+	static void freeSlots(Array slots, unsigned char* states)
+	{
+		::operator delete(slots);
+		delete [] states;
+	}
+
+	// Create a new, bigger, array. Also used to get rid of tombstones,
+	// newAlloc is then the current size. The current array becomes the
+	// old one, its elements are moved right away unless rehashing 
+	// incrementally. 
+	void rehashTo(size_t newAlloc)
+	{
+		StatsTimer timer;
+		mRehashes++;
+
+		mOldArray = mArray;
+		mOldState = mState;
+		mOldHashCache.swap(mHashCache);
+		mOldAllocated = mAllocated;
+		mOldMagic = mMagic;
+		mOldSize = mSize;
+		mMigrated = 0;
+
+		mArray = allocateSlots(newAlloc);
+		mState = allocateStates(newAlloc);
+		mHashCache.allocate(newAlloc);
+		mAllocated = newAlloc;
+		mMagic = mGrower.getMagic(newAlloc);
+		mFreeSlots = newAlloc;
+		mDeleted = 0;
+
+		if (mIncrementalStep == 0)
+		{
+			if (mWorkerPool != 0 && mOldAllocated >= mParallelRehashMin)
+				parallelMigrate();
+			else
+				migrate(mOldAllocated);
+		}
+		timer.addTo(mRehashSeconds);
+	}
+
+	// Move the elements of the next steps slots of the old array, if any
+	void migrate(size_t steps)
+	{
+		if (mOldArray == 0)
+			return;
+
+		MyHasher hasher;
+		size_t last = mOldAllocated - mMigrated > steps ? mMigrated + steps : mOldAllocated;
+
+		for (; mMigrated < last && mOldSize > 0; ++mMigrated)
+		{
+			if(mOldState[mMigrated] == cUsed)
+			{
+				value_type& element = mOldArray[mMigrated];
+				size_t fullHash;
+				size_t index = mOldHashCache.getStoredIndex(hasher, mGrower, element.first, mMigrated, mAllocated, mMagic, fullHash);
+
+				while (mState[index]==cUsed)
+				{
+					index = probeNext(index, mAllocated);
+				}
+
+				if (mState[index] == cDeleted)
+					mDeleted--;
+				else
+					mFreeSlots--;
+
+				// Copy the element to its new slot, and get rid of the old one.
+				// The old slot becomes a tombstone, lookups in the old array 
+				// may still pass it.
+				new (&mArray[index]) value_type(element);
+				mState[index] = cUsed;
+				mHashCache.set(index, fullHash);
+				element.~value_type();
+				mOldState[mMigrated] = cDeleted;
+				mOldSize--;
+			}
+		}
+
+		if (mOldSize == 0)
+			releaseOld();
+	}
+
+	// Moves what's left of the old array, timed as part of the rehash
+	void finishMigration()
+	{
+		if (mOldArray == 0)
+			return;
+
+		StatsTimer timer;
+		migrate(mOldAllocated);
+		timer.addTo(mRehashSeconds);
+	}
+
+	// Moves all of the old array on mWorkerPool, a range of old slots per
+	// task. As for migrate(), but the new slots are claimed atomically as
+	// other tasks are filling the same array.
+	void parallelMigrate()
+	{
+		size_t tasks = mWorkerPool->getThreadCount()*cTasksPerThread;
+		std::vector<size_t> moved(tasks, 0);
+		parallelFor(*mWorkerPool, tasks, MigrateTask(*this, tasks, moved));
+
+		for (size_t i=0;i<tasks;++i)
+		{
+			mFreeSlots -= moved[i];
+			mOldSize -= moved[i];
+		}
+		mMigrated = mOldAllocated;
+		releaseOld();
+	}
+
+	// Moves the elements of the old slots [first, last), returns how many
+	size_t migrateRange(size_t first, size_t last)
+	{
+		MyHasher hasher;
+		size_t moved = 0;
+
+		for (size_t i=first;i<last;++i)
+		{
+			if(mOldState[i] == cUsed)
+			{
+				value_type& element = mOldArray[i];
+				size_t fullHash;
+				size_t index = mOldHashCache.getStoredIndex(hasher, mGrower, element.first, i, mAllocated, mMagic, fullHash);
+
+				// The new array has no tombstones
+				while (!atomicCompareAndSwap(&mState[index], cEmpty, cUsed))
+				{
+					index = probeNext(index, mAllocated);
+				}
+
+				new (&mArray[index]) value_type(element);
+				mHashCache.set(index, fullHash);
+				element.~value_type();
+				mOldState[i] = cDeleted;
+				moved++;
+			}
+		}
+		return moved;
+	}
+
+	// Adds the slots of array to stats, with the probe length of each
+	// element: the slots from the one its hash value points at to the
+	// one it's in, both included.
+	void addStats(const Array array, const unsigned char* state, size_t allocated, size_t magic, HashTableStats& stats) const
+	{
+		for (size_t i=0;i<allocated;++i)
+		{
+			if (state[i] == cEmpty)
+				stats.empty++;
+			else if (state[i] == cDeleted)
+				stats.tombstones++;
+			else
+			{
+				size_t fullHash;
+				size_t index = hash(array[i].first, allocated, magic, fullHash);
+				size_t length = 1;
+				while (index != i)
+				{
+					index = probeNext(index, allocated);
+					length++;
+				}
+				stats.addLength(length);
+			}
+		}
+	}
+
+	// Free the array, destroying the elements, the table is unusable until
+	// init() is called
+	void release()
+	{
+		if (mArray != 0)
+		{
+			for (size_t i=0;i<mAllocated;++i)
+			{
+				if (mState[i] == cUsed)
+					mArray[i].~value_type();
+			}
+
+			freeSlots(mArray, mState);
+			mArray = 0;
+			mState = 0;
+		}
+		mHashCache.release();
+		releaseOld();
+		mAllocated=0;
+		mMagic=0;
+		mFreeSlots=0;
+		mDeleted=0;
+		mSize=0;
+	}
+
+	// Free the old array, destroying any elements left in it
+	void releaseOld()
+	{
+		if (mOldArray != 0)
+		{
+			for (size_t i=0;i<mOldAllocated && mOldSize > 0;++i)
+			{
+				if (mOldState[i] == cUsed)
+				{
+					mOldArray[i].~value_type();
+					mOldSize--;
+				}
+			}
+			freeSlots(mOldArray, mOldState);
+			mOldArray = 0;
+			mOldState = 0;
+		}
+		mOldHashCache.release();
+		mOldAllocated = 0;
+		mOldMagic = 0;
+		mOldSize = 0;
+		mMigrated = 0;
+	}
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	// Probing increment
+	enum { cIncBy = 7 };
+
+	// Keys hashed and prefetched ahead by find_batch()
+	enum { cBatchSize = 16 };
+
+	// Partitions of neighbouring slots build() sorts the elements into
+	enum { cBuildPartitions = 1024 };
+
+	// Old arrays smaller than this are rehashed on the calling thread
+	// by default, see setWorkerPool()
+	enum { cParallelRehashMin = 1 << 16 };
+
+	// Tasks a parallel rehash or traversal is split into per thread, to
+	// even out the load
+	enum { cTasksPerThread = 4 };
+
+	// Slot states, see mState
+	enum { cEmpty = 0, cUsed = 1, cDeleted = 2 };
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	// The hash table iteself
+	Array	mArray;
+	unsigned char* mState; // One state byte per slot in mArray (cEmpty/cUsed/cDeleted)
+	size_t	mAllocated; // The actual size of the array
+	size_t	mMagic; // mGrower.getMagic(mAllocated), so lookups don't work it out
+	size_t	mFreeSlots; // Number of free (empty) slots in the array, tombstones not included
+	size_t	mDeleted; // Number of tombstones in the array
+	size_t	mSize;	// Number of elements stored in the hash table (incl. sub collections)
+
+	MyGrower mGrower;
+	MyHashCache mHashCache; // Hash values of the keys in mArray, if cached
+
+	// The array being moved from during an incremental rehash, see above.
+	// mOldArray is 0 when there's none.
+	Array	mOldArray;
+	unsigned char* mOldState;
+	MyHashCache mOldHashCache;
+	size_t	mOldAllocated;
+	size_t	mOldMagic;
+	size_t	mOldSize; // Number of elements left in the old array
+	size_t	mMigrated; // Old slots before this one have been moved
+	size_t	mIncrementalStep; // Old slots to move per operation, 0 if not incremental
+
+	WorkerPool* mWorkerPool; // Rehashes on it if not 0, see above
+	size_t	mParallelRehashMin; // Smallest old array rehashed on mWorkerPool
+
+	// See stats()
+	size_t	mRehashes;
+	double	mRehashSeconds;
+	HashTableCounters mCounters;
+};
+
+#endif // !defined(HASHTABLEPROBED_H)
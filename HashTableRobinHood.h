@@ -0,0 +1,559 @@
+/*=====================================================================
+	HashTableRobinHood.h - Robin Hood hashing table template class
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		// The hash table
+		template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower,
+		  >
+		class HashTableRobinHood
+		{
+			class iterator
+			class const_iterator
+
+			// Used as a proxy when operator[] is called
+			class Access
+		}
+
+  Requirements:
+		A Hasher must be implemented if the generic ones isn't applicable,
+		it needs the full width () operator (see GenericHashers.h).
+		Caller needs to #inlude default Grower/Hasher if they are to be used.
+
+  Dependencies:
+		No external dependencies
+
+  Robin Hood hashing:
+		Linear probing where each slot also stores its element's probe 
+		distance, ie how far it is from the slot it hashed to. An insert 
+		that meets an element closer to home than itself takes that slot
+		and continues with the displaced element instead. That keeps the
+		probe distances even, also at the high load the DefaultGrower 
+		allows. A lookup can stop as soon as its own distance exceeds the 
+		distance of the slot it looks at, and erase shifts the following 
+		elements one step back instead of leaving a tombstone.
+
+=====================================================================*/
+#if !defined(HASHTABLEROBINHOOD_H)
+#define HASHTABLEROBINHOOD_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <map>
+#include <new> // placement new
+#include <string.h> // memset
+#include <algorithm> // std::swap
+
+//------------------------------------------------------------------------
+// HashTableRobinHood
+// A generic hash collection, requires that the Hasher
+// has been implemented somwehere for the apropriate Key type.
+// Like HashTableProbed it holds the <Key, Value> pairs in one array, 
+// collisions are handled by Robin Hood hashing, see above.
+// class Key
+//   The, well, key type
+// class Value:
+//   The value type
+// class MyHasher:
+//   A class (function object) that will be called when computing the...well...hash value.
+//   Substitute with your own if the generic hashers aren't good enough/applicable
+// class MyGrower:
+//   A class used to determine what size the array should grow to
+template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower
+		  >
+class HashTableRobinHood
+{
+public:
+	//------------------------------------------------------------------
+	// Public Type Definitions
+	//------------------------------------------------------------------
+	typedef std::pair<Key, Value> value_type;
+
+	//------------------------------------------------------------------
+	// Public Classes
+	//------------------------------------------------------------------
+	// class iterator
+	class iterator
+	{
+	public:
+		iterator(HashTableRobinHood& ht, size_t index):mHT(ht), mIndex(index)
+		{
+			if (index<mHT.getAllocated() && mHT.getElement(index)==0)
+			{
+				++(*this);
+			}
+		}
+
+		bool operator == (const iterator& src) const
+		{
+			return mHT == src.mHT && mIndex == src.mIndex;
+		}
+
+		bool operator != (const iterator& src) const
+		{
+			return !(*this == src);
+		}
+
+		value_type& operator*()
+		{
+			return *mHT.getElement(mIndex);
+		}
+
+		size_t getIndex() const { return mIndex; }
+
+		iterator& operator ++ ()
+		{
+			mIndex++;
+			while (mIndex<mHT.getAllocated() && mHT.getElement(mIndex)==0)
+			{
+				mIndex++;
+			}
+			return (*this);
+		}
+
+	private:
+		HashTableRobinHood& mHT;
+		size_t mIndex;
+	};
+	// class const_iterator
+	class const_iterator
+	{
+	public:
+		const_iterator(const HashTableRobinHood& ht, size_t index):mHT(ht), mIndex(index)
+		{
+			if (index<mHT.getAllocated() && mHT.getElement(index)==0)
+			{
+				++(*this);
+			}
+		}
+
+		bool operator == (const const_iterator& src) const
+		{
+			return mHT == src.mHT && mIndex == src.mIndex;
+		}
+
+		bool operator != (const const_iterator& src) const
+		{
+			return !(*this == src);
+		}
+
+		const value_type& operator*() const
+		{
+			return *mHT.getElement(mIndex);
+		}
+
+		size_t getIndex() const { return mIndex; }
+
+		const_iterator& operator ++ ()
+		{
+			mIndex++;
+			while (mIndex<mHT.getAllocated() && mHT.getElement(mIndex)==0)
+			{
+				mIndex++;
+			}
+			return (*this);
+		}
+
+	private:
+		const HashTableRobinHood& mHT;
+		size_t mIndex;
+	};
+
+	// Used as a proxy when operator[] is called
+	// Handles theHash["foo"] = 42 and i = theHash["Foo"] differently.
+	class Access
+	{
+	public:
+		Access(HashTableRobinHood& ht, const Key& key):mHash(ht),mKey(key){}
+
+		// Assignment operator. Handles the myHash["Foo"] = 32; situation
+		void operator=(const Value& value)
+		{
+			// Just use the Set method, it handles already exist/not exist situation
+			mHash.set(mKey,value);
+		}
+
+		// ValueType operator
+		operator Value()
+		{
+			HashTableRobinHood::iterator i = mHash.find(mKey);
+
+			// Not found
+			if (i==mHash.end())
+			{
+				throw "Item not found";
+			}
+
+			return (*i).second;
+		}
+	private:
+		//------------------------------
+		// Disabled Methods
+		//------------------------------
+		// Default constructor
+		Access();
+
+		//------------------------------
+		// Private Members
+		//------------------------------
+		HashTableRobinHood& mHash;
+		const Key& mKey;
+	}; // Access
+
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	// Default constructor
+	explicit HashTableRobinHood(size_t initialSize=1000) // Might be adjusted upwards
+	{
+		init(initialSize);
+	}
+
+	// Destructor
+	virtual ~HashTableRobinHood()
+	{
+		release();
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+
+	// Find a const_iterator, returns end() if not found.
+	const_iterator find(const Key& key) const
+	{
+		return const_iterator(*this, findIndex(key));
+	}
+
+	// Find a non-const iterator, returns end() if not found.
+	iterator find(const Key& key)
+	{
+		return iterator(*this, findIndex(key));
+	}
+
+	size_t size() const { return mSize; }
+
+	// Returns 0 if the slot isn't used
+	value_type* getElement(size_t index) { return mDistance[index] != 0 ? &mArray[index] : 0; }
+	const value_type* getElement(size_t index) const { return mDistance[index] != 0 ? &mArray[index] : 0; }
+	size_t getAllocated() const { return mAllocated; }
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+
+	void set(const Key& key, const Value& value)
+	{
+		iterator i = find(key);
+		if (i == end())
+		{
+			if (!insert(key, value))
+				throw "Failed to insert";
+		}
+		else
+		{
+			(*i).second = value;
+		}
+
+	}
+
+	// insert - returns false if no insertion took place, ie key already stored
+	bool insert(const value_type& vt)
+	{
+		return insert(vt.first, vt.second);
+	}
+
+	// insert - returns false if no insertion took place, ie key already stored
+	bool insert(const Key& key, const Value& value)
+	{
+		if (findIndex(key) != mAllocated)
+			return false;
+
+		size_t newAlloc = mGrower.getNewSize(mAllocated, mAllocated - mSize);
+		if (newAlloc > mAllocated)
+		{
+			rehash(newAlloc);
+		}
+
+		value_type element(key, value);
+		if (!place(element, mArray, mDistance, mAllocated, mMagic))
+			throw "Probe distance overflow";
+		mSize++;
+		return true;
+	}
+
+	size_t erase(const Key& key)
+	{
+		size_t index = findIndex(key);
+
+		if (index == mAllocated)
+			return 0;
+
+		mArray[index].~value_type();
+
+		// Backward shift: Move the following elements one step closer to 
+		// home, until an empty slot or an element already at home is found.
+		size_t next = nextIndex(index);
+		while (mDistance[next] > 1)
+		{
+			new (&mArray[index]) value_type(mArray[next]);
+			mArray[next].~value_type();
+			mDistance[index] = static_cast<Distance>(mDistance[next] - 1);
+
+			index = next;
+			next = nextIndex(next);
+		}
+		mDistance[index] = 0;
+		mSize--;
+		return 1;
+	}
+
+	// Removes all elements, leaving the smallest array the grower hands
+	// out
+	void clear()
+	{
+		release();
+		init(0);
+	}
+	//------------------------------------------------------------------
+	// Public Operators
+	//------------------------------------------------------------------
+	Access operator[](const Key& key)
+	{
+		return Access(*this, key);
+	}
+
+	bool operator == (const HashTableRobinHood& src) const
+	{
+		return mArray == src.mArray;
+	}
+
+	//------------------------------------------------------------------
+	// Public Iterators
+	//------------------------------------------------------------------
+	iterator		begin() { return iterator(*this, 0); }
+	const_iterator	begin() const { return const_iterator(*this, 0); }
+	iterator		end() { return iterator(*this, mAllocated); }
+	const_iterator	end() const { return const_iterator(*this, mAllocated); }
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+    // Copy constructor
+	explicit HashTableRobinHood(const HashTableRobinHood&);
+
+	// Assignment operator
+	HashTableRobinHood operator = (const HashTableRobinHood&);
+
+	//------------------------------------------------------------------
+	// Private Type Definitions
+	//------------------------------------------------------------------
+	typedef value_type*	 Array; // == array of value_type slots (raw memory, see mDistance)
+
+	// Probe distance + 1 of the element in a slot, 0 for an empty slot.
+	typedef unsigned short Distance;
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	enum { cMaxDistance = 0xFFFF };
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	// The grower knows how to map a key to a slot for the array sizes it 
+	// hands out, magic is what it worked out for allocated in advance
+	size_t hash(const Key& key, size_t allocated, size_t magic) const
+	{
+		MyHasher hasher;
+		return mGrower.getIndex(hasher, key, allocated, magic);
+	}
+
+	size_t nextIndex(size_t index) const
+	{
+		return index + 1 == mAllocated ? 0 : index + 1;
+	}
+
+	// Returns the slot index of key, or mAllocated if not found
+	size_t findIndex(const Key& key) const
+	{
+		size_t index = hash(key, mAllocated, mMagic);
+		Distance distance = 1;
+
+		// Any element further down the sequence would have taken this 
+		// slot, so stop when we're further from home than its element. 
+		// An empty slot has distance 0 and ends the lookup as well.
+		while (distance <= mDistance[index])
+		{
+			if (mDistance[index] == distance && mArray[index].first == key)
+			{
+				return index;
+			}
+			index = nextIndex(index);
+			distance++;
+		}
+		return mAllocated;
+	}
+
+	// Robin Hood insert of an element not in the array. element is used
+	// as scratch for the displaced elements. Returns false, with nothing
+	// changed, if some element would end up further than cMaxDistance
+	// from home.
+	bool place(value_type& element, Array array, Distance* distances, size_t allocated, size_t magic) const
+	{
+		size_t home = hash(element.first, allocated, magic);
+
+		// A dry run on the distances first, as an overflow found half way
+		// would leave a displaced element with nowhere to go
+		size_t index = home;
+		Distance distance = 1;
+		while (distances[index] != 0)
+		{
+			if (distances[index] < distance)
+				distance = distances[index];
+
+			if (++index == allocated)
+				index = 0;
+			if (distance++ == cMaxDistance)
+				return false;
+		}
+
+		index = home;
+		distance = 1;
+		while (distances[index] != 0)
+		{
+			// Take from the rich (close to home) and give to the poor
+			if (distances[index] < distance)
+			{
+				std::swap(element, array[index]);
+				std::swap(distance, distances[index]);
+			}
+
+			if (++index == allocated)
+				index = 0;
+			distance++;
+		}
+
+		new (&array[index]) value_type(element);
+		distances[index] = distance;
+		return true;
+	}
+
+	// Shared by the constructor and clear()
+	void init(size_t initialSize)
+	{
+		mAllocated = mGrower.getPrimeGreaterThan(initialSize);
+		mMagic = mGrower.getMagic(mAllocated);
+		mArray = allocateSlots(mAllocated);
+		mDistance = allocateDistances(mAllocated);
+		mSize=0;
+	}
+
+	// Free the array, destroying the elements, the table is unusable until
+	// init() is called
+	void release()
+	{
+		if (mArray != 0)
+		{
+			destroySlots(mArray, mDistance, mAllocated);
+			mArray = 0;
+			mDistance = 0;
+		}
+		mAllocated=0;
+		mMagic=0;
+		mSize=0;
+	}
+
+	// The slots are raw memory, elements are constructed in place when
+	// inserted and destroyed when erased.
+	static Array allocateSlots(size_t count)
+	{
+		return static_cast<Array>(::operator new(sizeof(value_type)*count));
+	}
+
+	static Distance* allocateDistances(size_t count)
+	{
+		Distance* distances = new Distance[count];
+		memset(distances, 0, sizeof(distances[0])*count);
+		return distances;
+	}
+
+	static void freeSlots(Array slots, Distance* distances)
+	{
+		::operator delete(slots);
+		delete [] distances;
+	}
+
+	// Destroys the elements, then frees the arrays
+	static void destroySlots(Array slots, Distance* distances, size_t count)
+	{
+		for (size_t i=0;i<count;++i)
+		{
+			if (distances[i] != 0)
+				slots[i].~value_type();
+		}
+		freeSlots(slots, distances);
+	}
+
+	// Create a new, bigger, array. The elements are copied, and the old
+	// array only freed once they're all in, so that the table is left as
+	// it was if placing one fails.
+	void rehash(size_t newAlloc)
+	{
+		Array newArray = allocateSlots(newAlloc);
+		Distance* newDistance = allocateDistances(newAlloc);
+		size_t newMagic = mGrower.getMagic(newAlloc);
+
+		try
+		{
+			for (size_t i=0; i<mAllocated; ++i)
+			{
+				if(mDistance[i] != 0)
+				{
+					value_type element(mArray[i]);
+					if (!place(element, newArray, newDistance, newAlloc, newMagic))
+						throw "Probe distance overflow";
+				}
+			}
+		}
+		catch (...)
+		{
+			destroySlots(newArray, newDistance, newAlloc);
+			throw;
+		}
+
+		destroySlots(mArray, mDistance, mAllocated);
+		mArray = newArray;
+		mDistance = newDistance;
+		mAllocated = newAlloc;
+		mMagic = newMagic;
+	}
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	// The hash table iteself
+	Array	mArray;
+	Distance* mDistance; // Probe distance + 1 per slot in mArray, 0 if empty
+	size_t	mAllocated; // The actual size of the array
+	size_t	mMagic; // mGrower.getMagic(mAllocated), so lookups don't work it out
+	size_t	mSize;	// Number of elements stored in the hash table
+
+	MyGrower mGrower;
+
+};
+
+#endif // !defined(HASHTABLEROBINHOOD_H)
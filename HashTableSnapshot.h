@@ -0,0 +1,381 @@
+/*=====================================================================
+	HashTableSnapshot.h - Memory mapped, read only, hash table image
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower
+		  >
+		class HashTableSnapshot
+
+  Requirements:
+		Key and Value must be plain data, ie copyable with memcpy and
+		without pointers, as they're written to the file byte for byte.
+		A Hasher must be implemented if the generic ones isn't applicable,
+		with the full width () operator, ie without a size.
+		Caller needs to #inlude default Grower/Hasher if they are to be used.
+
+  Dependencies:
+		MappedFile.h
+		To std::vector for save()
+
+  File format:
+		A Header, the slot states (a byte each) and the slots (a value_type
+		each), the latter two at offsets given in the header and aligned to
+		cAlignment. There are no pointers, so the file works wherever it's
+		mapped. The slots are laid out like an open addressed table of
+		the grower's size for twice the elements, with the same probe
+		sequence as HashTableProbed, so a lookup reads the states and slots
+		on its probe sequence straight from the mapping. The header records
+		what the layout depends on (format version, byte order, the sizes
+		of size_t and the elements, a hasher id given to save()) plus the
+		full hash of one stored key. open_mapped() checks them all, and
+		rehashes that key to catch a file written with a different hasher.
+
+=====================================================================*/
+#if !defined(HASHTABLESNAPSHOT_H)
+#define HASHTABLESNAPSHOT_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <stdio.h>
+#include <string.h> // memcmp, memcpy
+#include <map> // std::pair
+#include <vector>
+
+#include "MappedFile.h"
+
+//------------------------------------------------------------------------
+// HashTableSnapshot
+// save() writes the elements of a table to a file, which open_mapped()
+// maps and serves lookups from without reading it all in. Nothing is
+// copied at open, so the first lookups touching a page wait for it to
+// be read from disk (or the page cache).
+// class Key
+//   The key type
+// class Value:
+//   The value type
+// class MyHasher:
+//   A class (function object) that will be called when computing the...well...hash value.
+//   Must be the same when the file is opened as when it was saved.
+// class MyGrower:
+//   A class used to determine the number of slots, and to map a hash
+//   value to a slot. Must also be the same.
+template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower
+		  >
+class HashTableSnapshot
+{
+public:
+	//------------------------------------------------------------------
+	// Public Type Definitions
+	//------------------------------------------------------------------
+	typedef std::pair<Key, Value> value_type;
+
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	// Default constructor, nothing is open
+	HashTableSnapshot():mHeader(0), mStates(0), mElements(0), mGrowerMagic(0) {}
+
+	// Opens path, see open_mapped()
+	explicit HashTableSnapshot(const char* path):mHeader(0), mStates(0), mElements(0), mGrowerMagic(0)
+	{
+		open_mapped(path);
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+	// The element with key, 0 if not found. Points into the mapping, so
+	// it's valid until the snapshot is closed.
+	const value_type* find(const Key& key) const
+	{
+		if (mHeader == 0)
+			return 0;
+
+		size_t allocated = getAllocated();
+		MyHasher hasher;
+		size_t start = mGrower.getIndexFromHash(hasher(key), allocated, mGrowerMagic);
+		size_t index = start;
+		do
+		{
+			if (mStates[index] == cEmpty)
+				return 0;
+			if (mElements[index].first == key)
+				return &mElements[index];
+
+			index += cIncBy;
+			while (index >= allocated)
+				index -= allocated;
+		} while (index != start);
+
+		return 0;
+	}
+
+	// Copies the value with key, if any, to value
+	bool find(const Key& key, Value& value) const
+	{
+		const value_type* vt = find(key);
+		if (vt == 0)
+			return false;
+
+		value = vt->second;
+		return true;
+	}
+
+	bool contains(const Key& key) const
+	{
+		return find(key) != 0;
+	}
+
+	// Calls visitor(const value_type&) for each element, in slot order.
+	// Returns visitor, like std::for_each.
+	template <class Visitor>
+	Visitor for_each(Visitor visitor) const
+	{
+		size_t allocated = getAllocated();
+		for (size_t i=0;i<allocated;++i)
+		{
+			if (mStates[i] == cUsed)
+				visitor(mElements[i]);
+		}
+		return visitor;
+	}
+
+	bool isOpen() const { return mHeader != 0; }
+
+	size_t size() const { return mHeader != 0 ? static_cast<size_t>(mHeader->size) : 0; }
+
+	size_t getAllocated() const { return mHeader != 0 ? static_cast<size_t>(mHeader->allocated) : 0; }
+
+	// The id given to save()
+	unsigned int getHasherId() const { return mHeader != 0 ? mHeader->hasherId : 0; }
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+	// Maps the file save() wrote to path, after closing what was open.
+	// Throws if it's not a snapshot of this Key/Value/MyHasher, or was
+	// saved with another hasherId. The file must not be changed, or saved
+	// over, while it's open.
+	void open_mapped(const char* path, unsigned int hasherId=0)
+	{
+		close();
+		mFile.open(path);
+
+		const char* data = mFile.getData();
+		size_t fileSize = mFile.getSize();
+		const Header* header = reinterpret_cast<const Header*>(data);
+		if (fileSize < sizeof(Header) || memcmp(header->magic, getMagic(), sizeof(header->magic)) != 0)
+		{
+			close();
+			throw "Not a hash table snapshot";
+		}
+
+		if (header->version != cVersion || header->byteOrder != cByteOrder || header->sizeOfSize != sizeof(size_t) ||
+			header->keySize != sizeof(Key) || header->valueSize != sizeof(Value) || header->elementSize != sizeof(value_type))
+		{
+			close();
+			throw "Incompatible hash table snapshot";
+		}
+
+		unsigned long long allocated = header->allocated;
+		if (header->fileSize != fileSize || allocated == 0 || header->size >= allocated ||
+			header->statesOffset + allocated > fileSize || header->elementsOffset % cAlignment != 0 ||
+			header->elementsOffset + allocated*sizeof(value_type) > fileSize)
+		{
+			close();
+			throw "Corrupt hash table snapshot";
+		}
+
+		mHeader = header;
+		mGrowerMagic = mGrower.getMagic(size_t(allocated));
+		mStates = reinterpret_cast<const unsigned char*>(data + header->statesOffset);
+		mElements = reinterpret_cast<const value_type*>(data + header->elementsOffset);
+
+		if (header->hasherId != hasherId || (header->checkSlot < allocated && hash(mElements[header->checkSlot].first) != header->checkHash))
+		{
+			close();
+			throw "Hash table snapshot made with another hasher";
+		}
+	}
+
+	void close()
+	{
+		mFile.close();
+		mHeader = 0;
+		mStates = 0;
+		mElements = 0;
+		mGrowerMagic = 0;
+	}
+
+	// Writes the elements of table, eg a HashTableProbed, to path. Table
+	// needs size() and a const_iterator over std::pair<Key, Value>-ish
+	// elements. hasherId is stored and must be given again to open the
+	// file, eg to tell apart differently seeded hashers.
+	template <class Table>
+	static void save(const Table& table, const char* path, unsigned int hasherId=0)
+	{
+		MyGrower grower;
+		size_t size = table.size();
+		size_t allocated = grower.getPrimeGreaterThan(2*size);
+		size_t magic = grower.getMagic(allocated);
+
+		Header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, getMagic(), sizeof(header.magic));
+		header.version = cVersion;
+		header.byteOrder = cByteOrder;
+		header.sizeOfSize = sizeof(size_t);
+		header.hasherId = hasherId;
+		header.keySize = sizeof(Key);
+		header.valueSize = sizeof(Value);
+		header.elementSize = sizeof(value_type);
+		header.size = size;
+		header.allocated = allocated;
+		header.statesOffset = align(sizeof(Header));
+		header.elementsOffset = align(header.statesOffset + allocated);
+		header.fileSize = header.elementsOffset + (unsigned long long)allocated*sizeof(value_type);
+		header.checkSlot = allocated;
+
+		// The layout is built in memory, zeroed so that the unused slots
+		// and any padding in value_type are written as zeroes
+		std::vector<unsigned char> states(allocated, (unsigned char)cEmpty);
+		std::vector<char> elements(allocated*sizeof(value_type), 0);
+		size_t count = 0;
+		for (typename Table::const_iterator it=table.begin();it!=table.end();++it)
+		{
+			if (++count > size)
+				throw "Table changed while saving";
+
+			size_t hashValue = hash((*it).first);
+			size_t index = grower.getIndexFromHash(hashValue, allocated, magic);
+			while (states[index] != cEmpty)
+			{
+				index += cIncBy;
+				while (index >= allocated)
+					index -= allocated;
+			}
+
+			states[index] = cUsed;
+			value_type* element = reinterpret_cast<value_type*>(&elements[index*sizeof(value_type)]);
+			element->first = (*it).first;
+			element->second = (*it).second;
+
+			if (header.checkSlot == allocated)
+			{
+				header.checkSlot = index;
+				header.checkHash = hashValue;
+			}
+		}
+		if (count != size)
+			throw "Table changed while saving";
+
+		FILE* file = fopen(path, "wb");
+		if (file == 0)
+			throw "Failed to create file";
+
+		std::vector<char> padding(cAlignment, 0);
+		bool written =
+			fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(&padding[0], 1, size_t(header.statesOffset - sizeof(header)), file) == size_t(header.statesOffset - sizeof(header)) &&
+			fwrite(&states[0], 1, allocated, file) == allocated &&
+			fwrite(&padding[0], 1, size_t(header.elementsOffset - header.statesOffset - allocated), file) == size_t(header.elementsOffset - header.statesOffset - allocated) &&
+			fwrite(&elements[0], sizeof(value_type), allocated, file) == allocated;
+		if (fclose(file) != 0 || !written)
+		{
+			remove(path);
+			throw "Failed to write file";
+		}
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	HashTableSnapshot(const HashTableSnapshot&);
+
+	// Assignment operator
+	HashTableSnapshot& operator = (const HashTableSnapshot&);
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	enum { cVersion = 1 };
+
+	// Written as is, so it reads differently on a machine of the other
+	// byte order
+	enum { cByteOrder = 0x01020304 };
+
+	// Of the states and the slots, within the file and hence in memory
+	enum { cAlignment = 64 };
+
+	enum { cEmpty = 0, cUsed = 1 };
+
+	// Same as HashTableProbed's
+	enum { cIncBy = 7 };
+
+	//------------------------------------------------------------------
+	// Private Classes
+	//------------------------------------------------------------------
+	// The start of the file. Fixed size fields only, offsets are from the
+	// start of the file.
+	struct Header
+	{
+		char magic[8];
+		unsigned int version;
+		unsigned int byteOrder;
+		unsigned int sizeOfSize;
+		unsigned int hasherId;
+		unsigned long long keySize;
+		unsigned long long valueSize;
+		unsigned long long elementSize;
+		unsigned long long size;			// Elements
+		unsigned long long allocated;		// Slots
+		unsigned long long statesOffset;
+		unsigned long long elementsOffset;
+		unsigned long long fileSize;
+		unsigned long long checkSlot;		// A used slot, allocated if none
+		unsigned long long checkHash;		// The full hash of its key
+	};
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	static const char* getMagic() { return "HASHSNAP"; }
+
+	static unsigned long long align(unsigned long long offset)
+	{
+		return (offset + cAlignment - 1) / cAlignment * cAlignment;
+	}
+
+	static size_t hash(const Key& key)
+	{
+		MyHasher hasher;
+		return hasher(key);
+	}
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	MappedFile mFile;
+	const Header* mHeader;				// 0 when nothing is open
+	const unsigned char* mStates;		// In the mapping
+	const value_type* mElements;		// In the mapping
+	MyGrower mGrower;
+	size_t mGrowerMagic;				// mGrower.getMagic() of the open file
+};
+
+#endif // !defined(HASHTABLESNAPSHOT_H)
@@ -0,0 +1,233 @@
+/*=====================================================================
+	HashTableStats.h - Statistics of how a hash table is laid out and used
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		// What HashTableProbed/HashTableChained::stats() returns
+		struct HashTableStats
+
+		// Hot path counters, empty unless HASHTABLE_STATS is defined
+		class HashTableCounters
+
+		// Times the rehashes
+		class StatsTimer
+
+  Requirements:
+		None, C++11 (<atomic>) if HASHTABLE_STATS is defined.
+
+  Dependencies:
+		To std::vector for the histogram
+		QueryPerformanceCounter() on Windows, clock_gettime() elsewhere
+
+  Layout:
+		stats() goes through the whole table, it costs about as much as
+		looking up every element once. The histogram shows how far the
+		elements are from where their hash value put them, a good Hasher
+		and Grower pair keeps it short and steep. A long tail, or a
+		maximum far above the mean, means that many keys share slots, eg
+		keys that are multiples of the table size with Hasher<int>, which
+		maps a key to itself.
+
+  Rehashes:
+		Always counted and timed, from when the new array is allocated
+		until the elements are moved, or, rehashing
+		incrementally, the allocation and whatever is moved all at once in
+		the end. The few elements each operation moves on the way aren't,
+		so that they don't pay for two clock reads.
+
+  Hot path counters:
+		With HASHTABLE_STATS defined before the tables are #included, every
+		probe sequence (HashTableProbed) or bucket (HashTableChained) that
+		find, insert and erase search is counted, together with the slots
+		or elements it holds. The counters are atomic, as a table may be
+		read from several threads at once, eg in a ConcurrentHashTable,
+		so they cost a locked add per operation. Without it they compile
+		to nothing.
+
+=====================================================================*/
+#if !defined(HASHTABLESTATS_H)
+#define HASHTABLESTATS_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <stddef.h> // size_t
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h> // QueryPerformanceCounter
+#else
+#include <time.h> // clock_gettime
+#endif
+
+#if defined(HASHTABLE_STATS)
+#include <atomic>
+#endif
+
+//------------------------------------------------------------------------
+// HashTableStats
+// A picture of a table, taken by its stats() method. The old array of an
+// incremental rehash is included, as if it was part of the new one.
+struct HashTableStats
+{
+	HashTableStats():size(0), allocated(0), empty(0), tombstones(0), rehashes(0), rehashSeconds(0), bytes(0), lookups(0), lookupSteps(0) {}
+
+	size_t size;		// Elements
+	size_t allocated;	// Slots (HashTableProbed) or buckets (HashTableChained)
+	size_t empty;		// Slots or buckets holding nothing, not even a tombstone
+	size_t tombstones;	// Erased slots, always 0 for HashTableChained
+
+	// HashTableProbed: histogram[n] is the number of elements on the n:th
+	// slot of their probe sequence, so [0] is 0 and [1] the ones in the
+	// slot their hash value points at.
+	// HashTableChained: histogram[n] is the number of buckets holding n
+	// elements, [0] is the same as empty.
+	std::vector<size_t> histogram;
+
+	size_t rehashes;		// Since the table was created, or resetStats()
+	double rehashSeconds;	// Spent in them, see above
+
+	// Approximate, the table's own arrays and buckets. What the keys and
+	// values allocate themselves isn't counted.
+	size_t bytes;
+
+	// Hot path counters, 0 unless HASHTABLE_STATS is defined, see above.
+	// lookups is the probe sequences or buckets searched, lookupSteps the
+	// slots or elements in them.
+	unsigned long long lookups;
+	unsigned long long lookupSteps;
+
+	// empty / allocated
+	double getEmptyRatio() const
+	{
+		return allocated > 0 ? double(empty) / allocated : 0;
+	}
+
+	// The mean of the histogram, leaving out [0]. The probe length of an
+	// average element, or the size of an average bucket in use.
+	double getMeanLength() const
+	{
+		size_t count = 0;
+		double sum = 0;
+		for (size_t n=1;n<histogram.size();++n)
+		{
+			count += histogram[n];
+			sum += double(n)*histogram[n];
+		}
+		return count > 0 ? sum / count : 0;
+	}
+
+	// The longest probe length, or the biggest bucket
+	size_t getMaxLength() const
+	{
+		return histogram.empty() ? 0 : histogram.size() - 1;
+	}
+
+	// lookupSteps / lookups
+	double getMeanLookupLength() const
+	{
+		return lookups > 0 ? double(lookupSteps) / lookups : 0;
+	}
+
+	// Counts one more of length n in the histogram
+	void addLength(size_t n)
+	{
+		if (n >= histogram.size())
+			histogram.resize(n + 1, 0);
+		histogram[n]++;
+	}
+};
+
+//------------------------------------------------------------------------
+// HashTableCounters
+// The hot path counters of a table. countLookup() is const, it's called
+// from const lookups, possibly on several threads at once.
+#if defined(HASHTABLE_STATS)
+class HashTableCounters
+{
+public:
+	HashTableCounters():mLookups(0), mLookupSteps(0) {}
+
+	void countLookup(size_t steps) const
+	{
+		mLookups.fetch_add(1, std::memory_order_relaxed);
+		mLookupSteps.fetch_add(steps, std::memory_order_relaxed);
+	}
+
+	void get(HashTableStats& stats) const
+	{
+		stats.lookups = mLookups.load(std::memory_order_relaxed);
+		stats.lookupSteps = mLookupSteps.load(std::memory_order_relaxed);
+	}
+
+	void reset()
+	{
+		mLookups.store(0, std::memory_order_relaxed);
+		mLookupSteps.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	HashTableCounters(const HashTableCounters&);
+	HashTableCounters& operator = (const HashTableCounters&);
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	mutable std::atomic<unsigned long long> mLookups;
+	mutable std::atomic<unsigned long long> mLookupSteps;
+};
+#else
+// Does nothing, the compiler drops the calls and what they'd count
+class HashTableCounters
+{
+public:
+	void countLookup(size_t /*steps*/) const {}
+	void get(HashTableStats& /*stats*/) const {}
+	void reset() {}
+};
+#endif
+
+//------------------------------------------------------------------------
+// StatsTimer
+// Adds the seconds since it was created, from a monotonic clock, to a
+// total. The system's own, as C++98 has none.
+class StatsTimer
+{
+public:
+	StatsTimer():mStart(now()) {}
+
+	void addTo(double& seconds) const
+	{
+		seconds += now() - mStart;
+	}
+
+private:
+	// Seconds since some fixed point in the past
+	static double now()
+	{
+#if defined(_WIN32)
+		LARGE_INTEGER counter, frequency;
+		QueryPerformanceCounter(&counter);
+		QueryPerformanceFrequency(&frequency);
+		return double(counter.QuadPart) / double(frequency.QuadPart);
+#else
+		timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return double(time.tv_sec) + double(time.tv_nsec)*1e-9;
+#endif
+	}
+
+	double mStart;
+};
+
+#endif // !defined(HASHTABLESTATS_H)
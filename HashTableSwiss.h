@@ -0,0 +1,637 @@
+/*=====================================================================
+	HashTableSwiss.h - Probing hash table with SIMD group matching
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		// The hash table
+		template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower,
+		  >
+		class HashTableSwiss
+		{
+			class iterator
+			class const_iterator
+
+			// Used as a proxy when operator[] is called
+			class Access
+		}
+
+  Requirements:
+		A Hasher must be implemented if the generic ones isn't applicable,
+		it needs the full width () operator (see GenericHashers.h).
+		Caller needs to #inlude default Grower/Hasher if they are to be used.
+
+  Dependencies:
+		HashMix.h
+		<emmintrin.h> when compiled for SSE2, a portable fallback is used
+		otherwise.
+
+  Layout:
+		Same idea as the "Swiss tables": The slots are split in groups of
+		16. Each slot has a control byte that either says empty, deleted or
+		holds 7 bits of the key's hash value. A lookup compares the 7 bits
+		with all 16 control bytes of a group at once, and only compares
+		keys for the (few) slots that match. A group with an empty slot
+		ends the probe sequence.
+
+=====================================================================*/
+#if !defined(HASHTABLESWISS_H)
+#define HASHTABLESWISS_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <map>
+#include <new> // placement new
+#include <string.h> // memset
+
+#include "HashMix.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HASHTABLESWISS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h> // _BitScanForward
+#endif
+
+//------------------------------------------------------------------------
+// HashTableSwiss
+// A generic hash collection, requires that the Hasher
+// has been implemented somwehere for the apropriate Key type.
+// Like HashTableProbed it holds the <Key, Value> pairs in one array, but
+// collisions are handled by probing groups of 16 slots, see Layout above.
+// class Key
+//   The, well, key type
+// class Value:
+//   The value type
+// class MyHasher:
+//   A class (function object) that will be called when computing the...well...hash value.
+//   Substitute with your own if the generic hashers aren't good enough/applicable
+// class MyGrower:
+//   A class used to determine what size the array should grow to. The size
+//   it asks for is rounded up to a power of two number of groups.
+template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower
+		  >
+class HashTableSwiss
+{
+public:
+	//------------------------------------------------------------------
+	// Public Type Definitions
+	//------------------------------------------------------------------
+	typedef std::pair<Key, Value> value_type;
+
+	//------------------------------------------------------------------
+	// Public Classes
+	//------------------------------------------------------------------
+	// class iterator
+	class iterator
+	{
+	public:
+		iterator(HashTableSwiss& ht, size_t index):mHT(ht), mIndex(index)
+		{
+			if (index<mHT.getAllocated() && mHT.getElement(index)==0)
+			{
+				++(*this);
+			}
+		}
+
+		bool operator == (const iterator& src) const
+		{
+			return mHT == src.mHT && mIndex == src.mIndex;
+		}
+
+		bool operator != (const iterator& src) const
+		{
+			return !(*this == src);
+		}
+
+		value_type& operator*()
+		{
+			return *mHT.getElement(mIndex);
+		}
+
+		size_t getIndex() const { return mIndex; }
+
+		iterator& operator ++ ()
+		{
+			mIndex++;
+			while (mIndex<mHT.getAllocated() && mHT.getElement(mIndex)==0)
+			{
+				mIndex++;
+			}
+			return (*this);
+		}
+
+	private:
+		HashTableSwiss& mHT;
+		size_t mIndex;
+	};
+	// class const_iterator
+	class const_iterator
+	{
+	public:
+		const_iterator(const HashTableSwiss& ht, size_t index):mHT(ht), mIndex(index)
+		{
+			if (index<mHT.getAllocated() && mHT.getElement(index)==0)
+			{
+				++(*this);
+			}
+		}
+
+		bool operator == (const const_iterator& src) const
+		{
+			return mHT == src.mHT && mIndex == src.mIndex;
+		}
+
+		bool operator != (const const_iterator& src) const
+		{
+			return !(*this == src);
+		}
+
+		const value_type& operator*() const
+		{
+			return *mHT.getElement(mIndex);
+		}
+
+		size_t getIndex() const { return mIndex; }
+
+		const_iterator& operator ++ ()
+		{
+			mIndex++;
+			while (mIndex<mHT.getAllocated() && mHT.getElement(mIndex)==0)
+			{
+				mIndex++;
+			}
+			return (*this);
+		}
+
+	private:
+		const HashTableSwiss& mHT;
+		size_t mIndex;
+	};
+
+	// Used as a proxy when operator[] is called
+	// Handles theHash["foo"] = 42 and i = theHash["Foo"] differently.
+	class Access
+	{
+	public:
+		Access(HashTableSwiss& ht, const Key& key):mHash(ht),mKey(key){}
+
+		// Assignment operator. Handles the myHash["Foo"] = 32; situation
+		void operator=(const Value& value)
+		{
+			// Just use the Set method, it handles already exist/not exist situation
+			mHash.set(mKey,value);
+		}
+
+		// ValueType operator
+		operator Value()
+		{
+			HashTableSwiss::iterator i = mHash.find(mKey);
+
+			// Not found
+			if (i==mHash.end())
+			{
+				throw "Item not found";
+			}
+
+			return (*i).second;
+		}
+	private:
+		//------------------------------
+		// Disabled Methods
+		//------------------------------
+		// Default constructor
+		Access();
+
+		//------------------------------
+		// Private Members
+		//------------------------------
+		HashTableSwiss& mHash;
+		const Key& mKey;
+	}; // Access
+
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	// Default constructor
+	explicit HashTableSwiss(size_t initialSize=1000) // Might be adjusted upwards
+	{
+		init(initialSize);
+	}
+
+	// Destructor
+	virtual ~HashTableSwiss()
+	{
+		release();
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+
+	// Find a const_iterator, returns end() if not found.
+	const_iterator find(const Key& key) const
+	{
+		return const_iterator(*this, findIndex(key));
+	}
+
+	// Find a non-const iterator, returns end() if not found.
+	iterator find(const Key& key)
+	{
+		return iterator(*this, findIndex(key));
+	}
+
+	size_t size() const { return mSize; }
+
+	// Returns 0 if the slot isn't used
+	value_type* getElement(size_t index) { return isFull(mCtrl[index]) ? &mArray[index] : 0; }
+	const value_type* getElement(size_t index) const { return isFull(mCtrl[index]) ? &mArray[index] : 0; }
+	size_t getAllocated() const { return mAllocated; }
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+
+	void set(const Key& key, const Value& value)
+	{
+		iterator i = find(key);
+		if (i == end())
+		{
+			if (!insert(key, value))
+				throw "Failed to insert";
+		}
+		else
+		{
+			(*i).second = value;
+		}
+
+	}
+
+	// insert - returns false if no insertion took place, ie key already stored
+	bool insert(const value_type& vt)
+	{
+		return insert(vt.first, vt.second);
+	}
+
+	// insert - returns false if no insertion took place, ie key already stored
+	bool insert(const Key& key, const Value& value)
+	{
+		if (findIndex(key) != mAllocated)
+			return false;
+
+		size_t newAlloc = mGrower.getNewSize(mAllocated, mFreeSlots);
+		if (newAlloc > mAllocated)
+		{
+			// If getting rid of the tombstones frees enough slots there's
+			// no need to grow, just clean up
+			if (mGrower.getNewSize(mAllocated, mFreeSlots + mDeleted) <= mAllocated)
+				newAlloc = mAllocated;
+			rehash(groupAlign(newAlloc));
+		}
+
+		size_t hashValue = hash(key);
+		size_t index = findFreeSlot(mCtrl, mAllocated, hashValue);
+
+		if (mCtrl[index] == cDeleted)
+			mDeleted--;
+		else
+			mFreeSlots--;
+
+		// Construct the pair right in its slot
+		new (&mArray[index]) value_type(key, value);
+		mCtrl[index] = h2(hashValue);
+		mSize++;
+		return true;
+	}
+
+	size_t erase(const Key& key)
+	{
+		size_t index = findIndex(key);
+
+		if (index == mAllocated)
+			return 0;
+
+		mArray[index].~value_type();
+
+		// A probe sequence only moves past a group that has no empty slot.
+		// If this group has one, no sequence has passed it and the slot
+		// can be made empty. Otherwise it has to be a tombstone.
+		if (matchEmpty(mCtrl + (index & ~size_t(cGroupMask))) != 0)
+		{
+			mCtrl[index] = cEmpty;
+			mFreeSlots++;
+		}
+		else
+		{
+			mCtrl[index] = cDeleted;
+			mDeleted++;
+		}
+		mSize--;
+		return 1;
+	}
+
+	void clear()
+	{
+		release();
+		init(0);
+	}
+	//------------------------------------------------------------------
+	// Public Operators
+	//------------------------------------------------------------------
+	Access operator[](const Key& key)
+	{
+		return Access(*this, key);
+	}
+
+	bool operator == (const HashTableSwiss& src) const
+	{
+		return mArray == src.mArray;
+	}
+
+	//------------------------------------------------------------------
+	// Public Iterators
+	//------------------------------------------------------------------
+	iterator		begin() { return iterator(*this, 0); }
+	const_iterator	begin() const { return const_iterator(*this, 0); }
+	iterator		end() { return iterator(*this, mAllocated); }
+	const_iterator	end() const { return const_iterator(*this, mAllocated); }
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+    // Copy constructor
+	explicit HashTableSwiss(const HashTableSwiss&);
+
+	// Assignment operator
+	HashTableSwiss operator = (const HashTableSwiss&);
+
+	//------------------------------------------------------------------
+	// Private Type Definitions
+	//------------------------------------------------------------------
+	typedef value_type*	 Array; // == array of value_type slots (raw memory, see mCtrl)
+	typedef signed char	 Ctrl;  // Control byte, cEmpty, cDeleted or the 7 bit h2 of the hash
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	enum { cGroupSize = 16, cGroupMask = cGroupSize - 1 };
+
+	// Control bytes. A used slot holds 0..127, ie the sign bit is only
+	// set for empty and deleted slots.
+	enum { cEmpty = -128, cDeleted = -2 };
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	// Shared by the constructor and clear()
+	void init(size_t initialSize)
+	{
+		mAllocated = groupAlign(mGrower.getPrimeGreaterThan(initialSize));
+		mFreeSlots = mAllocated;
+		mDeleted = 0;
+		mArray = allocateSlots(mAllocated);
+		mCtrl = allocateCtrl(mAllocated);
+		mSize=0;
+	}
+
+	// Free the arrays, destroying the elements, the table is unusable
+	// until init() is called
+	void release()
+	{
+		if (mArray != 0)
+		{
+			for (size_t i=0;i<mAllocated;++i)
+			{
+				if (isFull(mCtrl[i]))
+					mArray[i].~value_type();
+			}
+
+			freeSlots(mArray, mCtrl);
+			mArray = 0;
+			mCtrl = 0;
+		}
+		mAllocated=0;
+		mFreeSlots=0;
+		mDeleted=0;
+		mSize=0;
+	}
+
+	// The full width hash value, mixed as both the low bits (h2) and the
+	// high ones (group index) are used.
+	size_t hash(const Key& key) const
+	{
+		MyHasher hasher;
+		return HashMix<sizeof(size_t)>::mix(hasher(key));
+	}
+
+	static size_t h1(size_t hashValue) { return hashValue >> 7; }
+	static Ctrl h2(size_t hashValue) { return static_cast<Ctrl>(hashValue & 0x7F); }
+	static bool isFull(Ctrl ctrl) { return ctrl >= 0; }
+
+	// Round size up to a power of two number of groups
+	static size_t groupAlign(size_t size)
+	{
+		size_t allocated = cGroupSize;
+		while (allocated < size)
+			allocated <<= 1;
+		return allocated;
+	}
+
+	// The group matching, bit i in the returned mask is set if control
+	// byte i in the group matches.
+#if defined(HASHTABLESWISS_SSE2)
+	static unsigned int match(const Ctrl* group, Ctrl h)
+	{
+		__m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+		return static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h))));
+	}
+
+	static unsigned int matchEmpty(const Ctrl* group)
+	{
+		return match(group, static_cast<Ctrl>(cEmpty));
+	}
+
+	// Empty or deleted, ie the sign bit is set
+	static unsigned int matchFree(const Ctrl* group)
+	{
+		__m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+		return static_cast<unsigned int>(_mm_movemask_epi8(ctrl));
+	}
+#else
+	static unsigned int match(const Ctrl* group, Ctrl h)
+	{
+		unsigned int mask = 0;
+		for (int i=0;i<cGroupSize;++i)
+		{
+			if (group[i] == h)
+				mask |= 1u << i;
+		}
+		return mask;
+	}
+
+	static unsigned int matchEmpty(const Ctrl* group)
+	{
+		return match(group, static_cast<Ctrl>(cEmpty));
+	}
+
+	static unsigned int matchFree(const Ctrl* group)
+	{
+		unsigned int mask = 0;
+		for (int i=0;i<cGroupSize;++i)
+		{
+			if (group[i] < 0)
+				mask |= 1u << i;
+		}
+		return mask;
+	}
+#endif
+
+	// Index of the lowest set bit, mask must not be 0
+	static size_t lowestBit(unsigned int mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#elif defined(__GNUC__)
+		return __builtin_ctz(mask);
+#else
+		size_t index = 0;
+		while ((mask & 1) == 0)
+		{
+			mask >>= 1;
+			index++;
+		}
+		return index;
+#endif
+	}
+
+	// Returns the slot index of key, or mAllocated if not found
+	size_t findIndex(const Key& key) const
+	{
+		size_t hashValue = hash(key);
+		Ctrl h = h2(hashValue);
+		size_t groupMask = (mAllocated / cGroupSize) - 1;
+		size_t group = h1(hashValue) & groupMask;
+
+		// Triangular probing visits every group once when the number of
+		// groups is a power of two
+		for (size_t step = 1; step <= groupMask + 1; ++step)
+		{
+			const Ctrl* ctrl = mCtrl + group * cGroupSize;
+			unsigned int candidates = match(ctrl, h);
+			while (candidates != 0)
+			{
+				size_t index = group * cGroupSize + lowestBit(candidates);
+				if (mArray[index].first == key)
+					return index;
+				candidates &= candidates - 1;
+			}
+
+			if (matchEmpty(ctrl) != 0)
+				break;
+
+			group = (group + step) & groupMask;
+		}
+		return mAllocated;
+	}
+
+	// Returns the index of the first empty or deleted slot in the probe
+	// sequence. There's always one since the grower keeps slots free.
+	static size_t findFreeSlot(const Ctrl* ctrlArray, size_t allocated, size_t hashValue)
+	{
+		size_t groupMask = (allocated / cGroupSize) - 1;
+		size_t group = h1(hashValue) & groupMask;
+		size_t step = 1;
+		unsigned int free = matchFree(ctrlArray + group * cGroupSize);
+
+		while (free == 0)
+		{
+			group = (group + step++) & groupMask;
+			free = matchFree(ctrlArray + group * cGroupSize);
+		}
+		return group * cGroupSize + lowestBit(free);
+	}
+
+	// The slots are raw memory, elements are constructed in place when
+	// inserted and destroyed when erased.
+	static Array allocateSlots(size_t count)
+	{
+		return static_cast<Array>(::operator new(sizeof(value_type)*count));
+	}
+
+	static Ctrl* allocateCtrl(size_t count)
+	{
+		Ctrl* ctrl = new Ctrl[count];
+		memset(ctrl, static_cast<unsigned char>(cEmpty), sizeof(ctrl[0])*count);
+		return ctrl;
+	}
+
+	static void freeSlots(Array slots, Ctrl* ctrl)
+	{
+		::operator delete(slots);
+		delete [] ctrl;
+	}
+
+	// Create a new, bigger, array. Also used to get rid of tombstones,
+	// newAlloc is then the current size.
+	void rehash(size_t newAlloc)
+	{
+		size_t oldAllocated = mAllocated;
+		Array newArray = allocateSlots(newAlloc);
+		Ctrl* newCtrl = allocateCtrl(newAlloc);
+
+		for (size_t i=0; i<oldAllocated; ++i)
+		{
+			if(isFull(mCtrl[i]))
+			{
+				value_type& element = mArray[i];
+				size_t hashValue = hash(element.first);
+				size_t index = findFreeSlot(newCtrl, newAlloc, hashValue);
+
+				// Copy the element to its new slot, and get rid of the old one
+				new (&newArray[index]) value_type(element);
+				newCtrl[index] = h2(hashValue);
+				element.~value_type();
+			}
+		}
+
+		if (mArray!=0)
+			freeSlots(mArray, mCtrl);
+		mArray = newArray;
+		mCtrl = newCtrl;
+		mAllocated = newAlloc;
+		mFreeSlots = newAlloc - mSize;
+		mDeleted = 0;
+	}
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	// The hash table iteself
+	Array	mArray;
+	Ctrl*	mCtrl; // One control byte per slot in mArray
+	size_t	mAllocated; // The actual size of the array, a multiple of cGroupSize
+	size_t	mFreeSlots; // Number of free (empty) slots in the array, tombstones not included
+	size_t	mDeleted; // Number of tombstones in the array
+	size_t	mSize;	// Number of elements stored in the hash table
+
+	MyGrower mGrower;
+
+};
+
+#endif // !defined(HASHTABLESWISS_H)
@@ -0,0 +1,385 @@
+/*=====================================================================
+	InlineBucket.h - Small bucket collection for HashTableChained
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		template <class Key, class Value, size_t N = 2>
+		class InlineBucket
+		{
+			class iterator
+			class const_iterator
+		}
+
+  Requirements:
+		Key must have an == operator.
+
+  Dependencies:
+		No external dependencies
+
+=====================================================================*/
+#if !defined(INLINEBUCKET_H)
+#define INLINEBUCKET_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <new> // placement new
+#include <stddef.h> // size_t
+#include <utility> // std::pair
+
+//------------------------------------------------------------------------
+// InlineBucket
+// The default Collection of HashTableChained. A good hasher leaves only
+// a few keys in each bucket, so the first N elements are stored in the
+// bucket itself and only the ones beyond that get a node of their own,
+// in a singly linked list. Lookups compare the keys one by one.
+// class Key
+//   The key type
+// class Value:
+//   The value type
+// size_t N:
+//   Number of elements stored without a node of their own
+template <class Key, class Value, size_t N = 2>
+class InlineBucket
+{
+	struct Node;
+
+public:
+	//------------------------------------------------------------------
+	// Public Type Definitions
+	//------------------------------------------------------------------
+	typedef std::pair<Key, Value> value_type;
+
+	//------------------------------------------------------------------
+	// Public Classes
+	//------------------------------------------------------------------
+	class const_iterator;
+
+	// class iterator
+	// Indexes below N are the inline elements, mNode points out the
+	// element for the ones above.
+	class iterator
+	{
+	public:
+		iterator():mBucket(0), mIndex(0), mNode(0) {}
+		iterator(InlineBucket* bucket, size_t index, Node* node):mBucket(bucket), mIndex(index), mNode(node) {}
+
+		bool operator == (const iterator& src) const
+		{
+			return mBucket == src.mBucket && mIndex == src.mIndex;
+		}
+
+		bool operator != (const iterator& src) const
+		{
+			return !(*this == src);
+		}
+
+		value_type& operator*() const
+		{
+			return mIndex < N ? mBucket->getInline(mIndex) : mNode->value;
+		}
+
+		value_type* operator->() const
+		{
+			return &**this;
+		}
+
+		iterator& operator ++ ()
+		{
+			if (mNode)
+				mNode = mNode->next;
+			if (++mIndex == N)
+				mNode = mBucket->mHead;
+			return (*this);
+		}
+
+	private:
+		friend class InlineBucket;
+		friend class const_iterator;
+
+		InlineBucket* mBucket;
+		size_t mIndex;
+		Node* mNode;
+	};
+
+	// class const_iterator
+	class const_iterator
+	{
+	public:
+		const_iterator():mBucket(0), mIndex(0), mNode(0) {}
+		const_iterator(const InlineBucket* bucket, size_t index, const Node* node):mBucket(bucket), mIndex(index), mNode(node) {}
+		const_iterator(const iterator& src):mBucket(src.mBucket), mIndex(src.mIndex), mNode(src.mNode) {}
+
+		bool operator == (const const_iterator& src) const
+		{
+			return mBucket == src.mBucket && mIndex == src.mIndex;
+		}
+
+		bool operator != (const const_iterator& src) const
+		{
+			return !(*this == src);
+		}
+
+		const value_type& operator*() const
+		{
+			return mIndex < N ? mBucket->getInline(mIndex) : mNode->value;
+		}
+
+		const value_type* operator->() const
+		{
+			return &**this;
+		}
+
+		const_iterator& operator ++ ()
+		{
+			if (mNode)
+				mNode = mNode->next;
+			if (++mIndex == N)
+				mNode = mBucket->mHead;
+			return (*this);
+		}
+
+	private:
+		const InlineBucket* mBucket;
+		size_t mIndex;
+		const Node* mNode;
+	};
+
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	InlineBucket():mSize(0), mHead(0) {}
+
+	~InlineBucket()
+	{
+		clear();
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+	const_iterator find(const Key& key) const
+	{
+		size_t i;
+		for (i=0;i<mSize && i<N;++i)
+		{
+			if (getInline(i).first == key)
+				return const_iterator(this, i, 0);
+		}
+		for (const Node* node=mHead;node!=0;node=node->next,++i)
+		{
+			if (node->value.first == key)
+				return const_iterator(this, i, node);
+		}
+		return end();
+	}
+
+	iterator find(const Key& key)
+	{
+		size_t i;
+		for (i=0;i<mSize && i<N;++i)
+		{
+			if (getInline(i).first == key)
+				return iterator(this, i, 0);
+		}
+		for (Node* node=mHead;node!=0;node=node->next,++i)
+		{
+			if (node->value.first == key)
+				return iterator(this, i, node);
+		}
+		return end();
+	}
+
+	size_t size() const { return mSize; }
+	bool empty() const { return mSize == 0; }
+
+	// Memory allocated for the elements beyond the first N
+	size_t getNodeBytes() const { return mSize > N ? (mSize - N)*sizeof(Node) : 0; }
+
+	//------------------------------------------------------------------
+	// Public Iterators
+	//------------------------------------------------------------------
+	iterator		begin() { return iterator(this, 0, N == 0 ? mHead : 0); }
+	const_iterator	begin() const { return const_iterator(this, 0, N == 0 ? mHead : 0); }
+	iterator		end() { return iterator(this, mSize, 0); }
+	const_iterator	end() const { return const_iterator(this, mSize, 0); }
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+	// insert - second is false if no insertion took place, ie key already stored
+	std::pair<iterator, bool> insert(const value_type& vt)
+	{
+		iterator it = find(vt.first);
+		if (it != end())
+			return std::pair<iterator, bool>(it, false);
+
+		return std::pair<iterator, bool>(insertNew(vt.first, vt.second), true);
+	}
+
+	// Inserts an element constructed from key and arg, for a key that
+	// isn't stored, eg as find() just told. Doesn't search the bucket.
+	template <class Arg>
+	iterator insertNew(const Key& key, const Arg& arg)
+	{
+		if (mSize < N)
+		{
+			new (&getInline(mSize)) value_type(key, arg);
+			return iterator(this, mSize++, 0);
+		}
+
+		// The list order doesn't matter, new nodes go first
+		mHead = new Node(key, arg, mHead);
+		mSize++;
+		return iterator(this, N, mHead);
+	}
+
+	// The hole after an inline element is filled with the first node, or
+	// the last inline element if there are no nodes.
+	size_t erase(const Key& key)
+	{
+		size_t i;
+		size_t inlineSize = mSize < N ? mSize : N;
+		for (i=0;i<inlineSize;++i)
+		{
+			if (getInline(i).first == key)
+			{
+				getInline(i).~value_type();
+				if (mHead)
+				{
+					Node* node = mHead;
+					new (&getInline(i)) value_type(node->value);
+					mHead = node->next;
+					delete node;
+				}
+				else if (i != inlineSize-1)
+				{
+					new (&getInline(i)) value_type(getInline(inlineSize-1));
+					getInline(inlineSize-1).~value_type();
+				}
+				mSize--;
+				return 1;
+			}
+		}
+
+		for (Node** link=&mHead;*link!=0;link=&(*link)->next)
+		{
+			if ((*link)->value.first == key)
+			{
+				Node* node = *link;
+				*link = node->next;
+				delete node;
+				mSize--;
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	// Moves every element, in the order of iteration, to the bucket that
+	// target(key) returns, another InlineBucket that doesn't hold the key,
+	// and leaves this one empty. The inline elements are copied, a node
+	// is relinked as it is unless its new bucket has room for the element
+	// inline. Used by HashTableChained when a bucket splits up in a rehash.
+	template <class Target>
+	void moveAll(Target& target)
+	{
+		size_t inlineSize = mSize < N ? mSize : N;
+		for (size_t i=0;i<inlineSize;++i)
+		{
+			target(getInline(i).first)->insertNew(getInline(i).first, getInline(i).second);
+			getInline(i).~value_type();
+		}
+
+		while (mHead)
+		{
+			Node* node = mHead;
+			mHead = node->next;
+
+			InlineBucket* bucket = target(node->value.first);
+			if (bucket->mSize < N)
+			{
+				bucket->insertNew(node->value.first, node->value.second);
+				delete node;
+			}
+			else
+			{
+				node->next = bucket->mHead;
+				bucket->mHead = node;
+				bucket->mSize++;
+			}
+		}
+		mSize = 0;
+	}
+
+	void clear()
+	{
+		size_t inlineSize = mSize < N ? mSize : N;
+		for (size_t i=0;i<inlineSize;++i)
+		{
+			getInline(i).~value_type();
+		}
+		while (mHead)
+		{
+			Node* node = mHead;
+			mHead = node->next;
+			delete node;
+		}
+		mSize = 0;
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	InlineBucket(const InlineBucket&);
+
+	// Assignment operator
+	InlineBucket& operator = (const InlineBucket&);
+
+	//------------------------------------------------------------------
+	// Private Classes
+	//------------------------------------------------------------------
+	friend class iterator;
+	friend class const_iterator;
+
+	struct Node
+	{
+		template <class Arg>
+		Node(const Key& key, const Arg& arg, Node* n):value(key, arg), next(n) {}
+
+		value_type value;
+		Node* next;
+	};
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	value_type& getInline(size_t index) { return reinterpret_cast<value_type*>(mInline.mData)[index]; }
+	const value_type& getInline(size_t index) const { return reinterpret_cast<const value_type*>(mInline.mData)[index]; }
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	size_t	mSize; // Inline elements and nodes
+	Node*	mHead; // Elements beyond the first N, 0 if none
+
+	// Raw storage for the first N elements, the other members are only
+	// there to align it.
+	union
+	{
+		char	mData[(N > 0 ? N : 1)*sizeof(value_type)];
+		double	mAlignDouble;
+		void*	mAlignPointer;
+	} mInline;
+};
+
+#endif // !defined(INLINEBUCKET_H)
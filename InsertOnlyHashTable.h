@@ -0,0 +1,411 @@
+/*=====================================================================
+	InsertOnlyHashTable.h - Lock free insert-only hash table
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		// The hash table
+		template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower
+		  >
+		class InsertOnlyHashTable
+
+  Requirements:
+		C++11 (std::atomic)
+		A Hasher must be implemented if the generic ones isn't applicable,
+		with the full width () operator, ie without a size.
+		Caller needs to #inlude default Grower/Hasher if they are to be used.
+
+  Dependencies:
+		No external dependencies
+
+  Inserting:
+		Elements can be inserted and looked up, from any number of threads
+		at once, but never erased or changed. That's what makes it simple:
+		Each element is a node of its own and a slot goes from empty to a
+		node once, and then stays. A thread claims an empty slot by a
+		compare-and-swap of its node into it. If someone else got there
+		first the thread looks at what they put there, as it could be the
+		same key, and otherwise moves on along the probe sequence. As the
+		nodes never move or go away, pointers to elements stay valid for
+		the lifetime of the table.
+
+  Growing:
+		A thread that finds the array too full hangs a bigger one on it,
+		and every thread that comes along helps moving the nodes over, a
+		chunk of slots at a time. Empty slots are closed on the way (marked
+		moved), so nothing is inserted behind the migration. Inserters wait
+		until the last chunk is done before they use the new array, so a
+		key can't end up in both. Lookups don't wait, a moved slot sends
+		them on to the new array.
+		The old arrays (but not the nodes) are kept until the table is
+		destroyed, in case a lookup is still in one. They add up to less
+		than the current array, as each is smaller than the next.
+
+=====================================================================*/
+#if !defined(INSERTONLYHASHTABLE_H)
+#define INSERTONLYHASHTABLE_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <atomic>
+#include <map> // std::pair
+#include <thread> // std::this_thread::yield
+
+//------------------------------------------------------------------------
+// InsertOnlyHashTable
+// A thread safe, lock free, hash set/map for dedup and interning kind of
+// uses, see Inserting and Growing above.
+// class Key
+//   The key type
+// class Value:
+//   The value type
+// class MyHasher:
+//   A class (function object) that will be called when computing the...well...hash value.
+// class MyGrower:
+//   A class used to determine what size the array should grow to, and
+//   to map a hash value to a slot
+template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower
+		  >
+class InsertOnlyHashTable
+{
+public:
+	//------------------------------------------------------------------
+	// Public Type Definitions
+	//------------------------------------------------------------------
+	typedef std::pair<Key, Value> value_type;
+
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	// Default constructor
+	explicit InsertOnlyHashTable(size_t initialSize=1000) // Might be adjusted upwards
+	{
+		mFirst = new Array(mGrower.getPrimeGreaterThan(initialSize), mGrower);
+		mArray.store(mFirst, std::memory_order_relaxed);
+		mSize.store(0, std::memory_order_relaxed);
+	}
+
+	// Destructor. No other thread may use the table any more.
+	~InsertOnlyHashTable()
+	{
+		// Every node is in the last array
+		Array* array = mFirst;
+		while (array != 0)
+		{
+			Array* next = array->next.load(std::memory_order_relaxed);
+			if (next == 0)
+			{
+				for (size_t i=0;i<array->allocated;++i)
+				{
+					Node* node = array->slots[i].load(std::memory_order_relaxed);
+					if (isNode(node))
+						delete node;
+				}
+			}
+			delete array;
+			array = next;
+		}
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+	// The element with key, 0 if not found. Stays valid as long as the
+	// table.
+	const value_type* find(const Key& key) const
+	{
+		size_t hashValue = hash(key);
+		const Array* array = mArray.load(std::memory_order_acquire);
+
+		for (;;)
+		{
+			size_t start = mGrower.getIndexFromHash(hashValue, array->allocated, array->magic);
+			size_t index = start;
+			do
+			{
+				const Node* node = array->slots[index].load(std::memory_order_acquire);
+				if (node == 0)
+					return 0;
+				if (node == getMoved())
+					break;
+				if (node->hashValue == hashValue && node->value.first == key)
+					return &node->value;
+				index = probeNext(index, array->allocated);
+			} while (index != start);
+
+			// Moved, or full and on its way to be
+			array = array->next.load(std::memory_order_acquire);
+			if (array == 0)
+				return 0;
+		}
+	}
+
+	// Copies the value with key, if any, to value
+	bool find(const Key& key, Value& value) const
+	{
+		const value_type* vt = find(key);
+		if (vt == 0)
+			return false;
+
+		value = vt->second;
+		return true;
+	}
+
+	bool contains(const Key& key) const
+	{
+		return find(key) != 0;
+	}
+
+	// The size at some recent moment
+	size_t size() const { return mSize.load(std::memory_order_relaxed); }
+
+	size_t getAllocated() const { return mArray.load(std::memory_order_acquire)->allocated; }
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+	// insert - returns false if no insertion took place, ie key already stored
+	bool insert(const Key& key, const Value& value)
+	{
+		return try_emplace(key, value).second;
+	}
+
+	// The element with key, and true if it was inserted by this call.
+	// The element is constructed from key and value up front, and thrown
+	// away again if key turns out to be stored already.
+	std::pair<const value_type*, bool> try_emplace(const Key& key, const Value& value)
+	{
+		size_t hashValue = hash(key);
+		Node* node = 0;
+		Array* array = mArray.load(std::memory_order_acquire);
+
+		for (;;)
+		{
+			// Don't insert into an array that's being migrated
+			if (array->next.load(std::memory_order_acquire) != 0)
+			{
+				array = helpMigrate(array);
+				continue;
+			}
+
+			size_t used = array->used.load(std::memory_order_relaxed);
+			size_t newAlloc = mGrower.getNewSize(array->allocated, used < array->allocated ? array->allocated - used : 0);
+			if (newAlloc > array->allocated)
+			{
+				array = startMigration(array, newAlloc);
+				continue;
+			}
+
+			size_t start = mGrower.getIndexFromHash(hashValue, array->allocated, array->magic);
+			size_t index = start;
+			bool moved = false;
+			do
+			{
+				Node* found = array->slots[index].load(std::memory_order_acquire);
+				if (found == 0)
+				{
+					if (node == 0)
+						node = new Node(key, value, hashValue);
+					if (array->slots[index].compare_exchange_strong(found, node, std::memory_order_acq_rel, std::memory_order_acquire))
+					{
+						array->used.fetch_add(1, std::memory_order_relaxed);
+						mSize.fetch_add(1, std::memory_order_relaxed);
+						return std::pair<const value_type*, bool>(&node->value, true);
+					}
+					// Someone else claimed it, found is what they put there
+				}
+				if (found == getMoved())
+				{
+					moved = true;
+					break;
+				}
+				if (found->hashValue == hashValue && found->value.first == key)
+				{
+					delete node;
+					return std::pair<const value_type*, bool>(&found->value, false);
+				}
+				index = probeNext(index, array->allocated);
+			} while (index != start);
+
+			// Either a migration has closed the slots, or other threads
+			// filled the array before the grower noticed
+			if (moved)
+				array = helpMigrate(array);
+			else
+				array = startMigration(array, mGrower.getPrimeGreaterThan(array->allocated));
+		}
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	InsertOnlyHashTable(const InsertOnlyHashTable&);
+
+	// Assignment operator
+	InsertOnlyHashTable& operator = (const InsertOnlyHashTable&);
+
+	//------------------------------------------------------------------
+	// Private Classes
+	//------------------------------------------------------------------
+	// An element, with its full width hash value so that it's not hashed
+	// again when the array grows.
+	struct Node
+	{
+		Node(const Key& key, const Value& value, size_t hash):value(key, value), hashValue(hash) {}
+
+		value_type value;
+		size_t hashValue;
+	};
+
+	// The slots, 0 for empty, a node, or getMoved() for a slot closed by
+	// the migration. next is the array being migrated to, 0 until this
+	// one gets too full.
+	struct Array
+	{
+		Array(size_t size, const MyGrower& grower):allocated(size), magic(grower.getMagic(size)), slots(new std::atomic<Node*>[size]),
+			used(0), next(0), chunksClaimed(0), chunksDone(0)
+		{
+			for (size_t i=0;i<allocated;++i)
+			{
+				slots[i].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		~Array()
+		{
+			delete [] slots;
+		}
+
+		size_t allocated;
+		size_t magic;						// The grower's, for allocated
+		std::atomic<Node*>* slots;
+		std::atomic<size_t> used;			// Slots with a node
+		std::atomic<Array*> next;
+		std::atomic<size_t> chunksClaimed;	// Migration chunks handed out
+		std::atomic<size_t> chunksDone;		// Migration chunks finished
+	};
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	static size_t hash(const Key& key)
+	{
+		MyHasher hasher;
+		return hasher(key);
+	}
+
+	// Never dereferenced, only compared with
+	Node* getMoved() const { return reinterpret_cast<Node*>(const_cast<char*>(&mMoved)); }
+
+	bool isNode(const Node* node) const { return node != 0 && node != getMoved(); }
+
+	// Next slot in the probe sequence, same as HashTableProbed's
+	static size_t probeNext(size_t index, size_t allocated)
+	{
+		index += cIncBy;
+		while (index >= allocated)
+			index -= allocated;
+		return index;
+	}
+
+	// Hangs a new array of newAlloc slots on array, unless another thread
+	// got there first, and helps migrating to it.
+	Array* startMigration(Array* array, size_t newAlloc)
+	{
+		Array* next = new Array(newAlloc, mGrower);
+		Array* expected = 0;
+		if (!array->next.compare_exchange_strong(expected, next, std::memory_order_acq_rel, std::memory_order_acquire))
+			delete next;
+		return helpMigrate(array);
+	}
+
+	// Moves chunks of array over to its next array until there are none
+	// left, then waits for the other helpers to finish theirs. Returns the
+	// next array, which is also made the current one.
+	Array* helpMigrate(Array* array)
+	{
+		Array* next = array->next.load(std::memory_order_acquire);
+		size_t chunks = (array->allocated + cMigrateChunk - 1) / cMigrateChunk;
+
+		for (;;)
+		{
+			size_t chunk = array->chunksClaimed.fetch_add(1, std::memory_order_relaxed);
+			if (chunk >= chunks)
+				break;
+
+			size_t end = (chunk+1)*cMigrateChunk;
+			if (end > array->allocated)
+				end = array->allocated;
+
+			size_t moved = 0;
+			for (size_t i=chunk*cMigrateChunk;i<end;++i)
+			{
+				Node* node = 0;
+				// Close an empty slot, unless an insert gets there first
+				if (!array->slots[i].compare_exchange_strong(node, getMoved(), std::memory_order_acq_rel, std::memory_order_acquire))
+				{
+					moveNode(next, node);
+					moved++;
+				}
+			}
+			next->used.fetch_add(moved, std::memory_order_relaxed);
+			array->chunksDone.fetch_add(1, std::memory_order_release);
+		}
+
+		while (array->chunksDone.load(std::memory_order_acquire) < chunks)
+		{
+			std::this_thread::yield();
+		}
+
+		Array* expected = array;
+		mArray.compare_exchange_strong(expected, next, std::memory_order_acq_rel, std::memory_order_acquire);
+		return next;
+	}
+
+	// Puts a node in the array being migrated to. Only migrations write to
+	// it until they're all done, and they all move different nodes.
+	void moveNode(Array* array, Node* node)
+	{
+		size_t index = mGrower.getIndexFromHash(node->hashValue, array->allocated, array->magic);
+		for (;;)
+		{
+			Node* expected = 0;
+			if (array->slots[index].compare_exchange_strong(expected, node, std::memory_order_release, std::memory_order_relaxed))
+				return;
+			index = probeNext(index, array->allocated);
+		}
+	}
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	enum { cIncBy = 7 };
+
+	// Slots a helper migrates at a time
+	enum { cMigrateChunk = 1024 };
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	std::atomic<Array*> mArray;	// The array inserts go to
+	std::atomic<size_t> mSize;
+	Array* mFirst;				// The oldest array, the others follow by next
+
+	MyGrower mGrower;
+	char mMoved; // Its address marks migrated slots
+};
+
+#endif // !defined(INSERTONLYHASHTABLE_H)
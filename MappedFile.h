@@ -0,0 +1,165 @@
+/*=====================================================================
+	MappedFile.h - Read only memory mapped file
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		class MappedFile
+
+  Requirements:
+		Windows, or a POSIX system with mmap().
+
+  Dependencies:
+		<windows.h> or <sys/mman.h>
+
+=====================================================================*/
+#if !defined(MAPPEDFILE_H)
+#define MAPPEDFILE_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//------------------------------------------------------------------------
+// MappedFile
+// The whole of a file mapped read only into memory. Pages are read from
+// the file as they're first touched, and shared with other processes
+// mapping the same file.
+class MappedFile
+{
+public:
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	MappedFile():mData(0), mSize(0)
+	{
+#if defined(_WIN32)
+		mFile = INVALID_HANDLE_VALUE;
+		mMapping = 0;
+#endif
+	}
+
+	~MappedFile()
+	{
+		close();
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+	// False for an empty file as well, there's nothing to map
+	bool isOpen() const { return mData != 0; }
+
+	// 0 if not open, or empty
+	const char* getData() const { return mData; }
+	size_t getSize() const { return mSize; }
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+	// Maps path, after closing what was mapped before. An empty file is
+	// left unmapped, with getData() 0 and getSize() 0.
+	void open(const char* path)
+	{
+		close();
+
+#if defined(_WIN32)
+		mFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (mFile == INVALID_HANDLE_VALUE)
+			throw "Failed to open file";
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(mFile, &size) || (unsigned long long)size.QuadPart > size_t(-1))
+		{
+			close();
+			throw "Failed to map file";
+		}
+		if (size.QuadPart == 0)
+		{
+			close();
+			return;
+		}
+
+		mMapping = CreateFileMappingA(mFile, 0, PAGE_READONLY, 0, 0, 0);
+		void* data = mMapping != 0 ? MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0) : 0;
+		if (data == 0)
+		{
+			close();
+			throw "Failed to map file";
+		}
+		mData = static_cast<const char*>(data);
+		mSize = static_cast<size_t>(size.QuadPart);
+#else
+		int file = ::open(path, O_RDONLY);
+		if (file < 0)
+			throw "Failed to open file";
+
+		// The mapping stays valid when the file is closed
+		struct stat status;
+		void* data = MAP_FAILED;
+		if (fstat(file, &status) == 0)
+			data = status.st_size > 0 ? mmap(0, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0) : 0;
+		::close(file);
+		if (data == MAP_FAILED)
+			throw "Failed to map file";
+
+		mData = static_cast<const char*>(data);
+		mSize = static_cast<size_t>(status.st_size);
+#endif
+	}
+
+	void close()
+	{
+#if defined(_WIN32)
+		if (mData != 0)
+			UnmapViewOfFile(mData);
+		if (mMapping != 0)
+			CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+		mFile = INVALID_HANDLE_VALUE;
+		mMapping = 0;
+#else
+		if (mData != 0)
+			munmap(const_cast<char*>(mData), mSize);
+#endif
+		mData = 0;
+		mSize = 0;
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	MappedFile(const MappedFile&);
+
+	// Assignment operator
+	MappedFile& operator = (const MappedFile&);
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	const char* mData;
+	size_t mSize;
+#if defined(_WIN32)
+	HANDLE mFile;
+	HANDLE mMapping;
+#endif
+};
+
+#endif // !defined(MAPPEDFILE_H)
@@ -0,0 +1,285 @@
+/*=====================================================================
+	PoolAllocator.h - Allocators for HashTableChained's buckets
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		// Plain new and delete, the default
+		class NewAllocator
+
+		// Size class pools carved out of big slabs
+		class PoolAllocator
+
+  Requirements:
+		None
+
+  Dependencies:
+		No external dependencies
+
+  If you implement your own Allocator:
+		It needs allocate(bytes) and deallocate(pointer, bytes), where
+		bytes is what was asked for when pointer was allocated, and
+		releaseAll() that frees everything allocated so far. Also the
+		constants cCanReleaseAll, if releaseAll() does that (otherwise a
+		table deallocates each bucket on its own), and cThreadSafe, if
+		allocate() and deallocate() may be called from several threads at
+		once (otherwise a table rehashes on the calling thread).
+
+=====================================================================*/
+#if !defined(POOLALLOCATOR_H)
+#define POOLALLOCATOR_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <new> // operator new
+#include <stddef.h> // size_t
+
+//------------------------------------------------------------------------
+// NewAllocator
+// Every allocation goes to the global operator new.
+class NewAllocator
+{
+public:
+	enum { cCanReleaseAll = 0 };
+	enum { cThreadSafe = 1 };
+
+	void* allocate(size_t bytes)
+	{
+		return ::operator new(bytes);
+	}
+
+	void deallocate(void* pointer, size_t /*bytes*/)
+	{
+		::operator delete(pointer);
+	}
+
+	// Not possible, nothing is kept track of
+	void releaseAll() {}
+};
+
+//------------------------------------------------------------------------
+// PoolAllocator
+// Sizes are rounded up to a multiple of cGranularity, and each such size
+// class is handed out from slabs of its own, slabSize bytes at a time.
+// Deallocated blocks go on a free list for their size class and are
+// reused before the slab is carved further, so a table that inserts and
+// erases at the same rate stops allocating altogether. Nothing is given
+// back to the system until releaseAll() (or the destructor) frees the
+// slabs, all at once. Blocks bigger than cMaxPooled get an allocation of
+// their own, still freed by releaseAll().
+// Not thread safe, one allocator per table.
+class PoolAllocator
+{
+public:
+	enum { cCanReleaseAll = 1 };
+	enum { cThreadSafe = 0 };
+
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	explicit PoolAllocator(size_t slabSize=cDefaultSlabSize):mSlabSize(slabSize), mSlabs(0), mLarge(0), mSlabCount(0)
+	{
+		if (mSlabSize < cSlabHeader + cMaxPooled)
+			mSlabSize = cSlabHeader + cMaxPooled;
+
+		for (size_t i=0;i<cClasses;++i)
+		{
+			mFree[i] = 0;
+			mNext[i] = 0;
+			mEnd[i] = 0;
+		}
+	}
+
+	~PoolAllocator()
+	{
+		releaseAll();
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+	// Slabs allocated, not counting the blocks bigger than cMaxPooled
+	size_t getSlabCount() const { return mSlabCount; }
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+	void* allocate(size_t bytes)
+	{
+		if (bytes > cMaxPooled)
+			return allocateLarge(bytes);
+
+		size_t sizeClass = getSizeClass(bytes);
+		if (mFree[sizeClass] != 0)
+		{
+			FreeBlock* block = mFree[sizeClass];
+			mFree[sizeClass] = block->next;
+			return block;
+		}
+
+		size_t blockSize = (sizeClass+1)*cGranularity;
+		if (mNext[sizeClass] == 0 || mNext[sizeClass] + blockSize > mEnd[sizeClass])
+		{
+			char* slab = static_cast<char*>(::operator new(mSlabSize));
+			reinterpret_cast<Slab*>(slab)->next = mSlabs;
+			mSlabs = reinterpret_cast<Slab*>(slab);
+			mSlabCount++;
+
+			mNext[sizeClass] = slab + cSlabHeader;
+			mEnd[sizeClass] = slab + mSlabSize;
+		}
+
+		void* block = mNext[sizeClass];
+		mNext[sizeClass] += blockSize;
+		return block;
+	}
+
+	void deallocate(void* pointer, size_t bytes)
+	{
+		if (pointer == 0)
+			return;
+
+		if (bytes > cMaxPooled)
+		{
+			deallocateLarge(pointer);
+			return;
+		}
+
+		size_t sizeClass = getSizeClass(bytes);
+		FreeBlock* block = static_cast<FreeBlock*>(pointer);
+		block->next = mFree[sizeClass];
+		mFree[sizeClass] = block;
+	}
+
+	// Frees every slab and block, whatever was allocated from them must
+	// not be used any more.
+	void releaseAll()
+	{
+		while (mSlabs != 0)
+		{
+			Slab* next = mSlabs->next;
+			::operator delete(mSlabs);
+			mSlabs = next;
+		}
+		while (mLarge != 0)
+		{
+			LargeBlock* next = mLarge->next;
+			::operator delete(mLarge);
+			mLarge = next;
+		}
+		mSlabCount = 0;
+
+		for (size_t i=0;i<cClasses;++i)
+		{
+			mFree[i] = 0;
+			mNext[i] = 0;
+			mEnd[i] = 0;
+		}
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	PoolAllocator(const PoolAllocator&);
+
+	// Assignment operator
+	PoolAllocator& operator = (const PoolAllocator&);
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	// Block sizes are multiples of this, which is also their alignment
+	// as long as operator new aligns at least as much
+	enum { cGranularity = 16 };
+
+	// The biggest block that's pooled, bigger ones are allocated one by one
+	enum { cMaxPooled = 512 };
+
+	enum { cClasses = cMaxPooled / cGranularity };
+
+	// The slab and large block headers are padded to keep blocks aligned
+	enum { cSlabHeader = cGranularity };
+
+	enum { cDefaultSlabSize = 64*1024 };
+
+	//------------------------------------------------------------------
+	// Private Classes
+	//------------------------------------------------------------------
+	// The start of a slab, slabs are linked for releaseAll()
+	struct Slab
+	{
+		Slab* next;
+	};
+
+	// A deallocated block, linked into the free list of its size class
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	// The start of a block bigger than cMaxPooled, linked both ways so
+	// that it can be unlinked when it's deallocated
+	struct LargeBlock
+	{
+		LargeBlock* prev;
+		LargeBlock* next;
+	};
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	static size_t getSizeClass(size_t bytes)
+	{
+		return bytes == 0 ? 0 : (bytes - 1) / cGranularity;
+	}
+
+	static size_t getLargeHeader()
+	{
+		return (sizeof(LargeBlock) + cGranularity - 1) / cGranularity * cGranularity;
+	}
+
+	void* allocateLarge(size_t bytes)
+	{
+		LargeBlock* block = static_cast<LargeBlock*>(::operator new(getLargeHeader() + bytes));
+		block->prev = 0;
+		block->next = mLarge;
+		if (mLarge != 0)
+			mLarge->prev = block;
+		mLarge = block;
+		return reinterpret_cast<char*>(block) + getLargeHeader();
+	}
+
+	void deallocateLarge(void* pointer)
+	{
+		LargeBlock* block = reinterpret_cast<LargeBlock*>(static_cast<char*>(pointer) - getLargeHeader());
+		if (block->prev != 0)
+			block->prev->next = block->next;
+		else
+			mLarge = block->next;
+		if (block->next != 0)
+			block->next->prev = block->prev;
+		::operator delete(block);
+	}
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	size_t		mSlabSize;
+	Slab*		mSlabs;				// All slabs, newest first
+	LargeBlock*	mLarge;				// All blocks bigger than cMaxPooled
+	size_t		mSlabCount;
+	FreeBlock*	mFree[cClasses];	// Per size class
+	char*		mNext[cClasses];	// Where the next block of a size class is carved
+	char*		mEnd[cClasses];		// The end of the slab mNext is in
+};
+
+#endif // !defined(POOLALLOCATOR_H)
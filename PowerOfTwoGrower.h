@@ -0,0 +1,121 @@
+/*=====================================================================
+	PowerOfTwoGrower.h - A grower for power of two sized hash tables
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the 
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		class PowerOfTwoGrower
+
+  Requirements:
+		The Hasher must have the full width () operator, ie one that 
+		takes just the key (see GenericHashers.h).
+
+  Dependencies:
+		HashMix.h
+
+=====================================================================*/
+#if !defined(POWEROFTWOGROWER_H)
+#define POWEROFTWOGROWER_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include "HashMix.h"
+
+//------------------------------------------------------------------------
+// PowerOfTwoGrower 
+// Keeps the array size a power of two, so a key's slot is found by masking
+// its (mixed) full width hash value rather than by a division.
+class PowerOfTwoGrower
+{
+public:
+	// Default constructor
+	PowerOfTwoGrower():mMaxLoadFactor(0.9) {}
+
+	// The largest fraction of the slots that may be in use before the 
+	// array grows, 0 < factor < 1. 
+	void setMaxLoadFactor(float factor)
+	{
+		if (!(factor > 0 && factor < 1))
+			throw "Invalid max load factor";
+		mMaxLoadFactor = factor;
+	}
+	float getMaxLoadFactor() const { return float(mMaxLoadFactor); }
+
+	// Part of the grower interface, see DefaultGrower. Despite the name it
+	// returns the smallest power of two greater than size.
+	size_t getPrimeGreaterThan(size_t size) const
+	{
+		size_t newSize = cMinSize;
+		while (newSize <= size)
+		{
+			newSize <<= 1;
+		}
+		return newSize;
+	}
+
+	// Called by HashTable to figure out if the array needs to grow.
+	// If returned value <= currentSize array won't grow.
+	size_t getNewSize(size_t currentSize, size_t freeSlots) const
+	{
+		// Doubling needs something to start from, a smaller array (eg 0
+		// for none) grows to cMinSize first
+		size_t newSize = currentSize < cMinSize ? size_t(cMinSize) : currentSize;
+		freeSlots = freeSlots + (newSize-currentSize);
+
+		// Same rule as the DefaultGrower: Make sure the slots in use don't 
+		// exceed the max load factor, by default 90%.
+		while (freeSlots <= getMinFreeSlots(newSize))
+		{
+			size_t biggerSize = newSize << 1;
+			// As the array grows more slots will be available
+			freeSlots = freeSlots + (biggerSize-newSize); 
+			newSize = biggerSize;
+		}
+		return newSize;
+	}
+
+	// Part of the grower interface, see DefaultGrower. The mask needs
+	// nothing worked out in advance.
+	size_t getMagic(size_t /*allocated*/) const { return 0; }
+
+	// Called by HashTable to map key to a slot in an array of size 
+	// allocated, which is a power of two.
+	template <class MyHasher, class Key>
+	size_t getIndex(MyHasher& hasher, const Key& key, size_t allocated, size_t magic) const
+	{
+		return getIndexFromHash(hasher(key), allocated, magic);
+	}
+
+	size_t getIndexFromHash(size_t hashValue, size_t allocated, size_t /*magic*/) const
+	{
+		return HashMix<sizeof(size_t)>::mix(hashValue) & (allocated - 1);
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	enum { cMinSize = 8 };
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	size_t getMinFreeSlots(size_t size) const
+	{
+		return size - size_t(size * mMaxLoadFactor);
+	}
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	double mMaxLoadFactor;
+};
+
+#endif // POWEROFTWOGROWER_H
@@ -0,0 +1,42 @@
+/*=====================================================================
+	Prefetch.h - Software prefetch hint
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Macros:
+
+		HASH_PREFETCH(address)
+
+  Requirements:
+		N/A
+
+  Dependencies:
+		<xmmintrin.h> when compiled for SSE by Visual C++
+
+=====================================================================*/
+#if !defined(PREFETCH_H)
+#define PREFETCH_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+//------------------------------------------------------------------------
+// HASH_PREFETCH
+// Asks the CPU to start loading the cache line at address, so that it's
+// (hopefully) there when it's needed a bit later. It's only a hint, it
+// never faults and compiles to nothing where there's no way to give it.
+#if defined(__GNUC__)
+#define HASH_PREFETCH(address) __builtin_prefetch(address)
+#elif defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define HASH_PREFETCH(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#else
+#define HASH_PREFETCH(address)
+#endif
+
+#endif // !defined(PREFETCH_H)
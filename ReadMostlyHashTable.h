@@ -0,0 +1,466 @@
+/*=====================================================================
+	ReadMostlyHashTable.h - Probing hash table with lock free lookups
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		// The hash table
+		template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower
+		  >
+		class ReadMostlyHashTable
+		{
+			// One per reading thread
+			class Reader
+		}
+
+  Requirements:
+		C++11 (std::atomic, std::mutex)
+		A Hasher must be implemented if the generic ones isn't applicable,
+		with the full width () operator, ie without a size.
+		Caller needs to #inlude default Grower/Hasher if they are to be used.
+
+  Dependencies:
+		EpochReclaimer.h
+
+  Readers:
+		Lookups go through a Reader, registered once per thread. They take
+		no lock and don't write anything shared, apart from announcing an
+		epoch in the Reader's own record. So they scale with the number of
+		cores, and are never held up by a writer, not even one that is
+		growing the array.
+
+  Writers:
+		insert(), insert_or_assign(), erase() and clear() are serialized by
+		a mutex, the table is meant for rare updates. Elements are never
+		changed in place: Each one is a node of its own, and the array holds
+		pointers to them. A writer builds a new node completely and then
+		publishes it with a release store to its slot, a reader that sees
+		the pointer sees the whole node. A replaced or erased node, or an
+		array that has been grown out of, is retired to the EpochReclaimer
+		and deleted when no reader can have it any more.
+		Erased slots are tombstones, as in HashTableProbed. Growing builds
+		a new array next to the old one, readers switch to it when it's
+		published.
+
+=====================================================================*/
+#if !defined(READMOSTLYHASHTABLE_H)
+#define READMOSTLYHASHTABLE_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <atomic>
+#include <map> // std::pair
+#include <mutex>
+
+#include "EpochReclaimer.h"
+
+//------------------------------------------------------------------------
+// ReadMostlyHashTable
+// A thread safe variant of HashTableProbed for tables that are read a
+// lot more often than they're changed, see Readers and Writers above.
+// class Key
+//   The key type
+// class Value:
+//   The value type
+// class MyHasher:
+//   A class (function object) that will be called when computing the...well...hash value.
+// class MyGrower:
+//   A class used to determine what size the array should grow to, and
+//   to map a hash value to a slot
+template <class Key, class Value,
+		  class MyHasher = Hasher<Key>,
+		  class MyGrower = DefaultGrower
+		  >
+class ReadMostlyHashTable
+{
+	struct Node;
+
+public:
+	//------------------------------------------------------------------
+	// Public Type Definitions
+	//------------------------------------------------------------------
+	typedef std::pair<Key, Value> value_type;
+
+	//------------------------------------------------------------------
+	// Public Classes
+	//------------------------------------------------------------------
+	// class Reader
+	// The lookups. Create one per thread, up front, and keep it for as
+	// long as the thread reads from the table. It must be destroyed
+	// before the table.
+	class Reader
+	{
+	public:
+		explicit Reader(const ReadMostlyHashTable& ht):mHT(ht), mReader(ht.mReclaimer) {}
+
+		// Calls visitor(const value_type&) with the element with key, if
+		// any. Returns false if there's none. The element may be replaced
+		// meanwhile, the visitor still sees the one it got.
+		template <class Visitor>
+		bool find(const Key& key, Visitor visitor)
+		{
+			EpochReclaimer::ReadGuard guard(mReader);
+
+			const Node* node = mHT.findNode(key);
+			if (node == 0)
+				return false;
+
+			visitor(node->value);
+			return true;
+		}
+
+		// Copies the value with key, if any, to value
+		bool find(const Key& key, Value& value)
+		{
+			EpochReclaimer::ReadGuard guard(mReader);
+
+			const Node* node = mHT.findNode(key);
+			if (node == 0)
+				return false;
+
+			value = node->value.second;
+			return true;
+		}
+
+		bool contains(const Key& key)
+		{
+			EpochReclaimer::ReadGuard guard(mReader);
+
+			return mHT.findNode(key) != 0;
+		}
+
+	private:
+		// Disabled
+		Reader(const Reader&);
+		Reader& operator = (const Reader&);
+
+		const ReadMostlyHashTable& mHT;
+		EpochReclaimer::Reader mReader;
+	};
+
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	// Default constructor
+	explicit ReadMostlyHashTable(size_t initialSize=1000) // Might be adjusted upwards
+	{
+		mArray.store(new Array(mGrower.getPrimeGreaterThan(initialSize), mGrower), std::memory_order_relaxed);
+		mFreeSlots = getArray()->allocated;
+		mDeleted = 0;
+		mSize.store(0, std::memory_order_relaxed);
+	}
+
+	// Destructor. All Readers must be gone.
+	~ReadMostlyHashTable()
+	{
+		Array* array = getArray();
+		for (size_t i=0;i<array->allocated;++i)
+		{
+			Node* node = array->slots[i].load(std::memory_order_relaxed);
+			if (isNode(node))
+				delete node;
+		}
+		delete array;
+	}
+
+	//------------------------------------------------------------------
+	// Public Queries
+	//------------------------------------------------------------------
+	// The size at some recent moment
+	size_t size() const { return mSize.load(std::memory_order_relaxed); }
+
+	size_t getAllocated() const { return mArray.load(std::memory_order_acquire)->allocated; }
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+	// insert - returns false if no insertion took place, ie key already stored
+	bool insert(const Key& key, const Value& value)
+	{
+		std::lock_guard<std::mutex> lock(mWriteMutex);
+
+		bool inserted = store(key, value, false);
+		mReclaimer.reclaim();
+		return inserted;
+	}
+
+	// Inserts, or replaces the element if key is already stored. Returns
+	// true if it was inserted.
+	bool insert_or_assign(const Key& key, const Value& value)
+	{
+		std::lock_guard<std::mutex> lock(mWriteMutex);
+
+		bool inserted = store(key, value, true);
+		mReclaimer.reclaim();
+		return inserted;
+	}
+
+	size_t erase(const Key& key)
+	{
+		std::lock_guard<std::mutex> lock(mWriteMutex);
+
+		Array* array = getArray();
+		size_t freeIndex;
+		size_t index = probeForInsert(array, key, hash(key), freeIndex);
+		if (index == array->allocated)
+			return 0;
+
+		Node* node = array->slots[index].load(std::memory_order_relaxed);
+		array->slots[index].store(getTombstone(), std::memory_order_release);
+		mReclaimer.retire(node);
+		mDeleted++;
+		mSize.store(mSize.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+
+		mReclaimer.reclaim();
+		return 1;
+	}
+
+	// Starts over with the smallest array. Readers still looking at the
+	// old one see the elements until they're done.
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mWriteMutex);
+
+		Array* array = getArray();
+		Array* newArray = new Array(mGrower.getPrimeGreaterThan(0), mGrower);
+		mArray.store(newArray, std::memory_order_release);
+		mFreeSlots = newArray->allocated;
+		mDeleted = 0;
+		mSize.store(0, std::memory_order_relaxed);
+
+		for (size_t i=0;i<array->allocated;++i)
+		{
+			Node* node = array->slots[i].load(std::memory_order_relaxed);
+			if (isNode(node))
+				mReclaimer.retire(node);
+		}
+		mReclaimer.retire(array);
+		mReclaimer.reclaim();
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	ReadMostlyHashTable(const ReadMostlyHashTable&);
+
+	// Assignment operator
+	ReadMostlyHashTable& operator = (const ReadMostlyHashTable&);
+
+	//------------------------------------------------------------------
+	// Private Classes
+	//------------------------------------------------------------------
+	// An element, never changed once published. The full width hash
+	// value is kept so that growing doesn't hash the keys again, and most
+	// mismatches are caught without comparing keys.
+	struct Node
+	{
+		Node(const Key& key, const Value& value, size_t hash):value(key, value), hashValue(hash) {}
+
+		value_type value;
+		size_t hashValue;
+	};
+
+	// The slots, 0 for empty, a tombstone or a published node
+	struct Array
+	{
+		Array(size_t size, const MyGrower& grower):allocated(size), magic(grower.getMagic(size)), slots(new std::atomic<Node*>[size])
+		{
+			for (size_t i=0;i<allocated;++i)
+			{
+				slots[i].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		~Array()
+		{
+			delete [] slots;
+		}
+
+		size_t allocated;
+		size_t magic; // The grower's, for allocated
+		std::atomic<Node*>* slots;
+	};
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	// The writer's view, nobody else changes it
+	Array* getArray() const { return mArray.load(std::memory_order_relaxed); }
+
+	static size_t hash(const Key& key)
+	{
+		MyHasher hasher;
+		return hasher(key);
+	}
+
+	// Never dereferenced, only compared with
+	Node* getTombstone() const { return reinterpret_cast<Node*>(const_cast<char*>(&mTombstone)); }
+
+	bool isNode(const Node* node) const { return node != 0 && node != getTombstone(); }
+
+	// Next slot in the probe sequence, same as HashTableProbed's
+	static size_t probeNext(size_t index, size_t allocated)
+	{
+		index += cIncBy;
+		while (index >= allocated)
+			index -= allocated;
+		return index;
+	}
+
+	// The reader side, called inside an epoch
+	const Node* findNode(const Key& key) const
+	{
+		const Array* array = mArray.load(std::memory_order_acquire);
+		size_t hashValue = hash(key);
+		size_t start = mGrower.getIndexFromHash(hashValue, array->allocated, array->magic);
+		size_t index = start;
+
+		// An empty slot ends the probe chain, tombstones don't.
+		do
+		{
+			const Node* node = array->slots[index].load(std::memory_order_acquire);
+			if (node == 0)
+				return 0;
+			if (node != getTombstone() && node->hashValue == hashValue && node->value.first == key)
+				return node;
+			index = probeNext(index, array->allocated);
+		} while (index != start);
+		return 0;
+	}
+
+	// Returns the slot index of key in array, or array->allocated if it's
+	// not stored. freeIndex is set to the first slot not in use in its
+	// probe sequence, array->allocated if there's none. Writer only.
+	size_t probeForInsert(const Array* array, const Key& key, size_t hashValue, size_t& freeIndex) const
+	{
+		size_t start = mGrower.getIndexFromHash(hashValue, array->allocated, array->magic);
+		size_t index = start;
+		freeIndex = array->allocated;
+
+		do
+		{
+			const Node* node = array->slots[index].load(std::memory_order_relaxed);
+			if (node == 0)
+			{
+				if (freeIndex == array->allocated)
+					freeIndex = index;
+				break;
+			}
+			if (node == getTombstone())
+			{
+				if (freeIndex == array->allocated)
+					freeIndex = index;
+			}
+			else if (node->hashValue == hashValue && node->value.first == key)
+			{
+				return index;
+			}
+			index = probeNext(index, array->allocated);
+		} while (index != start);
+		return array->allocated;
+	}
+
+	// Shared by insert() and insert_or_assign()
+	bool store(const Key& key, const Value& value, bool assign)
+	{
+		Array* array = getArray();
+		size_t hashValue = hash(key);
+		size_t freeIndex;
+		size_t index = probeForInsert(array, key, hashValue, freeIndex);
+		if (index != array->allocated)
+		{
+			if (assign)
+			{
+				Node* node = array->slots[index].load(std::memory_order_relaxed);
+				array->slots[index].store(new Node(key, value, hashValue), std::memory_order_release);
+				mReclaimer.retire(node);
+			}
+			return false;
+		}
+
+		size_t newAlloc = mGrower.getNewSize(array->allocated, mFreeSlots);
+		if (newAlloc > array->allocated || freeIndex == array->allocated)
+		{
+			// If getting rid of the tombstones frees enough slots there's
+			// no need to grow, just clean up
+			if (newAlloc <= array->allocated || mGrower.getNewSize(array->allocated, mFreeSlots + mDeleted) <= array->allocated)
+				newAlloc = array->allocated;
+			array = rehashTo(newAlloc);
+			probeForInsert(array, key, hashValue, freeIndex);
+			if (freeIndex == array->allocated)
+				throw "Failed to insert";
+		}
+
+		if (array->slots[freeIndex].load(std::memory_order_relaxed) == 0)
+			mFreeSlots--;
+		else
+			mDeleted--;
+		array->slots[freeIndex].store(new Node(key, value, hashValue), std::memory_order_release);
+		mSize.store(mSize.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Builds a new array with the nodes of the current one, no tombstones,
+	// and publishes it. Readers already in the old one finish there.
+	Array* rehashTo(size_t newAlloc)
+	{
+		Array* array = getArray();
+		Array* newArray = new Array(newAlloc, mGrower);
+		size_t used = 0;
+
+		for (size_t i=0;i<array->allocated;++i)
+		{
+			Node* node = array->slots[i].load(std::memory_order_relaxed);
+			if (!isNode(node))
+				continue;
+
+			size_t index = mGrower.getIndexFromHash(node->hashValue, newAlloc, newArray->magic);
+			while (newArray->slots[index].load(std::memory_order_relaxed) != 0)
+			{
+				index = probeNext(index, newAlloc);
+			}
+			newArray->slots[index].store(node, std::memory_order_relaxed);
+			used++;
+		}
+
+		mArray.store(newArray, std::memory_order_release);
+		mFreeSlots = newAlloc - used;
+		mDeleted = 0;
+
+		mReclaimer.retire(array);
+		return newArray;
+	}
+
+	//------------------------------------------------------------------
+	// Private Constants
+	//------------------------------------------------------------------
+	enum { cIncBy = 7 };
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	std::atomic<Array*> mArray;	// The current array, published with release stores
+	std::atomic<size_t> mSize;	// Written by the writer only
+
+	// Writer only, guarded by mWriteMutex
+	size_t	mFreeSlots; // Empty slots, not counting tombstones
+	size_t	mDeleted;	// Tombstones
+
+	MyGrower mGrower;
+	mutable EpochReclaimer mReclaimer;
+	std::mutex mWriteMutex;
+	char mTombstone; // Its address marks erased slots
+};
+
+#endif // !defined(READMOSTLYHASHTABLE_H)
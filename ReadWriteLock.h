@@ -0,0 +1,182 @@
+/*=====================================================================
+	ReadWriteLock.h - Reader-writer lock
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		class ReadWriteLock
+
+		// Lock for the lifetime of the object
+		class ReadLocker
+		class WriteLocker
+
+  Requirements:
+		Windows Vista or later (slim reader-writer locks), or pthreads.
+
+  Dependencies:
+		<windows.h> or <pthread.h>
+
+=====================================================================*/
+#if !defined(READWRITELOCK_H)
+#define READWRITELOCK_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+//------------------------------------------------------------------------
+// ReadWriteLock
+// Any number of readers, or one writer. Not recursive, a thread holding
+// the lock must not lock it again. Where the platform lets us choose
+// (glibc) waiting writers go before new readers, so a steady stream of
+// lookups can't keep an insert waiting forever.
+class ReadWriteLock
+{
+public:
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	ReadWriteLock()
+	{
+#if defined(_WIN32)
+		InitializeSRWLock(&mLock);
+#else
+		pthread_rwlockattr_t attributes;
+		pthread_rwlockattr_init(&attributes);
+#if defined(__GLIBC__)
+		pthread_rwlockattr_setkind_np(&attributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+		int result = pthread_rwlock_init(&mLock, &attributes);
+		pthread_rwlockattr_destroy(&attributes);
+		if (result != 0)
+			throw "Failed to create lock";
+#endif
+	}
+
+	~ReadWriteLock()
+	{
+#if !defined(_WIN32)
+		pthread_rwlock_destroy(&mLock);
+#endif
+	}
+
+	//------------------------------------------------------------------
+	// Public Commands
+	//------------------------------------------------------------------
+	void lockRead()
+	{
+#if defined(_WIN32)
+		AcquireSRWLockShared(&mLock);
+#else
+		pthread_rwlock_rdlock(&mLock);
+#endif
+	}
+
+	void unlockRead()
+	{
+#if defined(_WIN32)
+		ReleaseSRWLockShared(&mLock);
+#else
+		pthread_rwlock_unlock(&mLock);
+#endif
+	}
+
+	void lockWrite()
+	{
+#if defined(_WIN32)
+		AcquireSRWLockExclusive(&mLock);
+#else
+		pthread_rwlock_wrlock(&mLock);
+#endif
+	}
+
+	void unlockWrite()
+	{
+#if defined(_WIN32)
+		ReleaseSRWLockExclusive(&mLock);
+#else
+		pthread_rwlock_unlock(&mLock);
+#endif
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	ReadWriteLock(const ReadWriteLock&);
+
+	// Assignment operator
+	ReadWriteLock& operator = (const ReadWriteLock&);
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+#if defined(_WIN32)
+	SRWLOCK mLock;
+#else
+	pthread_rwlock_t mLock;
+#endif
+};
+
+//------------------------------------------------------------------------
+// ReadLocker
+// Holds lock for reading until it goes out of scope, also when an
+// exception passes.
+class ReadLocker
+{
+public:
+	explicit ReadLocker(ReadWriteLock& lock):mLock(lock)
+	{
+		mLock.lockRead();
+	}
+
+	~ReadLocker()
+	{
+		mLock.unlockRead();
+	}
+
+private:
+	// Disabled
+	ReadLocker(const ReadLocker&);
+	ReadLocker& operator = (const ReadLocker&);
+
+	ReadWriteLock& mLock;
+};
+
+//------------------------------------------------------------------------
+// WriteLocker
+// Same as above, for writing.
+class WriteLocker
+{
+public:
+	explicit WriteLocker(ReadWriteLock& lock):mLock(lock)
+	{
+		mLock.lockWrite();
+	}
+
+	~WriteLocker()
+	{
+		mLock.unlockWrite();
+	}
+
+private:
+	// Disabled
+	WriteLocker(const WriteLocker&);
+	WriteLocker& operator = (const WriteLocker&);
+
+	ReadWriteLock& mLock;
+};
+
+#endif // !defined(READWRITELOCK_H)
@@ -1,387 +1,1902 @@
-/*=====================================================================
-	TestHash.cpp - Console application to test that the various 
-	HashTables work as expected.
-
-	Author: Per Nilsson
-
-	Freeware and no copyright on my behalf. However, if you use the 
-	code in some manner	I'd appreciate a notification about it
-	perfnurt@hotmail.com
-
-====================================================================*/
-
-#include "stdafx.h"
-
-//--------------------------------------------------
-// Only needs to be included if you want to use the 
-// template's defaults
-#include "GenericHashers.h" 
-#include "DefaultGrower.h"
-//--------------------------------------------------
-#include "HashTableChained.h"
-#include "HashTableProbed.h"
-
-#include <string>
-
-#ifdef _DEBUG
-#define new DEBUG_NEW
-#undef THIS_FILE
-static char THIS_FILE[] = __FILE__;
-#endif
-
-/////////////////////////////////////////////////////////////////////////////
-// The one and only application object
-
-CWinApp theApp;
-
-// Forward declarations
-void test();
-
-//-----------------------------------------------------------------------
-// A <CString> Hasher that reuses the generic const char* hasher
-// Note that HashTableChained.h has no idea that there's something called CString
-// but it works anyway :-).
-// Won't work in UNICODE though (in that case you could modify it to transform the chars to w_chars)
-class Hasher<CString>
-{
-public:
-	size_t operator ()(const CString& key, size_t size)
-	{
-		Hasher<const char*> stringHasher;
-		return stringHasher((LPCTSTR)key, size);
-	}
-};
-
-//-----------------------------------------------------------------------
-// A Second <CString> hasher. Used when the chaining table is using another
-// hash table. We dont want them to use exactly the same hash algorithm
-// as they'd then always get conflicts for the same Key.
-// Note that a hasher can be any class, it doesn't have to be
-// a Hasher<Key> template. Just as long as it has the expected
-// () operator
-class SecondStringHasher
-{
-public:
-	size_t operator ()(const CString& key, size_t size)
-	{
-		Hasher<const char*> stringHasher;
-		CString keyReversed(key);
-		keyReversed.MakeReverse();
-		return stringHasher((LPCTSTR)keyReversed, size);
-	}
-};
-
-//-----------------------------------------------------------------------
-// A <std::string> Hasher that reuses the generic const char* hasher
-class Hasher<std::string>
-{
-public:
-	size_t operator ()(const std::string& key, size_t size)
-	{
-		Hasher<const char*> stringHasher;
-		return stringHasher(key.c_str(), size);
-	}
-};
-
-//-----------------------------------------------------------------------
-// Main entry of console application.
-int _tmain(int argc, TCHAR* argv[], TCHAR* envp[])
-{
-	int nRetCode = 0;
-
-	// initialize MFC and print and error on failure
-	if (!AfxWinInit(::GetModuleHandle(NULL), NULL, ::GetCommandLine(), 0))
-	{
-		// TODO: change error code to suit your needs
-		std::cerr << _T("Fatal Error: MFC initialization failed") << std::endl;
-		nRetCode = 1;
-	}
-	else
-	{
-		test();
-	}
-		
-	return nRetCode;
-}
-
-// ---------------------- Macros for testing some code  ---------------------
-// BEGIN_TEST: Setup some internal test variables.
-#define BEGIN_TEST int test_count__=0; int test_failed__=0; 
-// TEST(b): Test the boolean expression b.
-#define TEST(b) { \
-					bool test_result__ = b; \
-					if (!test_result__)\
-					{\
-					  std::cout << "\nTEST(" << #b << ") failed. Line " << __LINE__ << "\n";\
-					  test_failed__++;\
-					}\
-					test_count__++; \
-				}
-
-// END_TEST: Display summary of test result.
-#define END_TEST std::cout << "\nFinished. " << test_count__ << " tests. ";(test_failed__==0 ? std::cout << "All OK!\n" : std::cout << test_failed__ << " failed\n");
-// ---------------------------------------------------------------------------
-
-//-----------------------------------------------------------------------
-// Runs the tests...
-void test()
-{
-	const int cItems = 2000;
-
-	BEGIN_TEST;
-	{
-		std::cout << "Testing HashTableChained<CString, int>..." << std::endl;
-		HashTableChained<CString, int> ht(0); // Initialize to 0 to enforce rehashing (just for test). 
-
-		TEST(ht.size() == 0);
-		ht["ACDC"] = 42;
-		TEST(ht.size() == 1);
-		ht["Ozzy"] = 12;
-		ht["Metallica"] = 23;
-		ht["Toy Dolls"] = 90;
-		ht["Toy Dolls"] = 40;
-		TEST(ht.size() == 4);
-
-		TEST(ht["ACDC"] == 42);
-		TEST(ht["Ozzy"] == 12);
-		TEST(ht["Metallica"] == 23);
-		TEST(ht["Toy Dolls"] == 40);
-
-		TEST(ht.insert("Judas Priest",34));
-		TEST(!ht.insert("Judas Priest",44));
-		TEST(ht["Judas Priest"] == 34);
-	}
-	{
-		std::cout << "Testing HashTableChained<int, int>..." << std::endl;
-		HashTableChained<int, int> ht(0);
-		int i=0;
-		{
-			for (HashTableChained<int, int>::iterator it=ht.begin();it!=ht.end();++it)
-			{
-				i++;
-			}
-			TEST(i==0);
-		}
-
-		for (i=0;i<cItems;++i)
-		{
-			TEST(ht.insert(i,i));
-		}
-
-		// size() returns number of items in the hash table, not the allocated array size, that's
-		// something internal only the hash table (and possibly its iterators) should care about
-		TEST(ht.size() == cItems);
-
-		for (i=0;i<cItems;++i)
-		{
-			TEST(ht[i] == i);
-		}
-
-		i=0;
-		std::cout << "Testing HashTableChained<int, int>::iterator..." << std::endl;
-		{
-			for (HashTableChained<int, int>::iterator it=ht.begin();it!=ht.end();++it)
-			{
-				i++;
-			}
-		}
-		TEST(i==cItems);
-		TEST((*ht.find(456)).second == 456);
-		std::cout << "Testing HashTableChained<int, int>::const_iterator..." << std::endl;
-		{
-			const HashTableChained<int, int>& cht=ht;
-			i=0;
-			for (HashTableChained<int, int>::const_iterator cit=cht.begin();cit!=cht.end();++cit)
-			{
-				i++;
-			}
-			TEST(i==cItems);
-			TEST((*cht.find(123)).second == 123);
-		}
-		std::cout << "Testing HashTableChained<int, int>::erase..." << std::endl;
-		TEST(ht.erase(123) == 1);
-		TEST(ht.find(123) == ht.end());
-		TEST(ht.erase(123) == 0);
-
-	}
-	{
-		std::cout << "Testing HashTableProbed<int, int>..." << std::endl;
-		HashTableProbed<int, int> ht(0);
-		for (int i=0;i<cItems;++i)
-		{
-			TEST(ht.insert(i,i));
-		}
-		TEST(ht.size() == cItems);
-
-		for (i=0;i<cItems;++i)
-		{
-			TEST(ht[i] == i);
-		}
-
-		std::cout << "Testing HashTableProbed<int, int>::iterator..." << std::endl;
-		i = 0;
-		for (HashTableProbed<int, int>::iterator it=ht.begin();it!=ht.end();++it)
-		{
-			i++;
-		}
-		TEST(i==cItems);
-		TEST((*ht.find(456)).second == 456);
-
-		std::cout << "Testing HashTableProbed<int, int>::const_iterator..." << std::endl;
-		{
-			const HashTableProbed<int, int>& cht = ht;
-			i = 0;
-			for (HashTableProbed<int, int>::const_iterator cit=cht.begin();cit!=cht.end();++cit)
-			{
-				i++;
-			}
-			TEST(i==cItems);
-			TEST((*cht.find(634)).second == 634);
-
-		}
-	}
-	{
-		std::cout << "Testing HashTableProbed<int, int>::erase..." << std::endl;
-		HashTableProbed<int, int> ht(0);
-		ht.insert(0,0);
-		ht.insert(1,1);
-		ht.insert(2,2);
-		
-		TEST(ht.size() == 3);
-		TEST( ht.erase(1) == 1);
-		TEST(ht.size() == 2);
-
-		TEST((*ht.find(0)).second == 0);
-		TEST(ht.find(1) == ht.end());
-		TEST((*ht.find(2)).second == 2);
-
-		TEST( ht.erase(1) == 0);
-
-	}
-
-	{
-		std::cout << "Testing HashTableChained<..., Collection = HashTableProbed>..." << std::endl;
-		typedef HashTableProbed<CString, int, SecondStringHasher, DefaultGrower> MyProbed;
-		HashTableChained<CString, int, Hasher<CString>, DefaultGrower, MyProbed> ht(0);
-		TEST(ht.size() == 0);
-		ht["ACDC"] = 42;
-		TEST(ht.size() == 1);
-		ht["Ozzy"] = 12;
-		ht["Metallica"] = 23;
-		ht["Toy Dolls"] = 90;
-		ht["Toy Dolls"] = 40;
-		TEST(ht.size() == 4);
-
-		TEST(ht["ACDC"] == 42);
-		TEST(ht["Ozzy"] == 12);
-		TEST(ht["Metallica"] == 23);
-		TEST(ht["Toy Dolls"] == 40);
-
-		ht.insert("Kiss", 12);
-		ht.insert("Iron Maiden", 12);
-		ht.insert("Rainbow", 12);
-	}
-	{
-		std::cout << "Testing HashTableChained<..., Collection = HashTableProbed>::iterator..." << std::endl;
-
-		typedef HashTableProbed<int, int> MyProbed;
-		typedef HashTableChained<int, int, Hasher<int>, DefaultGrower, MyProbed> MyChained;
-		MyChained ht(0);
-		for (int i=0;i<cItems;++i)
-		{
-			TEST(ht.insert(i,i));
-		}
-		TEST(ht.size() == cItems);
-
-		for (i=0;i<cItems;++i)
-		{
-			TEST(ht[i] == i);
-		}
-
-		i=0;
-		for (MyChained::iterator it=ht.begin();it!=ht.end();++it)
-		{
-			i++;
-		}
-		TEST(i==cItems);
-		std::cout << "Testing HashTableChained<..., Collection = HashTableProbed>::const_iterator..." << std::endl;
-		{
-			const MyChained& cht = ht;
-			i=0;
-			for (MyChained::const_iterator it=cht.begin();it!=cht.end();++it)
-			{
-				i++;
-			}
-			TEST(i==cItems);
-
-		}
-
-	}
-
-	{
-		std::cout << "Testing HashTableChained<..., Collection = HashTableChained>..." << std::endl;
-
-		typedef HashTableChained<CString, int, SecondStringHasher, DefaultGrower> MyChained2; // Uses default Collection, ie std::map
-		typedef HashTableChained<CString, int, Hasher<CString>, DefaultGrower, MyChained2> MyChained;
-		MyChained ht(0);
-		TEST(ht.size() == 0);
-		ht["ACDC"] = 42;
-		TEST(ht.size() == 1);
-		ht["Ozzy"] = 12;
-		ht["Metallica"] = 23;
-		ht["Toy Dolls"] = 90;
-		ht["Toy Dolls"] = 40;
-		TEST(ht.size() == 4);
-
-		TEST(ht["ACDC"] == 42);
-		TEST(ht["Ozzy"] == 12);
-		TEST(ht["Metallica"] == 23);
-		TEST(ht["Toy Dolls"] == 40);
-
-		TEST(ht.insert("Kiss", 12));
-		TEST(ht.insert("Iron Maiden", 12));
-		TEST(ht.insert("Rainbow", 12));
-		TEST(!ht.insert("Rainbow", 23));
-		TEST(ht["Rainbow"] == 12);
-
-	}
-
-	{
-		std::cout << "Testing HashTableChained<..., Collection = HashTableChained>::iterator..." << std::endl;
-		typedef HashTableChained<int, int> MyChained2;
-		typedef HashTableChained<int, int, Hasher<int>, DefaultGrower, MyChained2> MyChained;
-		MyChained ht(0);
-		for (int i=0;i<cItems;++i)
-		{
-			TEST(ht.insert(i,i));
-		}
-
-		TEST(ht.size() == cItems);
-		for (i=0;i<cItems;++i)
-		{
-			TEST(ht[i] == i);
-		}
-
-		i=0;
-		for (MyChained::iterator it=ht.begin();it!=ht.end();++it)
-		{
-			i++;
-		}
-		TEST(i==cItems);
-		std::cout << "Testing HashTableChained<..., Collection = HashTableChained>::const_iterator..." << std::endl;
-		{
-			const MyChained& cht = ht;
-			i=0;
-			for (MyChained::const_iterator it=cht.begin();it!=cht.end();++it)
-			{
-				i++;
-			}
-			TEST(i==cItems);
-
-		}
-	}
-	END_TEST;
-	char ch; 
-	std::cout << "Press <Enter>";
-	std::cin.getline(&ch,1);
+/*=====================================================================
+	TestHash.cpp - Console application to test that the various 
+	HashTables work as expected.
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the 
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+====================================================================*/
+
+#include "stdafx.h"
+
+//--------------------------------------------------
+// Only needs to be included if you want to use the 
+// template's defaults
+#include "GenericHashers.h" 
+#include "DefaultGrower.h"
+#include "PowerOfTwoGrower.h"
+//--------------------------------------------------
+#include "HashTableChained.h"
+#include "HashTableProbed.h"
+#include "HashTableSwiss.h"
+#include "HashTableRobinHood.h"
+#include "ConcurrentHashTable.h"
+#include "ReadMostlyHashTable.h"
+#include "InsertOnlyHashTable.h"
+#include "HashTableSnapshot.h"
+#include "HashTableLoader.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdio.h> // sprintf
+#include <string.h> // strlen
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+// The one and only application object
+
+CWinApp theApp;
+
+// Forward declarations
+void test();
+
+//-----------------------------------------------------------------------
+// A <CString> Hasher that reuses the generic const char* hasher
+// Note that HashTableChained.h has no idea that there's something called CString
+// but it works anyway :-).
+// Won't work in UNICODE though (in that case you could modify it to transform the chars to w_chars)
+class Hasher<CString>
+{
+public:
+	size_t operator ()(const CString& key, size_t size)
+	{
+		Hasher<const char*> stringHasher;
+		return stringHasher((LPCTSTR)key, size);
+	}
+
+	// Full width version, used by HashTableSwiss and the growers
+	size_t operator ()(const CString& key)
+	{
+		Hasher<const char*> stringHasher;
+		return stringHasher((LPCTSTR)key);
+	}
+};
+
+//-----------------------------------------------------------------------
+// A Second <CString> hasher. Used when the chaining table is using another
+// hash table. We dont want them to use exactly the same hash algorithm
+// as they'd then always get conflicts for the same Key.
+// Note that a hasher can be any class, it doesn't have to be
+// a Hasher<Key> template. Just as long as it has the expected
+// () operators
+class SecondStringHasher
+{
+public:
+	size_t operator ()(const CString& key, size_t size)
+	{
+		Hasher<const char*> stringHasher;
+		CString keyReversed(key);
+		keyReversed.MakeReverse();
+		return stringHasher((LPCTSTR)keyReversed, size);
+	}
+
+	size_t operator ()(const CString& key)
+	{
+		Hasher<const char*> stringHasher;
+		CString keyReversed(key);
+		keyReversed.MakeReverse();
+		return stringHasher((LPCTSTR)keyReversed);
+	}
+};
+
+//-----------------------------------------------------------------------
+// A <std::string> Hasher that reuses the generic const char* hasher
+class Hasher<std::string>
+{
+public:
+	size_t operator ()(const std::string& key, size_t size)
+	{
+		Hasher<const char*> stringHasher;
+		return stringHasher(key.c_str(), size);
+	}
+
+	size_t operator ()(const std::string& key)
+	{
+		Hasher<const char*> stringHasher;
+		return stringHasher(key.c_str());
+	}
+};
+
+//-----------------------------------------------------------------------
+// A <std::string> Hasher that counts how many times it has been called
+class CountingStringHasher
+{
+public:
+	size_t operator ()(const std::string& key, size_t size)
+	{
+		return (*this)(key) % size;
+	}
+
+	size_t operator ()(const std::string& key)
+	{
+		sCalls++;
+		Hasher<const char*> stringHasher;
+		return stringHasher(key.c_str());
+	}
+
+	static int sCalls;
+};
+int CountingStringHasher::sCalls = 0;
+
+//-----------------------------------------------------------------------
+// Visitors for ConcurrentHashTable<int, int>
+class CopyValue
+{
+public:
+	explicit CopyValue(int* value):mValue(value) {}
+
+	void operator ()(const std::pair<int, int>& vt) const
+	{
+		*mValue = vt.second;
+	}
+
+private:
+	int* mValue;
+};
+
+class AddToValue
+{
+public:
+	explicit AddToValue(int add):mAdd(add) {}
+
+	void operator ()(std::pair<int, int>& vt) const
+	{
+		vt.second += mAdd;
+	}
+
+private:
+	int mAdd;
+};
+
+class SumValues
+{
+public:
+	SumValues():mSum(0) {}
+
+	void operator ()(const std::pair<int, int>& vt)
+	{
+		mSum += vt.second;
+	}
+
+	int mSum;
+};
+
+//-----------------------------------------------------------------------
+// A value that counts its instances, to see that replaced elements are
+// deleted
+class CountedValue
+{
+public:
+	CountedValue(int value=0):mValue(value) { sCount++; }
+	CountedValue(const CountedValue& src):mValue(src.mValue) { sCount++; }
+	~CountedValue() { sCount--; }
+
+	CountedValue& operator = (const CountedValue& src)
+	{
+		mValue = src.mValue;
+		return *this;
+	}
+
+	int mValue;
+	static int sCount;
+};
+int CountedValue::sCount = 0;
+
+//-----------------------------------------------------------------------
+// parallelFor() task that marks its index, and throws for one of them
+class MarkTask
+{
+public:
+	MarkTask(std::vector<int>* marks, size_t throwAt):mMarks(marks), mThrowAt(throwAt) {}
+
+	void operator ()(size_t index) const
+	{
+		(*mMarks)[index]++;
+		if (index == mThrowAt)
+			throw "MarkTask";
+	}
+
+private:
+	std::vector<int>* mMarks;
+	size_t mThrowAt;
+};
+
+//-----------------------------------------------------------------------
+// Visitor that replaces the element it visits, while still looking at it
+class ReplaceWhileVisiting
+{
+public:
+	typedef ReadMostlyHashTable<int, CountedValue> Table;
+
+	ReplaceWhileVisiting(Table* ht, int* value, int* count):mHT(ht), mValue(value), mCount(count) {}
+
+	void operator ()(const std::pair<int, CountedValue>& vt) const
+	{
+		for (int i=0;i<100;++i)
+		{
+			mHT->insert_or_assign(vt.first, CountedValue(-1));
+		}
+		*mValue = vt.second.mValue;
+		*mCount = CountedValue::sCount;
+	}
+
+private:
+	Table* mHT;
+	int* mValue;
+	int* mCount;
+};
+
+//-----------------------------------------------------------------------
+// Main entry of console application.
+int _tmain(int argc, TCHAR* argv[], TCHAR* envp[])
+{
+	int nRetCode = 0;
+
+	// initialize MFC and print and error on failure
+	if (!AfxWinInit(::GetModuleHandle(NULL), NULL, ::GetCommandLine(), 0))
+	{
+		// TODO: change error code to suit your needs
+		std::cerr << _T("Fatal Error: MFC initialization failed") << std::endl;
+		nRetCode = 1;
+	}
+	else
+	{
+		test();
+	}
+		
+	return nRetCode;
+}
+
+// ---------------------- Macros for testing some code  ---------------------
+// BEGIN_TEST: Setup some internal test variables.
+#define BEGIN_TEST int test_count__=0; int test_failed__=0; 
+// TEST(b): Test the boolean expression b.
+#define TEST(b) { \
+					bool test_result__ = b; \
+					if (!test_result__)\
+					{\
+					  std::cout << "\nTEST(" << #b << ") failed. Line " << __LINE__ << "\n";\
+					  test_failed__++;\
+					}\
+					test_count__++; \
+				}
+
+// END_TEST: Display summary of test result.
+#define END_TEST std::cout << "\nFinished. " << test_count__ << " tests. ";(test_failed__==0 ? std::cout << "All OK!\n" : std::cout << test_failed__ << " failed\n");
+// ---------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+// Runs the tests...
+void test()
+{
+	const int cItems = 2000;
+
+	BEGIN_TEST;
+	{
+		std::cout << "Testing HashTableChained<CString, int>..." << std::endl;
+		HashTableChained<CString, int> ht(0); // Initialize to 0 to enforce rehashing (just for test). 
+
+		TEST(ht.size() == 0);
+		ht["ACDC"] = 42;
+		TEST(ht.size() == 1);
+		ht["Ozzy"] = 12;
+		ht["Metallica"] = 23;
+		ht["Toy Dolls"] = 90;
+		ht["Toy Dolls"] = 40;
+		TEST(ht.size() == 4);
+
+		TEST(ht["ACDC"] == 42);
+		TEST(ht["Ozzy"] == 12);
+		TEST(ht["Metallica"] == 23);
+		TEST(ht["Toy Dolls"] == 40);
+
+		TEST(ht.insert("Judas Priest",34));
+		TEST(!ht.insert("Judas Priest",44));
+		TEST(ht["Judas Priest"] == 34);
+	}
+	{
+		std::cout << "Testing HashTableChained<int, int>..." << std::endl;
+		HashTableChained<int, int> ht(0);
+		int i=0;
+		{
+			for (HashTableChained<int, int>::iterator it=ht.begin();it!=ht.end();++it)
+			{
+				i++;
+			}
+			TEST(i==0);
+		}
+
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+
+		// size() returns number of items in the hash table, not the allocated array size, that's
+		// something internal only the hash table (and possibly its iterators) should care about
+		TEST(ht.size() == cItems);
+
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+		}
+
+		i=0;
+		std::cout << "Testing HashTableChained<int, int>::iterator..." << std::endl;
+		{
+			for (HashTableChained<int, int>::iterator it=ht.begin();it!=ht.end();++it)
+			{
+				i++;
+			}
+		}
+		TEST(i==cItems);
+		TEST((*ht.find(456)).second == 456);
+		std::cout << "Testing HashTableChained<int, int>::const_iterator..." << std::endl;
+		{
+			const HashTableChained<int, int>& cht=ht;
+			i=0;
+			for (HashTableChained<int, int>::const_iterator cit=cht.begin();cit!=cht.end();++cit)
+			{
+				i++;
+			}
+			TEST(i==cItems);
+			TEST((*cht.find(123)).second == 123);
+		}
+		std::cout << "Testing HashTableChained<int, int>::erase..." << std::endl;
+		TEST(ht.erase(123) == 1);
+		TEST(ht.find(123) == ht.end());
+		TEST(ht.erase(123) == 0);
+
+	}
+	{
+		std::cout << "Testing HashTableProbed<int, int>..." << std::endl;
+		HashTableProbed<int, int> ht(0);
+		for (int i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		TEST(ht.size() == cItems);
+
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+		}
+
+		std::cout << "Testing HashTableProbed<int, int>::iterator..." << std::endl;
+		i = 0;
+		for (HashTableProbed<int, int>::iterator it=ht.begin();it!=ht.end();++it)
+		{
+			i++;
+		}
+		TEST(i==cItems);
+		TEST((*ht.find(456)).second == 456);
+
+		std::cout << "Testing HashTableProbed<int, int>::const_iterator..." << std::endl;
+		{
+			const HashTableProbed<int, int>& cht = ht;
+			i = 0;
+			for (HashTableProbed<int, int>::const_iterator cit=cht.begin();cit!=cht.end();++cit)
+			{
+				i++;
+			}
+			TEST(i==cItems);
+			TEST((*cht.find(634)).second == 634);
+
+		}
+	}
+	{
+		std::cout << "Testing HashTableProbed<int, int>::erase..." << std::endl;
+		HashTableProbed<int, int> ht(0);
+		ht.insert(0,0);
+		ht.insert(1,1);
+		ht.insert(2,2);
+		
+		TEST(ht.size() == 3);
+		TEST( ht.erase(1) == 1);
+		TEST(ht.size() == 2);
+
+		TEST((*ht.find(0)).second == 0);
+		TEST(ht.find(1) == ht.end());
+		TEST((*ht.find(2)).second == 2);
+
+		TEST( ht.erase(1) == 0);
+
+	}
+	{
+		std::cout << "Testing HashTableProbed<int, int> erase/insert cycles..." << std::endl;
+		// A sliding window of live keys leaves lots of tombstones behind, those
+		// should get cleaned up instead of making the array grow.
+		HashTableProbed<int, int> ht(0);
+		const int cWindow = 100;
+		int i;
+		for (i=0;i<cItems*10;++i)
+		{
+			TEST(ht.insert(i,i));
+			if (i>=cWindow)
+			{
+				TEST(ht.erase(i-cWindow) == 1);
+			}
+		}
+		TEST(ht.size() == cWindow);
+		TEST(ht.getAllocated() <= 1009);
+		for (i=0;i<cItems*10-cWindow;++i)
+		{
+			TEST(ht.find(i) == ht.end());
+		}
+		for (;i<cItems*10;++i)
+		{
+			TEST((*ht.find(i)).second == i);
+		}
+	}
+	{
+		std::cout << "Testing HashTableProbed<std::string, std::string>..." << std::endl;
+		// Elements are stored in place, make sure non trivial types survive rehashing and erase
+		HashTableProbed<std::string, std::string> ht(0);
+		char buf[32];
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			sprintf(buf, "%d", i);
+			TEST(ht.insert(buf, std::string("Value ") + buf));
+		}
+		TEST(ht.size() == cItems);
+		TEST((*ht.find("1234")).second == "Value 1234");
+		TEST(ht.erase("1234") == 1);
+		TEST(ht.find("1234") == ht.end());
+		TEST((*ht.find("1235")).second == "Value 1235");
+		ht.clear();
+		TEST(ht.size() == 0);
+	}
+
+	{
+		std::cout << "Testing DefaultGrower..." << std::endl;
+		DefaultGrower grower;
+		size_t size = 0;
+		int i;
+		// Way past the old limit of 500009
+		for (i=0;i<25;++i)
+		{
+			size_t newSize = grower.getPrimeGreaterThan(size);
+			TEST(newSize > size);
+			TEST(grower.getPrimeGreaterThan(newSize-1) == newSize);
+			size = newSize;
+
+			// The reciprocal must give the same slots as a modulo
+			size_t magic = grower.getMagic(size);
+			TEST(magic != 0);
+			size_t hashValue = 0x9e3779b9u;
+			for (int j=0;j<20;++j)
+			{
+				TEST(grower.getIndexFromHash(hashValue, size, magic) == hashValue % size);
+				hashValue = hashValue * 69069 + 1;
+			}
+			TEST(grower.getIndexFromHash(~size_t(0), size, magic) == ~size_t(0) % size);
+		}
+		TEST(size > 500009);
+		TEST(grower.getNewSize(size, size/2) == size);
+		TEST(grower.getNewSize(size, size/20) > size);
+		// Sizes that aren't the grower's primes still work
+		TEST(grower.getMagic(1000) == 0);
+		TEST(grower.getIndexFromHash(12345, 1000, grower.getMagic(1000)) == 345);
+	}
+	{
+		std::cout << "Testing HashTableProbed<int, int, ..., PowerOfTwoGrower>..." << std::endl;
+		typedef HashTableProbed<int, int, Hasher<int>, PowerOfTwoGrower> MyProbed;
+		MyProbed ht(0);
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		TEST(ht.size() == cItems);
+		TEST((ht.getAllocated() & (ht.getAllocated()-1)) == 0);
+
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+		}
+		TEST(ht.find(cItems) == ht.end());
+		TEST(ht.erase(123) == 1);
+		TEST(ht.find(123) == ht.end());
+
+		i = 0;
+		for (MyProbed::iterator it=ht.begin();it!=ht.end();++it)
+		{
+			i++;
+		}
+		TEST(i==cItems-1);
+
+		// Growing from no array at all
+		PowerOfTwoGrower grower;
+		TEST(grower.getNewSize(0, 0) == 8);
+		TEST(grower.getNewSize(8, 8) == 8);
+		TEST(grower.getNewSize(8, 0) == 16);
+	}
+	{
+		std::cout << "Testing HashTableChained<CString, int, ..., PowerOfTwoGrower>..." << std::endl;
+		HashTableChained<CString, int, Hasher<CString>, PowerOfTwoGrower> ht(0);
+		ht["ACDC"] = 42;
+		ht["Ozzy"] = 12;
+		ht["Toy Dolls"] = 90;
+		ht["Toy Dolls"] = 40;
+		TEST(ht.size() == 3);
+		TEST(ht["ACDC"] == 42);
+		TEST(ht["Toy Dolls"] == 40);
+		TEST(ht.find("Metallica") == ht.end());
+	}
+	{
+		std::cout << "Testing HashTableProbed<..., HashCache>..." << std::endl;
+		// With cached hash values growing the table doesn't hash the keys
+		// again, ie the hasher is only called by insert() and find().
+		typedef HashTableProbed<std::string, int, CountingStringHasher, DefaultGrower, HashCache> MyProbed;
+		MyProbed ht(0);
+		char buf[32];
+		int i;
+		CountingStringHasher::sCalls = 0;
+		for (i=0;i<cItems;++i)
+		{
+			sprintf(buf, "Key number %d", i);
+			TEST(ht.insert(buf,i));
+		}
+		TEST(CountingStringHasher::sCalls <= 2*cItems);
+		TEST(ht.size() == cItems);
+
+		for (i=0;i<cItems;++i)
+		{
+			sprintf(buf, "Key number %d", i);
+			TEST(ht[buf] == i);
+		}
+		TEST(ht.find("Key number") == ht.end());
+		TEST(ht.erase("Key number 5") == 1);
+		TEST(ht.find("Key number 5") == ht.end());
+
+		typedef HashTableProbed<std::string, int, CountingStringHasher, PowerOfTwoGrower, HashCache> MyProbed2;
+		MyProbed2 ht2(0);
+		for (i=0;i<cItems;++i)
+		{
+			sprintf(buf, "Key number %d", i);
+			TEST(ht2.insert(buf,i));
+		}
+		for (i=0;i<cItems;++i)
+		{
+			sprintf(buf, "Key number %d", i);
+			TEST(ht2[buf] == i);
+		}
+	}
+	{
+		std::cout << "Testing HashTableProbed<...>::try_emplace/insert_or_assign..." << std::endl;
+		typedef HashTableProbed<std::string, int, CountingStringHasher> MyProbed;
+		MyProbed ht(100);
+		std::pair<MyProbed::iterator, bool> result = ht.try_emplace("ACDC", 42);
+		TEST(result.second);
+		TEST((*result.first).second == 42);
+		std::pair<MyProbed::iterator, bool> result2 = ht.try_emplace("ACDC", 12);
+		TEST(!result2.second);
+		TEST((*result2.first).second == 42);
+		TEST(ht.emplace("Ozzy", 12).second);
+		TEST(ht.try_emplace("Kiss").second);
+		TEST(ht["Kiss"] == 0);
+
+		// An upsert of a stored key hashes it once
+		CountingStringHasher::sCalls = 0;
+		TEST(!ht.insert_or_assign("ACDC", 23).second);
+		TEST(CountingStringHasher::sCalls == 1);
+		TEST(ht["ACDC"] == 23);
+		TEST(ht.insert_or_assign("Metallica", 5).second);
+		TEST(ht["Metallica"] == 5);
+		TEST(ht.size() == 4);
+	}
+	{
+		std::cout << "Testing HashTableChained<...>::try_emplace/insert_or_assign..." << std::endl;
+		typedef HashTableChained<std::string, int, CountingStringHasher> MyChained;
+		MyChained ht(100);
+		std::pair<MyChained::iterator, bool> result = ht.try_emplace("ACDC", 42);
+		TEST(result.second);
+		TEST((*result.first).second == 42);
+		result = ht.try_emplace("ACDC", 12);
+		TEST(!result.second);
+		TEST((*result.first).second == 42);
+		TEST(ht.emplace("Ozzy", 12).second);
+		TEST(ht.try_emplace("Kiss").second);
+		TEST(ht["Kiss"] == 0);
+
+		CountingStringHasher::sCalls = 0;
+		result = ht.insert_or_assign("ACDC", 23);
+		TEST(CountingStringHasher::sCalls == 1);
+		TEST(!result.second);
+		TEST(ht["ACDC"] == 23);
+		TEST(ht.insert_or_assign("Metallica", 5).second);
+		TEST(ht["Metallica"] == 5);
+		TEST(ht.size() == 4);
+
+		// Collections without an iterator from insert()
+		typedef HashTableChained<int, int, Hasher<int>, DefaultGrower, HashTableProbed<int, int> > MyChained2;
+		MyChained2 ht2(0);
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			std::pair<MyChained2::iterator, bool> result2 = ht2.try_emplace(i, i);
+			TEST(result2.second);
+			TEST((*result2.first).first == i);
+		}
+		TEST(!ht2.try_emplace(42, 0).second);
+		TEST(ht2[42] == 42);
+
+		// Into one InlineBucket, past its inline elements
+		HashTableChained<int, int> ht3(0);
+		int allocated = int(ht3.getAllocated());
+		for (i=0;i<5;++i)
+		{
+			std::pair<HashTableChained<int, int>::iterator, bool> result3 = ht3.try_emplace(i*allocated, i);
+			TEST(result3.second);
+			TEST((*result3.first).first == i*allocated && (*result3.first).second == i);
+		}
+		TEST(size_t(allocated) == ht3.getAllocated());
+		TEST(!ht3.try_emplace(3*allocated, 0).second);
+		TEST(ht3[4*allocated] == 4);
+		TEST(ht3.size() == 5);
+
+		// A std::map collection
+		typedef HashTableChained<int, int, Hasher<int>, DefaultGrower, std::map<int, int> > MyChained4;
+		MyChained4 ht4(0);
+		for (i=0;i<cItems;++i)
+		{
+			std::pair<MyChained4::iterator, bool> result4 = ht4.try_emplace(i, i);
+			TEST(result4.second);
+			TEST((*result4.first).second == i);
+		}
+		TEST(!ht4.try_emplace(42, 0).second);
+		TEST(ht4.size() == size_t(cItems));
+	}
+	{
+		std::cout << "Testing HashTableProbed/HashTableChained::find_batch..." << std::endl;
+		HashTableProbed<int, int> ht(0);
+		HashTableChained<int, int> ht2(0);
+		int keys[100];
+		const std::pair<int, int>* results[100];
+		std::pair<int, int>* results2[100];
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+			TEST(ht2.insert(i,i));
+		}
+		// Every other key is stored
+		for (i=0;i<100;++i)
+		{
+			keys[i] = i%2 == 0 ? i*7 : -i;
+		}
+		const HashTableProbed<int, int>& cht = ht;
+		cht.find_batch(keys, 100, results);
+		ht2.find_batch(keys, 100, results2);
+		for (i=0;i<100;++i)
+		{
+			TEST((results[i] != 0) == (i%2 == 0));
+			TEST((results2[i] != 0) == (i%2 == 0));
+			if (i%2 == 0)
+			{
+				TEST(results[i]->second == keys[i]);
+				TEST(results2[i]->second == keys[i]);
+			}
+		}
+	}
+	{
+		std::cout << "Testing HashTableProbed/HashTableChained::build..." << std::endl;
+		std::vector<std::pair<int, int> > elements;
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			elements.push_back(std::pair<int, int>(i, i));
+		}
+		elements.push_back(std::pair<int, int>(42, 0)); // Already there, skipped
+
+		HashTableProbed<int, int> ht(elements.begin(), elements.end());
+		HashTableChained<int, int> ht2(elements.begin(), elements.end());
+		TEST(ht.size() == cItems);
+		TEST(ht2.size() == cItems);
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+			TEST(ht2[i] == i);
+		}
+
+		// Building onto a table with elements
+		std::vector<std::pair<int, int> > more;
+		for (i=cItems/2;i<2*cItems;++i)
+		{
+			more.push_back(std::pair<int, int>(i, -i));
+		}
+		ht.build(more.begin(), more.end());
+		ht2.build(more.begin(), more.end());
+		TEST(ht.size() == 2*cItems);
+		TEST(ht2.size() == 2*cItems);
+		for (i=0;i<2*cItems;++i)
+		{
+			TEST(ht[i] == (i<cItems ? i : -i));
+			TEST(ht2[i] == (i<cItems ? i : -i));
+		}
+	}
+	{
+		std::cout << "Testing HashTableProbed/HashTableChained::reserve/shrink_to_fit..." << std::endl;
+		HashTableProbed<int, int> ht(0);
+		HashTableChained<int, int> ht2(0);
+		ht.reserve(cItems);
+		ht2.reserve(cItems);
+		size_t allocated = ht.getAllocated();
+		size_t allocated2 = ht2.getAllocated();
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+			TEST(ht2.insert(i,i));
+		}
+		// No rehash after reserve()
+		TEST(ht.getAllocated() == allocated);
+		TEST(ht2.getAllocated() == allocated2);
+
+		for (i=10;i<cItems;++i)
+		{
+			TEST(ht.erase(i) == 1);
+			TEST(ht2.erase(i) == 1);
+		}
+		ht.shrink_to_fit();
+		ht2.shrink_to_fit();
+		TEST(ht.getAllocated() < allocated/10);
+		TEST(ht2.getAllocated() < allocated2/10);
+		for (i=0;i<cItems;++i)
+		{
+			TEST((ht.find(i) != ht.end()) == (i < 10));
+			TEST((ht2.find(i) != ht2.end()) == (i < 10));
+		}
+
+		ht.rehash(cItems);
+		ht2.rehash(cItems);
+		TEST(ht.getAllocated() >= size_t(cItems));
+		TEST(ht2.getAllocated() >= size_t(cItems));
+		TEST(ht[5] == 5);
+		TEST(ht2[5] == 5);
+
+		std::cout << "Testing HashTableProbed/HashTableChained::max_load_factor..." << std::endl;
+		TEST(ht.max_load_factor() > 0.89 && ht.max_load_factor() < 0.91);
+		ht.max_load_factor(0.5f);
+		ht2.max_load_factor(0.5f);
+		for (i=0;i<cItems;++i)
+		{
+			ht.insert(i,i);
+			ht2.insert(i,i);
+			TEST(ht.size() <= ht.getAllocated()/2 + 1);
+		}
+		try
+		{
+			ht.max_load_factor(1.5f);
+			TEST(false);
+		}
+		catch (const char*)
+		{
+		}
+	}
+	{
+		std::cout << "Testing HashTableProbed<int, int>::setIncrementalRehash..." << std::endl;
+		HashTableProbed<int, int> ht(0);
+		ht.setIncrementalRehash(1);
+		bool rehashing = false;
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+			rehashing = rehashing || ht.isRehashing();
+		}
+		TEST(rehashing);
+		TEST(!ht.insert(42,0));
+		TEST(ht.size() == cItems);
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+		}
+		i = 0;
+		for (HashTableProbed<int, int>::iterator it=ht.begin();it!=ht.end();++it)
+		{
+			i++;
+		}
+		TEST(i==cItems);
+		for (i=0;i<cItems;i+=2)
+		{
+			TEST(ht.erase(i) == 1);
+		}
+		TEST(ht.size() == cItems/2);
+		for (i=0;i<cItems;++i)
+		{
+			TEST((ht.find(i) == ht.end()) == (i%2 == 0));
+		}
+	}
+	{
+		std::cout << "Testing HashTableChained<int, int>::setIncrementalRehash..." << std::endl;
+		HashTableChained<int, int> ht(0);
+		ht.setIncrementalRehash(1);
+		bool rehashing = false;
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+			rehashing = rehashing || ht.isRehashing();
+		}
+		TEST(rehashing);
+		TEST(!ht.insert(42,0));
+		TEST(ht.size() == cItems);
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+		}
+		i = 0;
+		for (HashTableChained<int, int>::iterator it=ht.begin();it!=ht.end();++it)
+		{
+			i++;
+		}
+		TEST(i==cItems);
+		for (i=0;i<cItems;i+=2)
+		{
+			TEST(ht.erase(i) == 1);
+		}
+		TEST(ht.size() == cItems/2);
+		for (i=0;i<cItems;++i)
+		{
+			TEST((ht.find(i) == ht.end()) == (i%2 == 0));
+		}
+	}
+	{
+		std::cout << "Testing PoolAllocator..." << std::endl;
+		PoolAllocator allocator(1024);
+		void* a = allocator.allocate(24);
+		void* b = allocator.allocate(24);
+		TEST(a != b);
+		TEST(allocator.getSlabCount() == 1);
+		allocator.deallocate(a, 24);
+		// Same size class, reused
+		TEST(allocator.allocate(32) == a);
+		void* large = allocator.allocate(10000);
+		allocator.deallocate(large, 10000);
+		large = allocator.allocate(10000);
+		int i;
+		for (i=0;i<1000;++i)
+		{
+			allocator.allocate(100);
+		}
+		TEST(allocator.getSlabCount() > 1);
+		allocator.releaseAll();
+		TEST(allocator.getSlabCount() == 0);
+		TEST(allocator.allocate(24) != 0);
+
+		std::cout << "Testing HashTableChained<std::string, int, ..., PoolAllocator>..." << std::endl;
+		typedef HashTableChained<std::string, int, Hasher<std::string>, DefaultGrower, InlineBucket<std::string, int>, PoolAllocator> PooledTable;
+		PooledTable ht(0);
+		const PooledTable& constHt = ht;
+		HashTableChained<int, int, Hasher<int>, DefaultGrower, std::map<int, int>, PoolAllocator> ht2(0);
+		ht.setIncrementalRehash(1);
+		for (int round=0;round<3;++round)
+		{
+			for (i=0;i<cItems;++i)
+			{
+				char buf[20];
+				sprintf(buf, "%d", i);
+				TEST(ht.insert(buf,i));
+				TEST(ht2.insert(i,i));
+			}
+			TEST(ht.size() == size_t(cItems));
+			for (i=0;i<cItems;i+=2)
+			{
+				char buf[20];
+				sprintf(buf, "%d", i);
+				TEST(ht.erase(buf) == 1);
+				TEST(ht2.erase(i) == 1);
+			}
+			for (i=0;i<cItems;++i)
+			{
+				char buf[20];
+				sprintf(buf, "%d", i);
+				// const, as a non-const find() may end the rehash and move end()
+				TEST((constHt.find(buf) == constHt.end()) == (i%2 == 0));
+				TEST((ht2.find(i) == ht2.end()) == (i%2 == 0));
+			}
+			ht.clear();
+			ht2.clear();
+			TEST(ht.size() == 0 && ht2.size() == 0);
+		}
+		ThreadPool pool(2);
+		ht2.setWorkerPool(&pool, 0); // Not thread safe, rehashes on this thread
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht2.insert(i,i));
+		}
+		ht2.rehash(4*cItems);
+		TEST(ht2.size() == size_t(cItems));
+		TEST(ht2[42] == 42);
+	}
+	{
+		std::cout << "Testing HashTableSwiss<int, int>..." << std::endl;
+		HashTableSwiss<int, int> ht(0);
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		TEST(!ht.insert(42,0));
+		TEST(ht.size() == cItems);
+
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+		}
+		TEST(ht.find(cItems) == ht.end());
+		TEST(ht.find(-1) == ht.end());
+
+		std::cout << "Testing HashTableSwiss<int, int>::iterator..." << std::endl;
+		i = 0;
+		for (HashTableSwiss<int, int>::iterator it=ht.begin();it!=ht.end();++it)
+		{
+			i++;
+		}
+		TEST(i==cItems);
+
+		std::cout << "Testing HashTableSwiss<int, int>::erase..." << std::endl;
+		for (i=0;i<cItems;i+=2)
+		{
+			TEST(ht.erase(i) == 1);
+		}
+		TEST(ht.erase(0) == 0);
+		TEST(ht.size() == cItems/2);
+		for (i=0;i<cItems;++i)
+		{
+			TEST((ht.find(i) == ht.end()) == (i%2 == 0));
+		}
+
+		const HashTableSwiss<int, int>& cht = ht;
+		i = 0;
+		for (HashTableSwiss<int, int>::const_iterator cit=cht.begin();cit!=cht.end();++cit)
+		{
+			TEST((*cit).first % 2 == 1);
+			i++;
+		}
+		TEST(i==cItems/2);
+
+		std::cout << "Testing HashTableSwiss<int, int>::clear..." << std::endl;
+		ht.clear();
+		TEST(ht.size() == 0);
+		TEST(ht.begin() == ht.end());
+		TEST(ht.find(7) == ht.end());
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		TEST(ht.size() == cItems);
+		TEST(ht[42] == 42);
+	}
+	{
+		std::cout << "Testing HashTableSwiss<int, int, ..., PowerOfTwoGrower>::clear..." << std::endl;
+		HashTableSwiss<int, int, Hasher<int>, PowerOfTwoGrower> ht(0);
+		int i;
+		for (i=0;i<100;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		ht.clear();
+		TEST(ht.size() == 0);
+		TEST(ht.find(7) == ht.end());
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		TEST(ht.size() == cItems);
+		TEST(ht[42] == 42);
+		ht.clear();
+		ht[1] = 1;
+		TEST(ht[1] == 1);
+	}
+	{
+		std::cout << "Testing HashTableSwiss<CString, int>..." << std::endl;
+		HashTableSwiss<CString, int> ht(0);
+		ht["ACDC"] = 42;
+		ht["Ozzy"] = 12;
+		ht["Toy Dolls"] = 90;
+		ht["Toy Dolls"] = 40;
+		TEST(ht.size() == 3);
+		TEST(ht["ACDC"] == 42);
+		TEST(ht["Toy Dolls"] == 40);
+		TEST(ht.find("Metallica") == ht.end());
+	}
+	{
+		std::cout << "Testing HashTableRobinHood<int, int>..." << std::endl;
+		HashTableRobinHood<int, int> ht(0);
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i*7,i));
+		}
+		TEST(!ht.insert(42,0));
+		TEST(ht.size() == cItems);
+
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i*7] == i);
+			TEST(ht.find(i*7+1) == ht.end());
+		}
+
+		std::cout << "Testing HashTableRobinHood<int, int>::iterator..." << std::endl;
+		i = 0;
+		for (HashTableRobinHood<int, int>::iterator it=ht.begin();it!=ht.end();++it)
+		{
+			i++;
+		}
+		TEST(i==cItems);
+
+		std::cout << "Testing HashTableRobinHood<int, int>::erase..." << std::endl;
+		// Erasing shifts elements back, all remaining ones must still be found
+		for (i=0;i<cItems;i+=3)
+		{
+			TEST(ht.erase(i*7) == 1);
+		}
+		TEST(ht.erase(0) == 0);
+		for (i=0;i<cItems;++i)
+		{
+			TEST((ht.find(i*7) == ht.end()) == (i%3 == 0));
+		}
+
+		const HashTableRobinHood<int, int>& cht = ht;
+		i = 0;
+		for (HashTableRobinHood<int, int>::const_iterator cit=cht.begin();cit!=cht.end();++cit)
+		{
+			i++;
+		}
+		TEST(i==(int)ht.size());
+
+		std::cout << "Testing HashTableRobinHood<int, int>::clear..." << std::endl;
+		ht.clear();
+		TEST(ht.size() == 0);
+		TEST(ht.begin() == ht.end());
+		TEST(ht.find(7) == ht.end());
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		TEST(ht.size() == cItems);
+		TEST(ht[42] == 42);
+		ht.clear();
+		ht[1] = 1;
+		TEST(ht[1] == 1);
+	}
+	{
+		std::cout << "Testing HashTableRobinHood<CString, int>..." << std::endl;
+		HashTableRobinHood<CString, int> ht(0);
+		ht["ACDC"] = 42;
+		ht["Ozzy"] = 12;
+		ht["Toy Dolls"] = 90;
+		ht["Toy Dolls"] = 40;
+		TEST(ht.size() == 3);
+		TEST(ht["ACDC"] == 42);
+		TEST(ht["Toy Dolls"] == 40);
+		TEST(ht.erase("Ozzy") == 1);
+		TEST(ht.find("Ozzy") == ht.end());
+		TEST(ht["ACDC"] == 42);
+	}
+	{
+		std::cout << "Testing HashTableChained<int, int>::iterator copy..." << std::endl;
+		typedef HashTableChained<int, int> MyChained;
+		MyChained ht(0);
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		MyChained::iterator it = ht.find(42);
+		MyChained::iterator it2 = it;
+		TEST(it2 == ht.find(42));
+		TEST((*it2).second == 42);
+		++it2;
+		TEST(it2 != it);
+		it2 = it;
+		TEST(it2 == it);
+		it = ht.end();
+		TEST(it == ht.end());
+		TEST(it2 != ht.end());
+
+		const MyChained& cht = ht;
+		MyChained::const_iterator cit = cht.begin();
+		MyChained::const_iterator cit2 = cht.end();
+		i = 0;
+		for (cit2=cit;cit2!=cht.end();++cit2)
+		{
+			i++;
+		}
+		TEST(i==cItems);
+		TEST(cit == cht.begin());
+	}
+	{
+		std::cout << "Testing InlineBucket<int, int>..." << std::endl;
+		// 2 inline elements, the rest in nodes
+		InlineBucket<int, int> bucket;
+		int i;
+		for (i=0;i<5;++i)
+		{
+			TEST(bucket.insert(InlineBucket<int, int>::value_type(i,i)).second);
+		}
+		TEST(!bucket.insert(InlineBucket<int, int>::value_type(3,0)).second);
+		TEST(bucket.size() == 5);
+		for (i=0;i<5;++i)
+		{
+			TEST((*bucket.find(i)).second == i);
+		}
+		TEST(bucket.find(5) == bucket.end());
+
+		TEST(bucket.erase(0) == 1); // Refilled from the nodes
+		TEST(bucket.erase(3) == 1); // A node
+		TEST(bucket.erase(3) == 0);
+		TEST(bucket.size() == 3);
+		i = 0;
+		for (InlineBucket<int, int>::iterator it=bucket.begin();it!=bucket.end();++it)
+		{
+			TEST((*it).first == 1 || (*it).first == 2 || (*it).first == 4);
+			i++;
+		}
+		TEST(i==3);
+		TEST(bucket.erase(1) == 1);
+		TEST(bucket.erase(2) == 1);
+		TEST(bucket.erase(4) == 1);
+		TEST(bucket.empty());
+		TEST(bucket.begin() == bucket.end());
+
+		std::cout << "Testing HashTableChained<int, int>::rehash of buckets with nodes..." << std::endl;
+		// Hasher<int> maps a key to itself, so keys a multiple of the array
+		// size apart share a bucket, with the elements beyond the second in
+		// nodes, and are split up by the rehash
+		for (int incremental=0;incremental<2;++incremental)
+		{
+			HashTableChained<int, int> ht(0);
+			HashTableChained<int, int, Hasher<int>, DefaultGrower, std::map<int, int> > ht2(0);
+			ht.reserve(200);
+			ht2.reserve(200);
+			ht.setIncrementalRehash(incremental);
+			ht2.setIncrementalRehash(incremental);
+			const int cBuckets = int(ht.getAllocated());
+			for (i=0;i<10*20;++i)
+			{
+				TEST(ht.insert(i%10 + i/10*cBuckets, i));
+				TEST(ht2.insert(i%10 + i/10*cBuckets, i));
+			}
+			ht.rehash(10*cBuckets);
+			ht2.rehash(10*cBuckets);
+			TEST(ht.size() == 200 && ht2.size() == 200);
+			for (i=0;i<10*20;++i)
+			{
+				TEST(ht[i%10 + i/10*cBuckets] == i);
+				TEST(ht2[i%10 + i/10*cBuckets] == i);
+			}
+			i = 0;
+			for (HashTableChained<int, int>::iterator it=ht.begin();it!=ht.end();++it)
+			{
+				i++;
+			}
+			TEST(i == 200);
+			TEST(ht.erase(cBuckets) == 1);
+			TEST(ht.find(cBuckets) == ht.end());
+		}
+	}
+	{
+		std::cout << "Testing HashTableChained<..., Collection = std::map>..." << std::endl;
+		HashTableChained<int, int, Hasher<int>, DefaultGrower, std::map<int, int> > ht(0);
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		TEST(ht.size() == cItems);
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+		}
+		TEST(ht.erase(42) == 1);
+		TEST(ht.find(42) == ht.end());
+	}
+	{
+		std::cout << "Testing HashTableChained<..., Collection = HashTableProbed>..." << std::endl;
+		typedef HashTableProbed<CString, int, SecondStringHasher, DefaultGrower> MyProbed;
+		HashTableChained<CString, int, Hasher<CString>, DefaultGrower, MyProbed> ht(0);
+		TEST(ht.size() == 0);
+		ht["ACDC"] = 42;
+		TEST(ht.size() == 1);
+		ht["Ozzy"] = 12;
+		ht["Metallica"] = 23;
+		ht["Toy Dolls"] = 90;
+		ht["Toy Dolls"] = 40;
+		TEST(ht.size() == 4);
+
+		TEST(ht["ACDC"] == 42);
+		TEST(ht["Ozzy"] == 12);
+		TEST(ht["Metallica"] == 23);
+		TEST(ht["Toy Dolls"] == 40);
+
+		ht.insert("Kiss", 12);
+		ht.insert("Iron Maiden", 12);
+		ht.insert("Rainbow", 12);
+	}
+	{
+		std::cout << "Testing HashTableChained<..., Collection = HashTableProbed>::iterator..." << std::endl;
+
+		typedef HashTableProbed<int, int> MyProbed;
+		typedef HashTableChained<int, int, Hasher<int>, DefaultGrower, MyProbed> MyChained;
+		MyChained ht(0);
+		for (int i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		TEST(ht.size() == cItems);
+
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+		}
+
+		i=0;
+		for (MyChained::iterator it=ht.begin();it!=ht.end();++it)
+		{
+			i++;
+		}
+		TEST(i==cItems);
+		std::cout << "Testing HashTableChained<..., Collection = HashTableProbed>::const_iterator..." << std::endl;
+		{
+			const MyChained& cht = ht;
+			i=0;
+			for (MyChained::const_iterator it=cht.begin();it!=cht.end();++it)
+			{
+				i++;
+			}
+			TEST(i==cItems);
+
+		}
+
+	}
+
+	{
+		std::cout << "Testing HashTableChained<..., Collection = HashTableChained>..." << std::endl;
+
+		typedef HashTableChained<CString, int, SecondStringHasher, DefaultGrower> MyChained2; // Uses default Collection, ie InlineBucket
+		typedef HashTableChained<CString, int, Hasher<CString>, DefaultGrower, MyChained2> MyChained;
+		MyChained ht(0);
+		TEST(ht.size() == 0);
+		ht["ACDC"] = 42;
+		TEST(ht.size() == 1);
+		ht["Ozzy"] = 12;
+		ht["Metallica"] = 23;
+		ht["Toy Dolls"] = 90;
+		ht["Toy Dolls"] = 40;
+		TEST(ht.size() == 4);
+
+		TEST(ht["ACDC"] == 42);
+		TEST(ht["Ozzy"] == 12);
+		TEST(ht["Metallica"] == 23);
+		TEST(ht["Toy Dolls"] == 40);
+
+		TEST(ht.insert("Kiss", 12));
+		TEST(ht.insert("Iron Maiden", 12));
+		TEST(ht.insert("Rainbow", 12));
+		TEST(!ht.insert("Rainbow", 23));
+		TEST(ht["Rainbow"] == 12);
+
+	}
+
+	{
+		std::cout << "Testing HashTableChained<..., Collection = HashTableChained>::iterator..." << std::endl;
+		typedef HashTableChained<int, int> MyChained2;
+		typedef HashTableChained<int, int, Hasher<int>, DefaultGrower, MyChained2> MyChained;
+		MyChained ht(0);
+		for (int i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+
+		TEST(ht.size() == cItems);
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+		}
+
+		i=0;
+		for (MyChained::iterator it=ht.begin();it!=ht.end();++it)
+		{
+			i++;
+		}
+		TEST(i==cItems);
+		std::cout << "Testing HashTableChained<..., Collection = HashTableChained>::const_iterator..." << std::endl;
+		{
+			const MyChained& cht = ht;
+			i=0;
+			for (MyChained::const_iterator it=cht.begin();it!=cht.end();++it)
+			{
+				i++;
+			}
+			TEST(i==cItems);
+
+		}
+	}
+	{
+		std::cout << "Testing ConcurrentHashTable<int, int>..." << std::endl;
+		typedef ConcurrentHashTable<int, int, Hasher<int>, HashTableProbed<int, int> > MyConcurrentProbed;
+		ConcurrentHashTable<int, int> ht(5);
+		MyConcurrentProbed ht2;
+		TEST(ht.getShardCount() == 8);
+		TEST(ht2.getShardCount() == 64);
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+			TEST(ht2.insert(i,i));
+		}
+		TEST(!ht.insert(0,42));
+		TEST(ht.size() == size_t(cItems));
+		TEST(ht2.size() == size_t(cItems));
+		for (i=0;i<cItems;++i)
+		{
+			int value = -1;
+			TEST(ht.find(i, CopyValue(&value)) && value == i);
+			value = -1;
+			TEST(ht2.find(i, CopyValue(&value)) && value == i);
+		}
+		int value = -1;
+		TEST(!ht.find(cItems, CopyValue(&value)) && value == -1);
+		TEST(!ht2.contains(cItems));
+
+		TEST(ht.for_each(SumValues()).mSum == cItems*(cItems-1)/2);
+
+		std::cout << "Testing ConcurrentHashTable<int, int>::upsert/visit..." << std::endl;
+		TEST(!ht.upsert(1, 0, AddToValue(10)));
+		TEST(ht.upsert(cItems, 5, AddToValue(10)));
+		TEST(ht.find(1, CopyValue(&value)) && value == 11);
+		TEST(ht.find(cItems, CopyValue(&value)) && value == 5);
+		TEST(!ht2.upsert(2, 7));
+		TEST(ht2.upsert(cItems, 7));
+		TEST(ht2.find(2, CopyValue(&value)) && value == 7);
+		TEST(ht2.visit(3, AddToValue(1)));
+		TEST(!ht2.visit(-1, AddToValue(1)));
+		TEST(ht2.find(3, CopyValue(&value)) && value == 4);
+
+		for (i=0;i<cItems;i+=2)
+		{
+			TEST(ht.erase(i) == 1);
+			TEST(ht2.erase(i) == 1);
+		}
+		TEST(ht.erase(0) == 0);
+		TEST(ht.size() == size_t(cItems/2 + 1));
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.contains(i) == (i%2 != 0));
+			TEST(ht2.contains(i) == (i%2 != 0));
+		}
+		ht.clear();
+		TEST(ht.size() == 0);
+		TEST(!ht.contains(1));
+	}
+	{
+		std::cout << "Testing ReadMostlyHashTable<int, int>..." << std::endl;
+		ReadMostlyHashTable<int, int> ht(0);
+		ReadMostlyHashTable<int, int>::Reader reader(ht);
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		TEST(!ht.insert(0,42));
+		TEST(ht.size() == size_t(cItems));
+		for (i=0;i<cItems;++i)
+		{
+			int value = -1;
+			TEST(reader.find(i, value) && value == i);
+		}
+		int value = -1;
+		TEST(!reader.find(cItems, value) && value == -1);
+		TEST(reader.find(1, CopyValue(&value)) && value == 1);
+
+		TEST(!ht.insert_or_assign(1, 11));
+		TEST(ht.insert_or_assign(cItems, 5));
+		TEST(reader.find(1, value) && value == 11);
+		TEST(reader.find(cItems, value) && value == 5);
+
+		for (i=0;i<cItems;i+=2)
+		{
+			TEST(ht.erase(i) == 1);
+		}
+		TEST(ht.erase(0) == 0);
+		TEST(ht.size() == size_t(cItems/2 + 1));
+		// Reuses the tombstones rather than growing
+		size_t allocated = ht.getAllocated();
+		for (i=0;i<cItems;i+=2)
+		{
+			TEST(ht.insert(i,i));
+		}
+		TEST(ht.getAllocated() == allocated);
+		for (i=0;i<cItems;++i)
+		{
+			TEST(reader.contains(i));
+		}
+		ht.clear();
+		TEST(ht.size() == 0);
+		TEST(!reader.contains(1));
+		TEST(ht.insert(1,1));
+		TEST(reader.contains(1));
+	}
+	{
+		std::cout << "Testing ReadMostlyHashTable<int, CountedValue> reclamation..." << std::endl;
+		{
+			ReadMostlyHashTable<int, CountedValue> ht(0);
+			ReadMostlyHashTable<int, CountedValue>::Reader reader(ht);
+			int i;
+			for (i=0;i<cItems;++i)
+			{
+				ht.insert(i, CountedValue(i));
+			}
+			TEST(CountedValue::sCount <= cItems + 2);
+
+			// Replaced elements are kept while a reader may look at them
+			int value = 0;
+			int count = 0;
+			TEST(reader.find(42, ReplaceWhileVisiting(&ht, &value, &count)));
+			TEST(value == 42);
+			TEST(count >= cItems + 100);
+
+			// and deleted when it's done
+			for (i=0;i<3;++i)
+			{
+				ht.insert_or_assign(i, CountedValue(i));
+			}
+			TEST(CountedValue::sCount <= cItems + 2);
+			CountedValue counted;
+			TEST(reader.find(42, counted) && counted.mValue == -1);
+		}
+		TEST(CountedValue::sCount == 0);
+	}
+	{
+		std::cout << "Testing InsertOnlyHashTable<std::string, int>..." << std::endl;
+		InsertOnlyHashTable<std::string, int> ht(0);
+		std::vector<const std::pair<std::string, int>*> elements;
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			char buf[20];
+			sprintf(buf, "%d", i);
+			std::pair<const std::pair<std::string, int>*, bool> result = ht.try_emplace(buf, i);
+			TEST(result.second && result.first->second == i);
+			elements.push_back(result.first);
+		}
+		TEST(ht.size() == size_t(cItems));
+		TEST(!ht.insert("42", 0));
+		TEST(ht.try_emplace("42", 0).first == elements[42]);
+		for (i=0;i<cItems;++i)
+		{
+			char buf[20];
+			sprintf(buf, "%d", i);
+			// The elements didn't move when the array grew
+			TEST(ht.find(buf) == elements[i]);
+			int value = -1;
+			TEST(ht.find(buf, value) && value == i);
+		}
+		TEST(!ht.contains("foo"));
+		TEST(ht.insert("foo", 1));
+		TEST(ht.contains("foo"));
+	}
+	{
+		std::cout << "Testing HashTableSnapshot<int, int>..." << std::endl;
+		const char* path = "TestHash.snapshot";
+		HashTableProbed<int, int> ht(0);
+		HashTableChained<int, int> ht2(0);
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+			TEST(ht2.insert(i,-i));
+		}
+		HashTableSnapshot<int, int>::save(ht, path);
+		HashTableSnapshot<int, int> snapshot(path);
+		TEST(snapshot.isOpen());
+		TEST(snapshot.size() == size_t(cItems));
+		TEST(snapshot.getAllocated() > size_t(cItems));
+		for (i=0;i<cItems;++i)
+		{
+			const std::pair<int, int>* vt = snapshot.find(i);
+			TEST(vt != 0 && vt->first == i && vt->second == i);
+		}
+		TEST(!snapshot.contains(cItems));
+		TEST(snapshot.for_each(SumValues()).mSum == (cItems-1)*cItems/2);
+
+		// Saved over after closing, with a hasher id
+		snapshot.close();
+		TEST(!snapshot.isOpen() && snapshot.find(0) == 0);
+		HashTableSnapshot<int, int>::save(ht2, path, 42);
+		try
+		{
+			snapshot.open_mapped(path);
+			TEST(false);
+		}
+		catch (const char*)
+		{
+		}
+		snapshot.open_mapped(path, 42);
+		TEST(snapshot.getHasherId() == 42);
+		int value = 0;
+		TEST(snapshot.find(cItems-1, value) && value == 1-cItems);
+		snapshot.close();
+
+		// Not the same element type
+		try
+		{
+			HashTableSnapshot<int, double> other(path);
+			TEST(false);
+		}
+		catch (const char*)
+		{
+		}
+
+		// Empty table, and a file that isn't a snapshot
+		HashTableProbed<int, int> empty(0);
+		HashTableSnapshot<int, int>::save(empty, path);
+		snapshot.open_mapped(path);
+		TEST(snapshot.size() == 0 && !snapshot.contains(0));
+		snapshot.close();
+		FILE* file = fopen(path, "wb");
+		fputs("Not a snapshot, but long enough to hold a header of one", file);
+		fputs("Not a snapshot, but long enough to hold a header of one", file);
+		fclose(file);
+		try
+		{
+			snapshot.open_mapped(path);
+			TEST(false);
+		}
+		catch (const char*)
+		{
+		}
+		TEST(!snapshot.isOpen());
+		remove(path);
+	}
+	{
+		std::cout << "Testing ThreadPool..." << std::endl;
+		ThreadPool pool(4);
+		TEST(pool.getThreadCount() == 4);
+		std::vector<int> marks(1000, 0);
+		parallelFor(pool, marks.size(), MarkTask(&marks, marks.size()));
+		TEST(std::count(marks.begin(), marks.end(), 1) == 1000);
+		try
+		{
+			parallelFor(pool, marks.size(), MarkTask(&marks, 10));
+			TEST(false);
+		}
+		catch (const char*)
+		{
+		}
+		// The other tasks still ran
+		TEST(std::count(marks.begin(), marks.end(), 2) == 1000);
+
+		std::cout << "Testing HashTableProbed/HashTableChained::setWorkerPool..." << std::endl;
+		HashTableProbed<int, int> ht(0);
+		HashTableProbed<std::string, int, Hasher<std::string>, DefaultGrower, HashCache> ht2(0);
+		HashTableChained<int, int> ht3(0);
+		HashTableChained<int, int, Hasher<int>, DefaultGrower, std::map<int, int> > ht4(0);
+		ht.setWorkerPool(&pool, 0);
+		ht2.setWorkerPool(&pool, 0);
+		ht3.setWorkerPool(&pool, 0);
+		ht4.setWorkerPool(&pool, 0);
+		const int cParallelItems = 20*cItems;
+		int i;
+		for (i=0;i<cParallelItems;++i)
+		{
+			char buf[20];
+			sprintf(buf, "%d", i);
+			TEST(ht.insert(i,i));
+			TEST(ht2.insert(buf,i));
+			TEST(ht3.insert(i,i));
+			TEST(ht4.insert(i,i));
+		}
+		TEST(ht.size() == size_t(cParallelItems));
+		TEST(ht2.size() == size_t(cParallelItems));
+		TEST(ht3.size() == size_t(cParallelItems));
+		TEST(ht4.size() == size_t(cParallelItems));
+		ht.rehash(4*cParallelItems);
+		ht3.rehash(4*cParallelItems);
+		for (i=0;i<cParallelItems;++i)
+		{
+			char buf[20];
+			sprintf(buf, "%d", i);
+			TEST(ht[i] == i);
+			TEST(ht2[buf] == i);
+			TEST(ht3[i] == i);
+			TEST(ht4[i] == i);
+		}
+		TEST(ht.find(cParallelItems) == ht.end());
+		TEST(ht3.find(cParallelItems) == ht3.end());
+		ht.shrink_to_fit();
+		ht3.shrink_to_fit();
+		TEST(ht.size() == size_t(cParallelItems));
+		TEST(ht3.size() == size_t(cParallelItems));
+		TEST(ht[42] == 42);
+		TEST(ht3[42] == 42);
+
+		std::cout << "Testing HashTableChained::build on a WorkerPool..." << std::endl;
+		std::vector<std::pair<int, int> > elements;
+		for (i=0;i<cParallelItems;++i)
+		{
+			elements.push_back(std::pair<int, int>(i, -i));
+		}
+		elements.push_back(std::pair<int, int>(42, 0)); // Already there, skipped
+		HashTableChained<int, int> ht6(0);
+		ht6.setWorkerPool(&pool, 0);
+		TEST(ht6.insert(7, 7));
+		ht6.build(elements.begin(), elements.end());
+		TEST(ht6.size() == size_t(cParallelItems));
+		for (i=0;i<cParallelItems;++i)
+		{
+			TEST(ht6[i] == (i == 7 ? 7 : -i));
+		}
+		TEST(ht6.stats().histogram[0] + ht6.stats().histogram[1] == ht6.getAllocated());
+
+		std::cout << "Testing HashTableProbed/HashTableChained::parallel_for_each..." << std::endl;
+		const int cSum = (cParallelItems-1)*(cParallelItems/2);
+		std::vector<SumValues> sums = ht.parallel_for_each(pool, SumValues());
+		TEST(sums.size() > 1);
+		int sum = 0;
+		for (i=0;i<int(sums.size());++i)
+		{
+			sum += sums[i].mSum;
+		}
+		TEST(sum == cSum);
+		sums = static_cast<const HashTableChained<int, int>&>(ht3).parallel_for_each(pool, SumValues());
+		sum = 0;
+		for (i=0;i<int(sums.size());++i)
+		{
+			sum += sums[i].mSum;
+		}
+		TEST(sum == cSum);
+		TEST(ht4.for_each_in(0, ht4.getAllocated()/2, SumValues()).mSum + ht4.for_each_in(ht4.getAllocated()/2, ht4.getAllocated(), SumValues()).mSum == cSum);
+
+		// Halfway through an incremental rehash
+		HashTableProbed<int, int> ht5(0);
+		ht5.setIncrementalRehash(1);
+		for (i=0;i<cItems && !(i > cItems/2 && ht5.isRehashing());++i)
+		{
+			TEST(ht5.insert(i,i));
+		}
+		TEST(ht5.isRehashing());
+		const int cInserted = i;
+		sums = ht5.parallel_for_each(pool, SumValues());
+		sum = 0;
+		for (i=0;i<int(sums.size());++i)
+		{
+			sum += sums[i].mSum;
+		}
+		TEST(sum == (cInserted-1)*cInserted/2);
+	}
+	{
+		std::cout << "Testing DelimitedParser..." << std::endl;
+		DelimitedParser parser(',');
+		std::string key;
+		int value = 0;
+		const char* line = "foo,-2147483648";
+		TEST(parser(line, line + strlen(line), key, value) && key == "foo" && value == -2147483647-1);
+		line = "foo,2147483648";
+		TEST(!parser(line, line + strlen(line), key, value));
+		line = "foo 42";
+		TEST(!parser(line, line + strlen(line), key, value));
+		unsigned int u = 0;
+		line = "4294967295";
+		TEST(DelimitedParser::convert(line, line + strlen(line), u) && u == 4294967295u);
+		TEST(!DelimitedParser::convert(line, line + strlen(line), value));
+		double d = 0;
+		line = "0.5";
+		TEST(DelimitedParser::convert(line, line + strlen(line), d) && d == 0.5);
+		TEST(!DelimitedParser::convert(line, line + 2, value));
+
+		std::cout << "Testing HashTableLoader..." << std::endl;
+		std::string text;
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			char buf[40];
+			sprintf(buf, i%3 == 0 ? "%d\t%d\r\n" : "%d\t%d\n", i, i);
+			text += buf;
+			if (i%100 == 0)
+				text += "\n"; // Blank lines are skipped
+		}
+		text += "42\t0"; // Duplicate, the first one is kept. No final line break.
+
+		ThreadPool pool(4);
+		// Small chunks, so that there are lots of them
+		HashTableLoader<int, int> loader(pool, DelimitedParser(), 100);
+		HashTableProbed<int, int> ht(0);
+		TEST(loader.load(text.data(), text.data() + text.size(), ht) == size_t(cItems + 1));
+		TEST(ht.size() == size_t(cItems));
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht[i] == i);
+		}
+
+		const char* path = "TestHash.txt";
+		FILE* file = fopen(path, "wb");
+		fwrite(text.data(), 1, text.size(), file);
+		fclose(file);
+		HashTableLoader<std::string, int> stringLoader(pool, DelimitedParser(), 1000);
+		HashTableChained<std::string, int> ht2(0);
+		TEST(stringLoader.load(path, ht2) == size_t(cItems + 1));
+		TEST(ht2.size() == size_t(cItems));
+		TEST(ht2["42"] == 42);
+		TEST(ht2.find("4242") == ht2.end());
+
+		// An empty file has no records
+		file = fopen(path, "wb");
+		fclose(file);
+		TEST(stringLoader.load(path, ht2) == 0);
+		TEST(ht2.size() == size_t(cItems));
+		remove(path);
+
+		text += "\nfoo\tbar\n";
+		for (i=0;i<cItems;++i)
+		{
+			text += "1\t1\n";
+		}
+		HashTableProbed<int, int> ht3(0);
+		try
+		{
+			loader.load(text.data(), text.data() + text.size(), ht3);
+			TEST(false);
+		}
+		catch (const char*)
+		{
+		}
+	}
+	{
+		std::cout << "Testing HashTableProbed::stats..." << std::endl;
+		HashTableProbed<int, int> ht(0);
+		int i;
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		for (i=0;i<cItems;i+=2)
+		{
+			TEST(ht.erase(i) == 1);
+		}
+		HashTableStats stats = ht.stats();
+		TEST(stats.size == ht.size());
+		TEST(stats.allocated == ht.getAllocated());
+		TEST(stats.empty + stats.tombstones + stats.size == stats.allocated);
+		TEST(stats.tombstones > 0);
+		TEST(stats.rehashes > 0);
+		TEST(stats.rehashSeconds > 0);
+		TEST(stats.bytes > stats.allocated*sizeof(HashTableProbed<int, int>::value_type));
+		size_t count = 0;
+		for (i=0;i<int(stats.histogram.size());++i)
+		{
+			count += stats.histogram[i];
+		}
+		TEST(count == stats.size);
+		TEST(stats.histogram[0] == 0);
+		TEST(stats.getEmptyRatio() > 0 && stats.getEmptyRatio() < 1);
+
+		// Hasher<int> maps a key to itself, so multiples of the array size
+		// all start at slot 0
+		ht.clear();
+		ht.reserve(200);
+		ht.resetStats();
+		const int cAllocated = int(ht.getAllocated());
+		for (i=0;i<100;++i)
+		{
+			TEST(ht.insert(i,i));
+		}
+		stats = ht.stats();
+		TEST(stats.rehashes == 0);
+		TEST(stats.getMaxLength() == 1 && stats.getMeanLength() == 1);
+		ht.clear();
+		ht.reserve(200);
+		for (i=0;i<100;++i)
+		{
+			TEST(ht.insert(i*cAllocated,i));
+		}
+		stats = ht.stats();
+		TEST(stats.getMaxLength() == 100);
+		TEST(stats.getMeanLength() == 50.5);
+		TEST(stats.histogram[100] == 1);
+
+		ht.resetStats();
+		TEST(ht.stats().rehashes == 0 && ht.stats().rehashSeconds == 0);
+		const HashTableProbed<int, int>& constHt = ht;
+		TEST(constHt.find(99*cAllocated) != constHt.end());
+		stats = ht.stats();
+#if defined(HASHTABLE_STATS)
+		TEST(stats.lookups == 1 && stats.lookupSteps == 100);
+		TEST(stats.getMeanLookupLength() == 100);
+#else
+		TEST(stats.lookups == 0 && stats.lookupSteps == 0);
+#endif
+
+		// Halfway through an incremental rehash, the old array counts too
+		HashTableProbed<int, int> ht2(0);
+		ht2.setIncrementalRehash(1);
+		for (i=0;i<cItems && !(i > cItems/2 && ht2.isRehashing());++i)
+		{
+			TEST(ht2.insert(i,i));
+		}
+		TEST(ht2.isRehashing());
+		stats = ht2.stats();
+		TEST(stats.allocated == ht2.getAllocated());
+		TEST(stats.empty + stats.tombstones + stats.size == stats.allocated);
+		count = 0;
+		for (i=0;i<int(stats.histogram.size());++i)
+		{
+			count += stats.histogram[i];
+		}
+		TEST(count == ht2.size());
+
+		std::cout << "Testing HashTableChained::stats..." << std::endl;
+		HashTableChained<int, int> ht3(0);
+		HashTableChained<int, int, Hasher<int>, DefaultGrower, std::map<int, int> > ht4(0);
+		for (i=0;i<cItems;++i)
+		{
+			TEST(ht3.insert(i,i));
+			TEST(ht4.insert(i,i));
+		}
+		stats = ht3.stats();
+		TEST(stats.size == ht3.size());
+		TEST(stats.allocated == ht3.getAllocated());
+		TEST(stats.tombstones == 0);
+		TEST(stats.rehashes > 0);
+		TEST(stats.empty == stats.histogram[0]);
+		size_t buckets = 0;
+		count = 0;
+		for (i=0;i<int(stats.histogram.size());++i)
+		{
+			buckets += stats.histogram[i];
+			count += i*stats.histogram[i];
+		}
+		TEST(buckets == stats.allocated);
+		TEST(count == stats.size);
+		TEST(ht4.stats().bytes > stats.bytes);
+
+		ht3.clear();
+		ht3.reserve(200);
+		ht3.resetStats();
+		const int cBuckets = int(ht3.getAllocated());
+		for (i=0;i<100;++i)
+		{
+			TEST(ht3.insert(i*cBuckets,i));
+		}
+		stats = ht3.stats();
+		TEST(stats.rehashes == 0);
+		TEST(stats.getMaxLength() == 100 && stats.getMeanLength() == 100);
+		TEST(stats.histogram[100] == 1);
+		TEST(stats.empty == size_t(cBuckets - 1));
+		const HashTableChained<int, int>& constHt3 = ht3;
+		TEST(constHt3.find(cBuckets) != constHt3.end());
+		stats = ht3.stats();
+#if defined(HASHTABLE_STATS)
+		TEST(stats.lookups > 100 && stats.getMeanLookupLength() > 1);
+#else
+		TEST(stats.lookups == 0 && stats.lookupSteps == 0);
+#endif
+	}
+	END_TEST;
+	char ch; 
+	std::cout << "Press <Enter>";
+	std::cin.getline(&ch,1);
 }
\ No newline at end of file
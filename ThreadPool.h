@@ -0,0 +1,186 @@
+/*=====================================================================
+	ThreadPool.h - A WorkerPool of std::threads
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		class ThreadPool : public WorkerPool
+
+  Requirements:
+		C++11 (std::thread)
+
+  Dependencies:
+		WorkerPool.h
+
+=====================================================================*/
+#if !defined(THREADPOOL_H)
+#define THREADPOOL_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "WorkerPool.h"
+
+//------------------------------------------------------------------------
+// ThreadPool
+// The threads are started once and wait for run() calls. The thread
+// calling run() works on the tasks too. Tasks are handed out one at a
+// time from a shared counter, so a slow one doesn't hold up the others.
+// One run() at a time, calling run() from a task deadlocks.
+class ThreadPool : public WorkerPool
+{
+public:
+	//------------------------------------------------------------------
+	// Public Construction
+	//------------------------------------------------------------------
+	// threads includes the one calling run(), 0 for one per core
+	explicit ThreadPool(size_t threads=0):mTask(0), mContext(0), mCount(0), mNext(0), mActive(0), mGeneration(0), mStop(false)
+	{
+		if (threads == 0)
+			threads = std::thread::hardware_concurrency();
+		for (size_t i=1;i<threads;++i)
+		{
+			mThreads.push_back(std::thread(&ThreadPool::workerLoop, this));
+		}
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStop = true;
+		}
+		mWake.notify_all();
+		for (size_t i=0;i<mThreads.size();++i)
+		{
+			mThreads[i].join();
+		}
+	}
+
+	//------------------------------------------------------------------
+	// WorkerPool
+	//------------------------------------------------------------------
+	virtual size_t getThreadCount() const
+	{
+		return mThreads.size() + 1;
+	}
+
+	virtual void run(size_t count, Task task, void* context)
+	{
+		std::lock_guard<std::mutex> runLock(mRunMutex);
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mTask = task;
+			mContext = context;
+			mCount = count;
+			mNext.store(0, std::memory_order_relaxed);
+			mActive = mThreads.size();
+			mError = std::exception_ptr();
+			mGeneration++;
+		}
+		mWake.notify_all();
+
+		work();
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		while (mActive > 0)
+		{
+			mDone.wait(lock);
+		}
+		if (mError)
+			std::rethrow_exception(mError);
+	}
+
+private:
+	//------------------------------------------------------------------
+	// Disabled Methods
+	//------------------------------------------------------------------
+	// Copy constructor
+	ThreadPool(const ThreadPool&);
+
+	// Assignment operator
+	ThreadPool& operator = (const ThreadPool&);
+
+	//------------------------------------------------------------------
+	// Private Helper Methods
+	//------------------------------------------------------------------
+	// Takes tasks until there are none left
+	void work()
+	{
+		for (;;)
+		{
+			size_t index = mNext.fetch_add(1, std::memory_order_relaxed);
+			if (index >= mCount)
+				return;
+
+			try
+			{
+				mTask(mContext, index);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (!mError)
+					mError = std::current_exception();
+			}
+		}
+	}
+
+	// A pool thread works once on every run()
+	void workerLoop()
+	{
+		size_t generation = 0;
+		std::unique_lock<std::mutex> lock(mMutex);
+		for (;;)
+		{
+			while (!mStop && mGeneration == generation)
+			{
+				mWake.wait(lock);
+			}
+			if (mStop)
+				return;
+			generation = mGeneration;
+
+			lock.unlock();
+			work();
+			lock.lock();
+
+			if (--mActive == 0)
+				mDone.notify_all();
+		}
+	}
+
+	//------------------------------------------------------------------
+	// Members
+	//------------------------------------------------------------------
+	std::vector<std::thread> mThreads;
+	std::mutex mRunMutex; // One run() at a time
+
+	// The current run(), guarded by mMutex apart from mNext
+	std::mutex mMutex;
+	std::condition_variable mWake;	// A new run(), or stopping
+	std::condition_variable mDone;	// The last thread is done
+	Task mTask;
+	void* mContext;
+	size_t mCount;
+	std::atomic<size_t> mNext;		// The next task to hand out
+	size_t mActive;					// Pool threads still working on it
+	size_t mGeneration;				// Counts run() calls
+	std::exception_ptr mError;		// The first exception thrown by a task
+	bool mStop;
+};
+
+#endif // !defined(THREADPOOL_H)
@@ -0,0 +1,103 @@
+/*=====================================================================
+	WorkerPool.h - Interface to a pool of threads
+
+	Author: Per Nilsson
+
+	Freeware and no copyright on my behalf. However, if you use the
+	code in some manner	I'd appreciate a notification about it
+	perfnurt@hotmail.com
+
+	Classes:
+
+		class WorkerPool
+
+		// Runs a function object on a WorkerPool
+		template <class Task> void parallelFor(WorkerPool&, size_t, const Task&)
+
+		// The tables' parallel_for_each() tasks
+		template <class Table, class Visitor> class ForEachTask
+
+  Requirements:
+		N/A
+
+  Dependencies:
+		To std::vector for ForEachTask
+
+=====================================================================*/
+#if !defined(WORKERPOOL_H)
+#define WORKERPOOL_H
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <stddef.h> // size_t
+#include <vector>
+
+//------------------------------------------------------------------------
+// WorkerPool
+// What the hash tables need from a thread pool to split up big jobs, eg
+// a rehash. Derive from it to hand them the threads of your own pool, or
+// use ThreadPool.
+class WorkerPool
+{
+public:
+	typedef void (*Task)(void* context, size_t index);
+
+	virtual ~WorkerPool() {}
+
+	// Threads that work on a run(), including the calling one. Work is
+	// split in a few times as many tasks, to even out the load.
+	virtual size_t getThreadCount() const = 0;
+
+	// Calls task(context, i) for every i in [0, count), spread over the
+	// threads, and returns when they're all done. An exception thrown by
+	// a task is thrown again by run(), after the other tasks are done.
+	virtual void run(size_t count, Task task, void* context) = 0;
+};
+
+//------------------------------------------------------------------------
+// parallelFor
+// Calls task(i) for every i in [0, count) on pool.
+template <class Task>
+class ParallelForCaller
+{
+public:
+	static void call(void* context, size_t index)
+	{
+		(*static_cast<const Task*>(context))(index);
+	}
+};
+
+template <class Task>
+void parallelFor(WorkerPool& pool, size_t count, const Task& task)
+{
+	pool.run(count, &ParallelForCaller<Task>::call, const_cast<Task*>(&task));
+}
+
+//------------------------------------------------------------------------
+// ForEachTask
+// Task i of a table's parallel_for_each() runs visitors[i] over the i:th
+// of visitors.size() ranges of the table's slot index space, through
+// Table::for_each_in(). Table may be const.
+template <class Table, class Visitor>
+class ForEachTask
+{
+public:
+	ForEachTask(Table& table, std::vector<Visitor>& visitors):mTable(table), mVisitors(visitors) {}
+
+	void operator()(size_t task) const
+	{
+		size_t allocated = mTable.getAllocated();
+		size_t perTask = allocated / mVisitors.size() + 1;
+		size_t first = task*perTask < allocated ? task*perTask : allocated;
+		size_t last = first + perTask < allocated ? first + perTask : allocated;
+		mVisitors[task] = mTable.for_each_in(first, last, mVisitors[task]);
+	}
+
+private:
+	Table& mTable;
+	std::vector<Visitor>& mVisitors;
+};
+
+#endif // !defined(WORKERPOOL_H)